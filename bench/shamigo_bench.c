@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/sss_algos.h"
+
+#define BENCH_MAX_LIST 64
+#define BENCH_COVER_WIDTH 1024
+
+typedef struct {
+    int values[BENCH_MAX_LIST];
+    int count;
+} IntListT;
+
+typedef struct {
+    int32_t width[BENCH_MAX_LIST];
+    int32_t height[BENCH_MAX_LIST];
+    int count;
+} SizeListT;
+
+typedef struct {
+    IntListT ks;
+    IntListT ns; // 0 stands for n = k
+    SizeListT sizes;
+    int reps;
+    uint64_t seed;
+    uint8_t keystream;
+    uint8_t lsb_bits;
+    bool io;
+    const char *tmpdir;
+    FILE *out;
+    bool first_result;
+} BenchConfigT;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift64*, so that synthetic images only depend on --seed
+static uint64_t bench_rand(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Parses "2-10", "2,4,8" or a mix of both
+static bool parse_int_list(const char *arg, IntListT *list)
+{
+    list->count = 0;
+    const char *p = arg;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+        if (end == p)
+            return false;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo)
+                return false;
+        }
+        for (long v = lo; v <= hi; v++) {
+            if (list->count == BENCH_MAX_LIST)
+                return false;
+            list->values[list->count++] = (int)v;
+        }
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0')
+            return false;
+    }
+    return list->count > 0;
+}
+
+// Parses "12x12,1024x768"
+static bool parse_size_list(const char *arg, SizeListT *list)
+{
+    list->count = 0;
+    const char *p = arg;
+    while (*p) {
+        char *end;
+        long w = strtol(p, &end, 10);
+        if (end == p || *end != 'x')
+            return false;
+        p = end + 1;
+        long h = strtol(p, &end, 10);
+        if (end == p || w <= 0 || h <= 0 || w > UINT16_MAX || h > UINT16_MAX || list->count == BENCH_MAX_LIST)
+            return false;
+        list->width[list->count] = w;
+        list->height[list->count] = h;
+        list->count++;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0')
+            return false;
+    }
+    return list->count > 0;
+}
+
+static BMPImageT *bench_make_image(int32_t width, int32_t height, uint64_t *rng)
+{
+    BMPColorT palette[256];
+    for (int i = 0; i < 256; i++)
+        palette[i] = (BMPColorT){.blue = i, .green = i, .red = i, .alpha = 0};
+
+    BMPImageT *image = bmp_create(width, height, 8, palette, 256);
+    if (!image)
+        return NULL;
+
+    // Random pixels and padding; generation is not part of any measured stage
+    size_t size = (size_t)bmp_stride(image) * height;
+    uint8_t *px = image->pixels;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t r = bench_rand(rng);
+        memcpy(px + i, &r, 8);
+    }
+    for (uint64_t r = bench_rand(rng); i < size; i++, r >>= 8)
+        px[i] = r & 0xFF;
+    return image;
+}
+
+static void bench_emit(BenchConfigT *cfg, const BMPImageT *secret, int k, int n, const char *stage,
+                       double seconds, size_t bytes, size_t sections)
+{
+    fprintf(cfg->out, "%s\n    {\"width\": %d, \"height\": %d, \"k\": %d, \"n\": %d, \"stage\": \"%s\", "
+                      "\"seconds\": %.9f, \"bytes\": %zu, \"mb_per_s\": %.3f",
+            cfg->first_result ? "" : ",", secret->width, secret->height, k, n, stage,
+            seconds, bytes, seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+    if (sections > 0)
+        fprintf(cfg->out, ", \"sections\": %zu, \"ns_per_section\": %.3f", sections, seconds * 1e9 / sections);
+    fprintf(cfg->out, "}");
+    cfg->first_result = false;
+}
+
+static bool bench_run(BenchConfigT *cfg, int32_t width, int32_t height, int k, int n)
+{
+    uint64_t rng = cfg->seed ^ ((uint64_t)width << 32) ^ ((uint64_t)height << 16) ^ (k << 8) ^ n;
+    uint16_t seed = cfg->seed & 0xFFFF;
+    uint8_t *shadow_data[256] = {0};
+    ArenaT arena;
+    arena_init(&arena, 0);
+    BMPImageT *secret = bench_make_image(width, height, &rng);
+    if (!secret)
+        return false;
+
+    size_t pixels = (size_t)width * height;
+    size_t padded = (size_t)bmp_stride(secret) * height;
+    size_t sections = (pixels + k - 1) / k;
+
+    StegoMetaT meta;
+    stego_meta_init(&meta, width, height, k);
+    meta.keystream = cfg->keystream;
+    meta.lsb_bits = cfg->lsb_bits;
+    size_t cover_bytes = stego_meta_cover_bytes(&meta, sections);
+    BMPImageT *cover = bench_make_image(BENCH_COVER_WIDTH, (cover_bytes + BENCH_COVER_WIDTH - 1) / BENCH_COVER_WIDTH, &rng);
+    BMPImageT *recovered = bmp_create(width, height, 8, secret->palette, 256);
+    uint8_t **extracted = calloc(k, sizeof(uint8_t *));
+    bool ok = cover && recovered && extracted;
+    for (int i = 0; ok && i < k; i++) {
+        extracted[i] = malloc(sections);
+        ok = extracted[i] != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Out of memory benchmarking %dx%d, k = %d, n = %d\n", width, height, k, n);
+        goto cleanup;
+    }
+
+    double best[8];
+    for (int s = 0; s < 8; s++)
+        best[s] = 1e300;
+
+    for (int rep = 0; rep < cfg->reps; rep++) {
+        double t0 = now_seconds();
+        sss_distribute_initial_xor_inplace(secret, seed, cfg->keystream);
+        double t1 = now_seconds();
+        arena_release(&arena);
+        if (!sss_distribute_share_image_k(secret, NULL, k, n, STEGO_META_SHARE_BYTE, shadow_data, &arena)) {
+            ok = false;
+            goto cleanup;
+        }
+        double t2 = now_seconds();
+
+        // A single cover buffer is reused for every share, so gigapixel runs stay in memory
+        for (int i = 0; i < n; i++)
+            lsb_encoder_lsb1_into_cover_extended(shadow_data[i], sections, cover, seed, &meta);
+        stego_meta_set_reserved(cover, seed, n, true);
+        double t3 = now_seconds();
+        // The cover holds the last share, and its header the CRC32C every extraction checks
+        StegoMetaT cover_meta;
+        lsb_decoder_lsb1_read_meta(cover, &cover_meta);
+        for (int i = 0; i < k; i++)
+            lsb_decoder_lsb1_extract_to_buffer_extended(extracted[i], sections, cover, &cover_meta);
+        double t4 = now_seconds();
+
+        uint16_t x[SSS_MAX_K];
+        for (int i = 0; i < k; i++)
+            x[i] = i + 1;
+        SSSInterpT interp;
+        sss_interp_prepare(&interp, x, k);
+        BMPLinearIterT out_it;
+        bmp_linear_iter_init(&out_it, recovered, 0);
+        for (size_t section = 0; section < sections; section++) {
+            uint8_t y[SSS_MAX_K], coeffs[SSS_MAX_K];
+            for (int i = 0; i < k; i++)
+                y[i] = shadow_data[i][section];
+            sss_interp_coeffs(&interp, y, coeffs);
+            bmp_linear_write(&out_it, coeffs, k);
+        }
+        double t5 = now_seconds();
+        sss_distribute_initial_xor_inplace(recovered, seed, cfg->keystream);
+        double t6 = now_seconds();
+
+        double t7 = t6, t8 = t6;
+        if (cfg->io) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/shamigo_bench_%d.bmp", cfg->tmpdir, (int)getpid());
+            for (int i = 0; i < n; i++)
+                bmp_save(path, cover);
+            t7 = now_seconds();
+            for (int i = 0; i < k; i++)
+                bmp_unload(bmp_load(path));
+            t8 = now_seconds();
+            unlink(path);
+        }
+
+        double times[8] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3, t5 - t4, t6 - t5, t7 - t6, t8 - t7};
+        for (int s = 0; s < 8; s++)
+            if (times[s] < best[s])
+                best[s] = times[s];
+
+        // Scramble the secret back so that every repetition shares the same input
+        sss_distribute_initial_xor_inplace(secret, seed, cfg->keystream);
+    }
+
+    size_t cover_total = (size_t)bmp_stride(cover) * cover->height;
+    bench_emit(cfg, secret, k, n, "xor", best[0], padded, 0);
+    bench_emit(cfg, secret, k, n, "share", best[1], pixels, sections);
+    bench_emit(cfg, secret, k, n, "embed", best[2], (size_t)n * cover_bytes, (size_t)n * sections);
+    bench_emit(cfg, secret, k, n, "extract", best[3], (size_t)k * cover_bytes, (size_t)k * sections);
+    bench_emit(cfg, secret, k, n, "interpolate", best[4], pixels, sections);
+    bench_emit(cfg, secret, k, n, "unxor", best[5], padded, 0);
+    if (cfg->io) {
+        bench_emit(cfg, secret, k, n, "save", best[6], (size_t)n * cover_total, 0);
+        bench_emit(cfg, secret, k, n, "load", best[7], (size_t)k * cover_total, 0);
+    }
+
+cleanup:
+    arena_release(&arena);
+    for (int i = 0; extracted && i < k; i++)
+        free(extracted[i]);
+    free(extracted);
+    bmp_unload(recovered);
+    bmp_unload(cover);
+    bmp_unload(secret);
+    return ok;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--k list] [--n list] [--sizes WxH,...] [--reps num] [--seed num]\n"
+            "          [--keystream lcg|ctr] [--lsb 1|2|4] [--no-io] [--tmpdir dir] [--out file]\n"
+            "  Lists take values and ranges, e.g. 2-10 or 2,4,8. An n of 0 means n = k.\n"
+            "  Sizes go from 12x12 up to 65535x65535 (e.g. 32768x32768 for a gigapixel secret).\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfigT cfg = {
+        .reps = 3,
+        .seed = 1,
+        .keystream = RNGPT_MODE_LCG48,
+        .lsb_bits = 1,
+        .io = true,
+        .tmpdir = "/tmp",
+        .out = stdout,
+        .first_result = true,
+    };
+    parse_int_list("2-10", &cfg.ks);
+    parse_int_list("0", &cfg.ns);
+    parse_size_list("12x12,256x256,1024x1024,4096x4096", &cfg.sizes);
+
+    static struct option long_options[] = {
+        {"k",         required_argument, 0, 'k'},
+        {"n",         required_argument, 0, 'n'},
+        {"sizes",     required_argument, 0, 'S'},
+        {"reps",      required_argument, 0, 'r'},
+        {"seed",      required_argument, 0, 's'},
+        {"keystream", required_argument, 0, 'K'},
+        {"lsb",       required_argument, 0, 'L'},
+        {"no-io",     no_argument,       0, 'I'},
+        {"tmpdir",    required_argument, 0, 't'},
+        {"out",       required_argument, 0, 'o'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:n:S:r:s:K:L:It:o:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'k':
+                if (!parse_int_list(optarg, &cfg.ks)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                if (!parse_int_list(optarg, &cfg.ns)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'S':
+                if (!parse_size_list(optarg, &cfg.sizes)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'r':
+                cfg.reps = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 's':
+                cfg.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'K':
+                cfg.keystream = strcmp(optarg, "ctr") == 0 ? RNGPT_MODE_CTR : RNGPT_MODE_LCG48;
+                break;
+            case 'L':
+                cfg.lsb_bits = (uint8_t)atoi(optarg);
+                if (!stego_meta_lsb_bits_valid(cfg.lsb_bits)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'I':
+                cfg.io = false;
+                break;
+            case 't':
+                cfg.tmpdir = optarg;
+                break;
+            case 'o':
+                cfg.out = fopen(optarg, "w");
+                if (!cfg.out) {
+                    perror("Could not open output file");
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // Every distribution path draws its seed from rand()
+    srand(cfg.seed);
+
+    fprintf(cfg.out, "{\n  \"seed\": %llu,\n  \"reps\": %d,\n  \"keystream\": \"%s\",\n  \"lsb_bits\": %u,\n  \"results\": [",
+            (unsigned long long)cfg.seed, cfg.reps, cfg.keystream == RNGPT_MODE_CTR ? "ctr" : "lcg", cfg.lsb_bits);
+
+    int status = 0;
+    for (int s = 0; s < cfg.sizes.count; s++) {
+        for (int ki = 0; ki < cfg.ks.count; ki++) {
+            int k = cfg.ks.values[ki];
+            if (k < SSS_MIN_K || k > SSS_MAX_K)
+                continue;
+            for (int ni = 0; ni < cfg.ns.count; ni++) {
+                int n = cfg.ns.values[ni] == 0 ? k : cfg.ns.values[ni];
+                if (n < k || n > 256)
+                    continue;
+                if (!bench_run(&cfg, cfg.sizes.width[s], cfg.sizes.height[s], k, n))
+                    status = 1;
+                fflush(cfg.out);
+            }
+        }
+    }
+
+    fprintf(cfg.out, "\n  ]\n}\n");
+    if (cfg.out != stdout)
+        fclose(cfg.out);
+    return status;
+}
+
+#undef BENCH_MAX_LIST
+#undef BENCH_COVER_WIDTH
@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "../include/sss_kernels.h"
+
+#define KBENCH_PRIME 257
+#define KBENCH_BATCH 1024          // Sections per timed batch
+#define KBENCH_BATCH_SECONDS 0.002 // Slow routines end a batch early once this much time passed
+#define KBENCH_LEGACY_CASES 100    // Cap on the cases checked for the O(k^3) legacy routines
+#define KBENCH_BYTE_KINDS 8        // XOR, CRC32C, then embed and extract for 1, 2 and 4 LSBs
+
+typedef struct {
+    int k_min;
+    int k_max;
+    int cases;       // Random inputs checked per k and routine
+    int min_batches; // Timed batches per routine; the fastest one is reported
+    uint64_t seed;
+    FILE *out;
+    bool first_result;
+    int failures;
+    CpuLevelT level; // Kernel sets above this level are skipped
+} KBenchConfigT;
+
+/**
+ * An interpolation routine under test, behind a common signature.
+ * Routines that only recover the secret byte (coefficient 0) set only_first.
+ */
+typedef struct {
+    const char *name;
+    bool legacy; // Not used by recovery; mismatches are reported but do not fail the run
+    bool only_first;
+    void (*fn)(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs, const SSSKernelsT *kernels);
+    const SSSKernelsT *kernels;
+} KBenchInterpT;
+
+static uint64_t kbench_rand(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Reference cycle counter (TSC ticks on x86), 0 where none is available
+static uint64_t now_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Reference share evaluation: Horner's rule, and a full re-evaluation after every fixup
+static void ref_share(uint8_t *coeffs, int k, int n, uint16_t *fx)
+{
+    for (;;) {
+        bool overflow = false;
+        for (int x = 1; x <= n; x++) {
+            uint32_t acc = 0;
+            for (int j = k - 1; j >= 0; j--)
+                acc = (acc * x + coeffs[j]) % KBENCH_PRIME;
+            fx[x - 1] = acc;
+            overflow |= acc == 256;
+        }
+        if (!overflow)
+            return;
+
+        int j = 0;
+        while (coeffs[j] == 0)
+            j++;
+        coeffs[j]--;
+    }
+}
+
+// Reference 9-bit share evaluation: Horner's rule, no fixup
+static void ref_share_wide(const uint8_t *coeffs, int k, int n, uint16_t *fx)
+{
+    for (int x = 1; x <= n; x++) {
+        uint32_t acc = 0;
+        for (int j = k - 1; j >= 0; j--)
+            acc = (acc * x + coeffs[j]) % KBENCH_PRIME;
+        fx[x - 1] = acc;
+    }
+}
+
+static void interp_reconstruct_pixel(const SSSInterpT *interp, const uint8_t *y, uint8_t *out, const SSSKernelsT *kernels)
+{
+    out[0] = lagrange_reconstruct_pixel((uint8_t *)y, (uint16_t *)interp->x, interp->k);
+}
+
+static void interp_reconstruct_coeffs(const SSSInterpT *interp, const uint8_t *y, uint8_t *out, const SSSKernelsT *kernels)
+{
+    lagrange_reconstruct_coeffs(y, interp->x, interp->k, out);
+}
+
+static void interp_kernel(const SSSInterpT *interp, const uint8_t *y, uint8_t *out, const SSSKernelsT *kernels)
+{
+    kernels->interp_coeffs(interp, y, out);
+}
+
+// Picks k distinct x coordinates out of 1..n, in random order
+static void random_xs(uint64_t *rng, int k, int n, uint16_t *x)
+{
+    uint16_t pool[256];
+    for (int i = 0; i < n; i++)
+        pool[i] = i + 1;
+    for (int i = 0; i < k; i++) {
+        int j = i + kbench_rand(rng) % (n - i);
+        uint16_t tmp = pool[i];
+        pool[i] = pool[j];
+        pool[j] = tmp;
+        x[i] = pool[i];
+    }
+}
+
+static void random_bytes(uint64_t *rng, uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = kbench_rand(rng) & 0xFF;
+}
+
+static void kbench_emit(KBenchConfigT *cfg, const char *kind, const char *name, int k, int n,
+                        int cases, int mismatches, double ns, double cycles)
+{
+    fprintf(cfg->out, "%s\n    {\"kind\": \"%s\", \"routine\": \"%s\", \"k\": %d, \"n\": %d, "
+                      "\"cases\": %d, \"mismatches\": %d, \"ns_per_section\": %.3f, \"cycles_per_section\": %.1f}",
+            cfg->first_result ? "" : ",", kind, name, k, n, cases, mismatches, ns, cycles);
+    cfg->first_result = false;
+}
+
+// Differential check and timing of every share kernel against ref_share
+static void kbench_share(KBenchConfigT *cfg, int k, int n, uint64_t *rng)
+{
+    uint16_t *powers = sss_share_powers_create(k, n);
+    uint8_t *batch = malloc((size_t)KBENCH_BATCH * k);
+    if (!powers || !batch) {
+        fprintf(stderr, "Out of memory benchmarking shares for k = %d\n", k);
+        cfg->failures++;
+        goto cleanup;
+    }
+    random_bytes(rng, batch, (size_t)KBENCH_BATCH * k);
+
+    for (size_t ki = 0; ki < sss_kernels_count(); ki++) {
+        const SSSKernelsT *kernels = sss_kernels_at(ki);
+        if (kernels->level > cfg->level)
+            continue;
+        int mismatches = 0;
+        for (int c = 0; c < cfg->cases; c++) {
+            uint8_t coeffs[SSS_MAX_K], ref_coeffs[SSS_MAX_K];
+            uint16_t fx[256], ref_fx[256];
+            random_bytes(rng, coeffs, k);
+            // Bias some cases towards small coefficients, where the fixup walks further
+            if (c % 4 == 0)
+                for (int j = 0; j < k; j++)
+                    coeffs[j] &= 0x03;
+            memcpy(ref_coeffs, coeffs, k);
+
+            kernels->share_section(coeffs, k, n, powers, fx);
+            ref_share(ref_coeffs, k, n, ref_fx);
+            if (memcmp(coeffs, ref_coeffs, k) != 0 || memcmp(fx, ref_fx, n * sizeof(uint16_t)) != 0)
+                mismatches++;
+        }
+
+        double best_ns = 1e300, best_cycles = 1e300;
+        for (int b = 0; b < cfg->min_batches; b++) {
+            uint8_t coeffs[SSS_MAX_K];
+            uint16_t fx[256];
+            uint32_t sink = 0;
+            double t0 = now_seconds();
+            uint64_t c0 = now_cycles();
+            for (int s = 0; s < KBENCH_BATCH; s++) {
+                memcpy(coeffs, batch + (size_t)s * k, k);
+                kernels->share_section(coeffs, k, n, powers, fx);
+                sink += fx[s % n];
+            }
+            uint64_t c1 = now_cycles();
+            double t1 = now_seconds();
+            if (sink == 0xFFFFFFFF)
+                fputc(' ', stderr);
+            if ((t1 - t0) * 1e9 / KBENCH_BATCH < best_ns) {
+                best_ns = (t1 - t0) * 1e9 / KBENCH_BATCH;
+                best_cycles = (double)(c1 - c0) / KBENCH_BATCH;
+            }
+        }
+
+        if (mismatches > 0) {
+            fprintf(stderr, "share kernel '%s' differs from the reference for k = %d, n = %d (%d/%d cases)\n",
+                    kernels->name, k, n, mismatches, cfg->cases);
+            cfg->failures++;
+        }
+        kbench_emit(cfg, "share", kernels->name, k, n, cfg->cases, mismatches, best_ns, best_cycles);
+    }
+
+cleanup:
+    free(batch);
+    free(powers);
+}
+
+// Differential check and timing of every 9-bit share kernel against ref_share_wide
+static void kbench_share_wide(KBenchConfigT *cfg, int k, int n, uint64_t *rng)
+{
+    uint16_t *powers = sss_share_powers_create(k, n);
+    uint8_t *batch = malloc((size_t)KBENCH_BATCH * k);
+    if (!powers || !batch) {
+        fprintf(stderr, "Out of memory benchmarking 9-bit shares for k = %d\n", k);
+        cfg->failures++;
+        goto cleanup;
+    }
+    random_bytes(rng, batch, (size_t)KBENCH_BATCH * k);
+
+    for (size_t ki = 0; ki < sss_kernels_count(); ki++) {
+        const SSSKernelsT *kernels = sss_kernels_at(ki);
+        if (kernels->level > cfg->level)
+            continue;
+        int mismatches = 0;
+        for (int c = 0; c < cfg->cases; c++) {
+            uint8_t coeffs[SSS_MAX_K];
+            uint16_t fx[256], ref_fx[256];
+            random_bytes(rng, coeffs, k);
+            kernels->share_wide(coeffs, k, n, powers, fx);
+            ref_share_wide(coeffs, k, n, ref_fx);
+            if (memcmp(fx, ref_fx, n * sizeof(uint16_t)) != 0)
+                mismatches++;
+        }
+
+        double best_ns = 1e300, best_cycles = 1e300;
+        for (int b = 0; b < cfg->min_batches; b++) {
+            uint16_t fx[256];
+            uint32_t sink = 0;
+            double t0 = now_seconds();
+            uint64_t c0 = now_cycles();
+            for (int s = 0; s < KBENCH_BATCH; s++) {
+                kernels->share_wide(batch + (size_t)s * k, k, n, powers, fx);
+                sink += fx[s % n];
+            }
+            uint64_t c1 = now_cycles();
+            double t1 = now_seconds();
+            if (sink == 0xFFFFFFFF)
+                fputc(' ', stderr);
+            if ((t1 - t0) * 1e9 / KBENCH_BATCH < best_ns) {
+                best_ns = (t1 - t0) * 1e9 / KBENCH_BATCH;
+                best_cycles = (double)(c1 - c0) / KBENCH_BATCH;
+            }
+        }
+
+        if (mismatches > 0) {
+            fprintf(stderr, "9-bit share kernel '%s' differs from the reference for k = %d, n = %d (%d/%d cases)\n",
+                    kernels->name, k, n, mismatches, cfg->cases);
+            cfg->failures++;
+        }
+        kbench_emit(cfg, "share_wide", kernels->name, k, n, cfg->cases, mismatches, best_ns, best_cycles);
+    }
+
+cleanup:
+    free(batch);
+    free(powers);
+}
+
+// Round trip of every 9-bit interpolation kernel: shares made by ref_share_wide give back the coefficients
+static void kbench_interp_wide(KBenchConfigT *cfg, int k, uint64_t *rng)
+{
+    int n = 256;
+    uint16_t *batch = malloc((size_t)KBENCH_BATCH * k * sizeof(uint16_t));
+    if (!batch) {
+        fprintf(stderr, "Out of memory benchmarking 9-bit interpolation for k = %d\n", k);
+        cfg->failures++;
+        return;
+    }
+    for (size_t i = 0; i < (size_t)KBENCH_BATCH * k; i++)
+        batch[i] = kbench_rand(rng) % KBENCH_PRIME;
+
+    for (size_t ki = 0; ki < sss_kernels_count(); ki++) {
+        const SSSKernelsT *kernels = sss_kernels_at(ki);
+        if (kernels->level > cfg->level)
+            continue;
+        int mismatches = 0;
+        for (int c = 0; c < cfg->cases; c++) {
+            uint8_t coeffs[SSS_MAX_K], out[SSS_MAX_K];
+            uint16_t fx[256], x[SSS_MAX_K], y[SSS_MAX_K];
+            random_bytes(rng, coeffs, k);
+            ref_share_wide(coeffs, k, n, fx);
+
+            random_xs(rng, k, n, x);
+            for (int i = 0; i < k; i++)
+                y[i] = fx[x[i] - 1];
+
+            SSSInterpT interp;
+            if (!sss_interp_prepare(&interp, x, k)) {
+                mismatches++;
+                continue;
+            }
+            memset(out, 0, sizeof(out));
+            kernels->interp_wide(&interp, y, out);
+            if (memcmp(out, coeffs, k) != 0)
+                mismatches++;
+        }
+
+        uint16_t x[SSS_MAX_K];
+        random_xs(rng, k, n, x);
+        SSSInterpT interp;
+        sss_interp_prepare(&interp, x, k);
+        double best_ns = 1e300, best_cycles = 1e300;
+        for (int b = 0; b < cfg->min_batches; b++) {
+            uint8_t out[SSS_MAX_K];
+            uint32_t sink = 0;
+            double t0 = now_seconds();
+            uint64_t c0 = now_cycles();
+            for (int s = 0; s < KBENCH_BATCH; s++) {
+                kernels->interp_wide(&interp, batch + (size_t)s * k, out);
+                sink += out[0];
+            }
+            uint64_t c1 = now_cycles();
+            double t1 = now_seconds();
+            if (sink == 0xFFFFFFFF)
+                fputc(' ', stderr);
+            if ((t1 - t0) * 1e9 / KBENCH_BATCH < best_ns) {
+                best_ns = (t1 - t0) * 1e9 / KBENCH_BATCH;
+                best_cycles = (double)(c1 - c0) / KBENCH_BATCH;
+            }
+        }
+
+        if (mismatches > 0) {
+            fprintf(stderr, "9-bit interpolation '%s' differs from the reference for k = %d (%d/%d cases)\n",
+                    kernels->name, k, mismatches, cfg->cases);
+            cfg->failures++;
+        }
+        kbench_emit(cfg, "interp_wide", kernels->name, k, n, cfg->cases, mismatches, best_ns, best_cycles);
+    }
+    free(batch);
+}
+
+// Differential check and timing of every interpolation routine on shares made by ref_share
+static void kbench_interp(KBenchConfigT *cfg, const KBenchInterpT *routines, int count, int k, uint64_t *rng)
+{
+    int n = 256;
+    uint8_t *batch = malloc((size_t)KBENCH_BATCH * k);
+    if (!batch) {
+        fprintf(stderr, "Out of memory benchmarking interpolation for k = %d\n", k);
+        cfg->failures++;
+        return;
+    }
+    random_bytes(rng, batch, (size_t)KBENCH_BATCH * k);
+
+    for (int r = 0; r < count; r++) {
+        const KBenchInterpT *routine = &routines[r];
+        int cases = routine->legacy && cfg->cases > KBENCH_LEGACY_CASES ? KBENCH_LEGACY_CASES : cfg->cases;
+        int mismatches = 0;
+        for (int c = 0; c < cases; c++) {
+            uint8_t coeffs[SSS_MAX_K], y[SSS_MAX_K], out[SSS_MAX_K];
+            uint16_t fx[256], x[SSS_MAX_K];
+            random_bytes(rng, coeffs, k);
+            ref_share(coeffs, k, n, fx);
+
+            // Any k of the n shares recover the (fixed up) coefficients
+            random_xs(rng, k, n, x);
+            for (int i = 0; i < k; i++)
+                y[i] = fx[x[i] - 1];
+
+            SSSInterpT interp;
+            if (!sss_interp_prepare(&interp, x, k)) {
+                mismatches++;
+                continue;
+            }
+            memset(out, 0, sizeof(out));
+            routine->fn(&interp, y, out, routine->kernels);
+            if (memcmp(out, coeffs, routine->only_first ? 1 : k) != 0)
+                mismatches++;
+        }
+
+        // Timing uses a fixed, prepared set of coordinates; preparation is not part of a section
+        uint16_t x[SSS_MAX_K];
+        random_xs(rng, k, n, x);
+        SSSInterpT interp;
+        sss_interp_prepare(&interp, x, k);
+        double best_ns = 1e300, best_cycles = 1e300;
+        for (int b = 0; b < cfg->min_batches; b++) {
+            uint8_t out[SSS_MAX_K];
+            uint32_t sink = 0;
+            int s = 0;
+            double t0 = now_seconds();
+            uint64_t c0 = now_cycles();
+            while (s < KBENCH_BATCH) {
+                // Check the clock every 16 sections only, so fast kernels are not measured with it
+                for (int end = s + 16; s < end; s++) {
+                    routine->fn(&interp, batch + (size_t)s * k, out, routine->kernels);
+                    sink += out[0];
+                }
+                if (routine->legacy && now_seconds() - t0 > KBENCH_BATCH_SECONDS)
+                    break;
+            }
+            uint64_t c1 = now_cycles();
+            double t1 = now_seconds();
+            if (sink == 0xFFFFFFFF)
+                fputc(' ', stderr);
+            if ((t1 - t0) * 1e9 / s < best_ns) {
+                best_ns = (t1 - t0) * 1e9 / s;
+                best_cycles = (double)(c1 - c0) / s;
+            }
+        }
+
+        if (mismatches > 0) {
+            fprintf(stderr, "%sinterpolation '%s' differs from the reference for k = %d (%d/%d cases)\n",
+                    routine->legacy ? "warning: legacy " : "", routine->name, k, mismatches, cases);
+            if (!routine->legacy)
+                cfg->failures++;
+        }
+        kbench_emit(cfg, "interp", routine->name, k, n, cases, mismatches, best_ns, best_cycles);
+    }
+    free(batch);
+}
+
+// Differential check and timing of the XOR and LSB kernels of every set against the scalar set
+static void kbench_bytes(KBenchConfigT *cfg, uint64_t *rng)
+{
+    const size_t max_len = 4096;
+    const SSSKernelsT *scalar = sss_kernels_at(0);
+    uint8_t *src = malloc(max_len), *cover = malloc(max_len * 8 + 64);
+    uint8_t *got = malloc(max_len * 8 + 64), *want = malloc(max_len * 8 + 64);
+    if (!src || !cover || !got || !want) {
+        fprintf(stderr, "Out of memory benchmarking byte kernels\n");
+        cfg->failures++;
+        goto cleanup;
+    }
+
+    for (size_t ki = 0; ki < sss_kernels_count(); ki++) {
+        const SSSKernelsT *kernels = sss_kernels_at(ki);
+        if (kernels->level > cfg->level)
+            continue;
+
+        const char *kinds[KBENCH_BYTE_KINDS] = {"xor", "crc32c", "embed", "extract", "embed2", "extract2", "embed4", "extract4"};
+        const unsigned lsb_bits[KBENCH_BYTE_KINDS] = {0, 0, 1, 1, 2, 2, 4, 4};
+
+        // Lengths and offsets are random, so every tail and misalignment gets covered
+        int mismatches[KBENCH_BYTE_KINDS] = {0};
+        for (int c = 0; c < cfg->cases; c++) {
+            size_t len = kbench_rand(rng) % (max_len - 64);
+            size_t off = kbench_rand(rng) % 64;
+            random_bytes(rng, src, max_len);
+            random_bytes(rng, cover, max_len * 8 + 64);
+
+            memcpy(got, cover, max_len + 64);
+            memcpy(want, cover, max_len + 64);
+            kernels->xor_bytes(got + off, src, len);
+            scalar->xor_bytes(want + off, src, len);
+            mismatches[0] += memcmp(got, want, max_len + 64) != 0;
+
+            uint32_t seed_crc = (uint32_t)kbench_rand(rng);
+            mismatches[1] += kernels->crc32c(seed_crc, src + off, len) != scalar->crc32c(seed_crc, src + off, len);
+
+            for (int kind = 2; kind < KBENCH_BYTE_KINDS; kind += 2) {
+                memcpy(got, cover, max_len * 8 + 64);
+                memcpy(want, cover, max_len * 8 + 64);
+                sss_kernels_embed(kernels, lsb_bits[kind])(got + off, src, len / 8);
+                sss_kernels_embed(scalar, lsb_bits[kind])(want + off, src, len / 8);
+                mismatches[kind] += memcmp(got, want, max_len * 8 + 64) != 0;
+
+                memset(got, 0xA5, max_len);
+                memset(want, 0xA5, max_len);
+                sss_kernels_extract(kernels, lsb_bits[kind])(cover + off, got, len / 8);
+                sss_kernels_extract(scalar, lsb_bits[kind])(cover + off, want, len / 8);
+                mismatches[kind + 1] += memcmp(got, want, max_len) != 0;
+            }
+        }
+
+        double best_ns[KBENCH_BYTE_KINDS], best_cycles[KBENCH_BYTE_KINDS];
+        for (int kind = 0; kind < KBENCH_BYTE_KINDS; kind++)
+            best_ns[kind] = best_cycles[kind] = 1e300;
+        for (int b = 0; b < cfg->min_batches; b++) {
+            for (int kind = 0; kind < KBENCH_BYTE_KINDS; kind++) {
+                double t0 = now_seconds();
+                uint64_t c0 = now_cycles();
+                if (kind == 0)
+                    kernels->xor_bytes(cover, src, max_len);
+                else if (kind == 1)
+                    got[0] = (uint8_t)kernels->crc32c(0, src, max_len);
+                else if (kind % 2 == 0)
+                    sss_kernels_embed(kernels, lsb_bits[kind])(cover, src, max_len);
+                else
+                    sss_kernels_extract(kernels, lsb_bits[kind])(cover, got, max_len);
+                uint64_t c1 = now_cycles();
+                double t1 = now_seconds();
+                if ((t1 - t0) * 1e9 / max_len < best_ns[kind]) {
+                    best_ns[kind] = (t1 - t0) * 1e9 / max_len;
+                    best_cycles[kind] = (double)(c1 - c0) / max_len;
+                }
+            }
+        }
+
+        for (int kind = 0; kind < KBENCH_BYTE_KINDS; kind++) {
+            if (mismatches[kind] > 0) {
+                fprintf(stderr, "%s kernel '%s' differs from the scalar one (%d/%d cases)\n",
+                        kinds[kind], kernels->name, mismatches[kind], cfg->cases);
+                cfg->failures++;
+            }
+            // A section here is one payload byte (8 / lsb_bits cover bytes for the LSB kernels)
+            kbench_emit(cfg, kinds[kind], kernels->name, 0, 0, cfg->cases, mismatches[kind], best_ns[kind], best_cycles[kind]);
+        }
+    }
+
+cleanup:
+    free(src);
+    free(cover);
+    free(got);
+    free(want);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--k min-max] [--cases num] [--batches num] [--seed num] [--out file]\n"
+            "  Checks every share and interpolation kernel against a scalar reference on random\n"
+            "  inputs for each k, and reports the time and cycles per section. Exits with status 1\n"
+            "  if a kernel used by recovery or distribution disagrees with the reference.\n"
+            "  Kernel sets above the CPU level (or SHAMIGO_CPU) are skipped.\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    KBenchConfigT cfg = {
+        .k_min = SSS_MIN_K,
+        .k_max = SSS_MAX_K,
+        .cases = 2000,
+        .min_batches = 20,
+        .seed = 1,
+        .out = stdout,
+        .first_result = true,
+        .level = cpu_level(),
+    };
+
+    static struct option long_options[] = {
+        {"k",       required_argument, 0, 'k'},
+        {"cases",   required_argument, 0, 'c'},
+        {"batches", required_argument, 0, 'b'},
+        {"seed",    required_argument, 0, 's'},
+        {"out",     required_argument, 0, 'o'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:c:b:s:o:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'k': {
+                char *end;
+                cfg.k_min = strtol(optarg, &end, 10);
+                cfg.k_max = (*end == '-') ? strtol(end + 1, NULL, 10) : cfg.k_min;
+                if (cfg.k_min < SSS_MIN_K || cfg.k_max > SSS_MAX_K || cfg.k_min > cfg.k_max) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            }
+            case 'c':
+                cfg.cases = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'b':
+                cfg.min_batches = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 's':
+                cfg.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'o':
+                cfg.out = fopen(optarg, "w");
+                if (!cfg.out) {
+                    perror("Could not open output file");
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    KBenchInterpT routines[2 + 8];
+    int count = 0;
+    routines[count++] = (KBenchInterpT){"lagrange_reconstruct_pixel", true, true, interp_reconstruct_pixel, NULL};
+    routines[count++] = (KBenchInterpT){"lagrange_reconstruct_coeffs", true, false, interp_reconstruct_coeffs, NULL};
+    for (size_t ki = 0; ki < sss_kernels_count() && count < (int)(sizeof(routines) / sizeof(routines[0])); ki++)
+        if (sss_kernels_at(ki)->level <= cfg.level)
+            routines[count++] = (KBenchInterpT){sss_kernels_at(ki)->name, false, false, interp_kernel, sss_kernels_at(ki)};
+
+    fprintf(cfg.out, "{\n  \"seed\": %llu,\n  \"cases\": %d,\n  \"batch\": %d,\n  \"cpu\": \"%s\",\n  \"results\": [",
+            (unsigned long long)cfg.seed, cfg.cases, KBENCH_BATCH, cpu_level_name(cfg.level));
+
+    uint64_t rng = cfg.seed ? cfg.seed : 1;
+    // The scalar CRC32C is the reference for the others, so it is checked against the standard value
+    if (sss_kernels_at(0)->crc32c(0, (const uint8_t *)"123456789", 9) != CRC32C_CHECK) {
+        fprintf(stderr, "scalar crc32c kernel gives the wrong check value\n");
+        cfg.failures++;
+    }
+    kbench_bytes(&cfg, &rng);
+    for (int k = cfg.k_min; k <= cfg.k_max; k++) {
+        kbench_share(&cfg, k, k, &rng);
+        kbench_share(&cfg, k, 256, &rng);
+        kbench_interp(&cfg, routines, count, k, &rng);
+        kbench_share_wide(&cfg, k, 256, &rng);
+        kbench_interp_wide(&cfg, k, &rng);
+        fflush(cfg.out);
+    }
+
+    fprintf(cfg.out, "\n  ]\n}\n");
+    if (cfg.out != stdout)
+        fclose(cfg.out);
+
+    if (cfg.failures > 0)
+        fprintf(stderr, "%d kernel check(s) failed\n", cfg.failures);
+    return cfg.failures > 0;
+}
+
+#undef KBENCH_PRIME
+#undef KBENCH_BATCH
+#undef KBENCH_BATCH_SECONDS
+#undef KBENCH_LEGACY_CASES
+#undef KBENCH_BYTE_KINDS
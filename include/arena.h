@@ -0,0 +1,60 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_HUGE_PAGES 0x1                   // Back blocks with huge pages when the system has them
+#define ARENA_DEFAULT_BLOCK ((size_t)2 << 20)  // One huge page on x86-64
+#define ARENA_ALIGN 64                         // Every allocation starts on a cache line
+
+typedef struct ArenaBlockT ArenaBlockT;
+
+/**
+ * Bump allocator for the working memory of one job. Allocations are never freed one by one:
+ * the whole arena goes away with arena_release, which also makes early returns leak-free.
+ * Blocks are mapped straight from the kernel, so releasing them returns the memory at once.
+ * Not thread-safe: threads working on the same job share buffers, not the arena.
+ */
+typedef struct {
+    ArenaBlockT *blocks; // Most recent block first
+    size_t block_size;
+    unsigned flags;
+} ArenaT;
+
+/**
+ * @brief Initializes an empty arena. No memory is mapped until the first allocation.
+ * @param arena The arena to initialize.
+ * @param block_size The size of the blocks to map, or 0 for ARENA_DEFAULT_BLOCK. Larger
+ *                   allocations get a block of their own.
+ * @note The arena uses the flags set with arena_set_default_flags.
+ */
+void arena_init(ArenaT *arena, size_t block_size);
+
+/**
+ * @brief Allocates uninitialized memory, aligned to ARENA_ALIGN.
+ * @return The memory, or NULL on failure. Valid until arena_release.
+ */
+void *arena_alloc(ArenaT *arena, size_t size);
+
+/**
+ * @brief Allocates zeroed memory for count elements of size bytes, aligned to ARENA_ALIGN.
+ * @return The memory, or NULL on failure or overflow. Valid until arena_release.
+ */
+void *arena_calloc(ArenaT *arena, size_t count, size_t size);
+
+/**
+ * @brief Frees everything allocated from an arena. The arena can be used again afterwards.
+ */
+void arena_release(ArenaT *arena);
+
+/**
+ * @brief Sets the flags (ARENA_*) of the arenas initialized from now on.
+ */
+void arena_set_default_flags(unsigned flags);
+
+/**
+ * @brief The flags set with arena_set_default_flags.
+ */
+unsigned arena_get_default_flags(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _BITPACK_H
+#define _BITPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BITPACK_MAX_BITS 16
+
+/**
+ * Dense packing of fixed-width values into a byte stream.
+ *
+ * Values are written MSB first, one after the other with no padding between them, and the
+ * last byte is padded with zero bits. A run of 8 values takes exactly `bits` bytes, so a
+ * stream can be packed or unpacked in independent pieces that start on a multiple of 8 values.
+ * Whole groups of 8 go through 64-bit words instead of one bit at a time; 9-bit values (shares
+ * mod 257) have a dedicated path.
+ */
+
+/**
+ * @brief Number of bytes that count values of the given width take once packed.
+ */
+static inline size_t bitpack_size(size_t count, unsigned bits)
+{
+    return (count / 8) * bits + ((count % 8) * bits + 7) / 8;
+}
+
+/**
+ * @brief Packs values into a byte stream.
+ * @param out Output buffer of bitpack_size(count, bits) bytes.
+ * @param values The values. Bits above the width are ignored.
+ * @param count The number of values.
+ * @param bits The width of each value, in [1, BITPACK_MAX_BITS].
+ */
+void bitpack_pack(uint8_t *out, const uint16_t *values, size_t count, unsigned bits);
+
+/**
+ * @brief Unpacks values from a byte stream written by bitpack_pack.
+ * @param values Output buffer of count values.
+ * @param in The packed stream, at least bitpack_size(count, bits) bytes long.
+ * @param count The number of values.
+ * @param bits The width of each value, in [1, BITPACK_MAX_BITS].
+ */
+void bitpack_unpack(uint16_t *values, const uint8_t *in, size_t count, unsigned bits);
+
+#endif
@@ -31,6 +31,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define BMP_HEADERS_SIZE 54 // File header and Win 3.x info header
+
 #pragma pack(push, 1)
 typedef struct {
     uint8_t blue;
@@ -47,6 +49,8 @@ typedef struct BmpImageT {
     uint32_t colors_used;
     void* pixels;
     uint8_t *reserved; // 4
+    size_t pixels_capacity;    // Bytes allocated for pixels, 0 if unknown
+    uint32_t palette_capacity; // Entries allocated for palette, 0 if unknown
 } BMPImageT;
 #pragma pack(pop)
 
@@ -118,6 +122,66 @@ static inline uint32_t bmp_align(uint32_t w)
     return (w + 3) & ~3;
 }
 
+/**
+ * @brief Get the size in bytes of a scanline, including the padding required by the BMP format.
+ * @param image The image to measure.
+ * @return The distance in bytes between the start of two consecutive rows.
+ */
+static inline uint32_t bmp_stride(const BMPImageT *image)
+{
+    return bmp_align(image->width * image->bpp / 8);
+}
+
+/**
+ * @brief Get the address of the first byte of a row.
+ * @param image The image to get the row from.
+ * @param y The index of the row, as stored in memory (bottom-up).
+ * @return A pointer to the row's pixel data, followed by its padding.
+ * @warning For performance reasons, this function does not check if y is within the image bounds.
+ */
+static inline uint8_t *bmp_row(const BMPImageT *image, int32_t y)
+{
+    return ((uint8_t *)image->pixels) + (size_t)y * bmp_stride(image);
+}
+
+/**
+ * Walks the pixel bytes of an image in row order, skipping the row padding.
+ * Position p of the walk is pixel (p % width, p / width), but no division is done per pixel.
+ */
+typedef struct {
+    uint8_t *row;       // Current row
+    uint32_t x;         // Byte offset of the next pixel inside the current row
+    uint32_t row_bytes; // Bytes of pixel data per row, without padding
+    uint32_t stride;    // Bytes per row, with padding
+    int32_t rows_left;  // Rows after the current one
+} BMPLinearIterT;
+
+/**
+ * @brief Starts a walk over the unpadded pixel bytes of an image.
+ * @param it The iterator to initialize.
+ * @param image The image to walk. Must stay allocated while the iterator is used.
+ * @param start Index of the first pixel byte of the walk, in unpadded row order.
+ */
+void bmp_linear_iter_init(BMPLinearIterT *it, const BMPImageT *image, size_t start);
+
+/**
+ * @brief Copies the next pixel bytes of the walk to a buffer, crossing rows as needed.
+ * @param it The iterator.
+ * @param dst Destination buffer of at least count bytes.
+ * @param count Amount of bytes to copy.
+ * @return The amount of bytes copied, smaller than count only when the image ends.
+ */
+size_t bmp_linear_read(BMPLinearIterT *it, uint8_t *dst, size_t count);
+
+/**
+ * @brief Overwrites the next pixel bytes of the walk with a buffer, crossing rows as needed.
+ * @param it The iterator.
+ * @param src Source buffer of at least count bytes.
+ * @param count Amount of bytes to copy.
+ * @return The amount of bytes written, smaller than count only when the image ends.
+ */
+size_t bmp_linear_write(BMPLinearIterT *it, const uint8_t *src, size_t count);
+
 /**
  * @brief Loads a BMP image file to memory.
  * @param filename The name of the BMP file to open.
@@ -125,6 +189,46 @@ static inline uint32_t bmp_align(uint32_t w)
  */
 BmpImage *bmp_load(const char *filename);
 
+/**
+ * @brief Loads a BMP image file into an existing image, reusing its buffers when they are large enough.
+ * @param image The image to load into: one returned by bmp_load or bmp_create, or a zeroed BmpImage.
+ * @param filename The name of the BMP file to open.
+ * @return true on success. On failure the image keeps its buffers, but its contents are undefined.
+ */
+bool bmp_load_into(BmpImage *image, const char *filename);
+
+/**
+ * @brief Loads a BMP image from a stream into an existing image, like bmp_load_into.
+ * @param image The image to load into.
+ * @param file The stream, read front to back without seeking, so it may be a pipe or stdin.
+ *             It is left just past the pixel data and is not closed.
+ * @return true on success. On failure the image keeps its buffers, but its contents are undefined.
+ */
+bool bmp_load_stream(BmpImage *image, FILE *file);
+
+/**
+ * @brief Reads the headers of a BMP file, but not its pixels, for edits of the pixel data in place.
+ * @param image The image to reshape like the file: one returned by bmp_load or bmp_create, or a
+ *              zeroed BmpImage. It gets the dimensions and reserved bytes of the file; its
+ *              palette and pixels are not read.
+ * @param fd The open file, read with pread so that its offset does not move.
+ * @param pixel_offset Receives the file offset of the first pixel byte. Pixel byte i of the
+ *                     image is at pixel_offset + i in the file.
+ * @return true on success, false on a read error or an unsupported file.
+ */
+bool bmp_load_headers_fd(BmpImage *image, int fd, uint32_t *pixel_offset);
+
+/**
+ * @brief Gives an image new dimensions, growing its buffers only when they are too small.
+ * @param image The image to reshape: one returned by bmp_load or bmp_create, or a zeroed BmpImage.
+ * @param width The new width, in pixels.
+ * @param height The new height, in pixels. Must be positive.
+ * @param colors The number of palette entries in use.
+ * @return true on success, false on invalid dimensions or allocation failure.
+ * @note 8 bpp only. The pixels, palette and reserved bytes keep whatever they held.
+ */
+bool bmp_reshape(BmpImage *image, int32_t width, int32_t height, uint32_t colors);
+
 /**
  * @brief Save a BMP image to a file.
  * @param filename The name of the file to save the BMP image to.
@@ -136,6 +240,22 @@ BmpImage *bmp_load(const char *filename);
  */
 int bmp_save(const char *filename, const BmpImage *image);
 
+/**
+ * @brief Writes a BMP image to a stream, front to back, and flushes it. The stream is not closed.
+ * @param file The stream, which may be a pipe or stdout.
+ * @param image The image to write.
+ * @return 0 on success, -1 on failure.
+ */
+int bmp_save_stream(FILE *file, const BmpImage *image);
+
+/**
+ * @brief Encodes the file and info headers that bmp_save writes before the palette and the pixels.
+ * @param image The image to describe.
+ * @param out Output buffer of BMP_HEADERS_SIZE bytes.
+ * @return The size of the whole file: headers, palette and padded pixel rows.
+ */
+uint32_t bmp_encode_headers(const BmpImage *image, uint8_t *out);
+
 /**
  * @brief Frees the memory allocated for a BMP image.
  * @param image A pointer to the BmpImage structure to free.
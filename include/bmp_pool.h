@@ -0,0 +1,80 @@
+#ifndef _BMP_POOL_H
+#define _BMP_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bmp.h"
+
+#define BMP_POOL_DEFAULT_IDLE 8 // Released images a pool keeps for reuse
+
+/**
+ * A free list of images whose buffers are reused by later loads, so a steady stream of
+ * same-sized images stops going through malloc and free (and the page faults and mmap/munmap
+ * cycles of multi-MiB buffers). Images taken from a pool are ordinary images: they may be
+ * released to any pool, or freed with bmp_unload. A pool is safe to share between threads.
+ *
+ * Every function accepts a NULL pool, and then behaves like the plain bmp.h function.
+ */
+typedef struct BMPPoolT BMPPoolT;
+
+/**
+ * @brief Creates a pool.
+ * @param max_idle The most released images kept for reuse. Further releases free the image.
+ * @return The pool, or NULL on allocation failure. Free it with bmp_pool_destroy.
+ */
+BMPPoolT *bmp_pool_create(uint32_t max_idle);
+
+/**
+ * @brief Frees a pool and the images it holds for reuse.
+ */
+void bmp_pool_destroy(BMPPoolT *pool);
+
+/**
+ * @brief Loads a BMP file into a pooled image, see bmp_load_into.
+ * @return The image, or NULL on failure.
+ */
+BmpImage *bmp_pool_load(BMPPoolT *pool, const char *filename);
+
+/**
+ * @brief Loads a BMP image from a stream into a pooled image, see bmp_load_stream.
+ * @return The image, or NULL on failure.
+ */
+BmpImage *bmp_pool_load_stream(BMPPoolT *pool, FILE *file);
+
+/**
+ * @brief Gets an 8-bit image of the given size from the pool, see bmp_reshape.
+ * @param palette The palette to copy, or NULL to zero it.
+ * @param colors The number of palette entries.
+ * @return The image, or NULL on failure. Pixels and reserved bytes are zeroed, like bmp_create.
+ */
+BmpImage *bmp_pool_create_image(BMPPoolT *pool, int32_t width, int32_t height, const BMPColorT *palette, uint32_t colors);
+
+/**
+ * @brief Copies an 8-bit image into a pooled image: pixels, palette, reserved bytes and colors used.
+ * @return The copy, or NULL on failure.
+ */
+BmpImage *bmp_pool_copy(BMPPoolT *pool, const BmpImage *image);
+
+/**
+ * @brief Hands an image back for reuse. The image must not be used afterwards.
+ */
+void bmp_pool_release(BMPPoolT *pool, BmpImage *image);
+
+/**
+ * @brief Number of images a pool had to allocate, since it was created. Images served from the
+ *        free list do not count, so in a steady state this stops growing.
+ */
+uint64_t bmp_pool_allocations(const BMPPoolT *pool);
+
+/**
+ * @brief Sets the pool distribution and recovery take their images from. NULL disables pooling.
+ *        The caller keeps ownership.
+ */
+void bmp_pool_set_default(BMPPoolT *pool);
+
+/**
+ * @brief The pool set with bmp_pool_set_default, or NULL.
+ */
+BMPPoolT *bmp_pool_get_default(void);
+
+#endif
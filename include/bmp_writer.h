@@ -0,0 +1,73 @@
+#ifndef _BMP_WRITER_H
+#define _BMP_WRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bmp.h"
+
+/**
+ * How a batch of BMP files reaches the disk. Every backend writes the same bytes as bmp_save.
+ */
+typedef enum {
+    BMP_WRITER_AUTO = 0, // io_uring when the kernel allows it, the thread pool otherwise
+    BMP_WRITER_URING,    // One io_uring submission for the whole batch
+    BMP_WRITER_THREADS,  // One pwritev per file, spread over a few threads
+    BMP_WRITER_STDIO,    // bmp_save, one file after the other
+    BMP_WRITER_MODE_COUNT
+} BMPWriterModeT;
+
+#define BMP_WRITER_FSYNC 0x1 // Flush every file of a batch to the device before returning
+
+typedef struct BMPWriterT BMPWriterT;
+
+/**
+ * @brief Creates a writer for batches of up to capacity files.
+ * @param capacity The most files a batch may hold.
+ * @param mode The backend. BMP_WRITER_URING falls back to the thread pool, with a warning,
+ *             when the kernel does not allow io_uring.
+ * @param flags A combination of BMP_WRITER_* flags.
+ * @return The writer, or NULL on allocation failure. Free it with bmp_writer_destroy.
+ */
+BMPWriterT *bmp_writer_create(uint32_t capacity, BMPWriterModeT mode, unsigned flags);
+
+/**
+ * @brief The backend a writer ended up with. Never BMP_WRITER_AUTO.
+ */
+BMPWriterModeT bmp_writer_mode(const BMPWriterT *writer);
+
+/**
+ * @brief Queues an image to be saved by the next bmp_writer_flush.
+ * @param writer The writer.
+ * @param filename The file to save the image to.
+ * @param image The image. Must stay alive and unchanged until the batch is flushed.
+ * @return false if the batch is full.
+ */
+bool bmp_writer_add(BMPWriterT *writer, const char *filename, const BmpImage *image);
+
+/**
+ * @brief Writes every queued image: the files are created and preallocated, then the headers,
+ *        palettes and pixels of the whole batch are submitted together.
+ * @param writer The writer. Its batch is empty on return, whatever the outcome.
+ * @return true if every file was written (and synced, with BMP_WRITER_FSYNC), false otherwise.
+ */
+bool bmp_writer_flush(BMPWriterT *writer);
+
+/**
+ * @brief Frees a writer. Images still queued are not written.
+ */
+void bmp_writer_destroy(BMPWriterT *writer);
+
+/**
+ * @brief The name of a backend, as accepted by --writer.
+ */
+const char *bmp_writer_mode_name(BMPWriterModeT mode);
+
+/**
+ * @brief Parses a backend name.
+ * @param name One of auto, uring, threads or stdio.
+ * @param mode Output backend.
+ * @return true if the name is known, false otherwise.
+ */
+bool bmp_writer_mode_parse(const char *name, BMPWriterModeT *mode);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _COMPRESS_H
+#define _COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define COMPRESS_LZ_MIN_MATCH 4
+#define COMPRESS_LZ_WINDOW 65535 // Farthest match offset; only that much of a dictionary is used
+
+/**
+ * Lossless codecs for the pixels of a secret, applied before the keystream scramble.
+ *
+ * RLE is PackBits: a control byte c < 128 is followed by c + 1 literal bytes, and c >= 128 by
+ * one byte repeated c - 126 times. It suits line art and scans with long flat areas.
+ *
+ * LZ is a byte-oriented LZ77 in the LZ4 style: each sequence is a token (literal length in the
+ * high nibble, match length minus COMPRESS_LZ_MIN_MATCH in the low one, 15 meaning more
+ * length bytes follow, each adding up to 255), the literals, then a little endian u16 offset
+ * and the extra match length bytes. The last sequence has literals only. Matches may reach
+ * back into a preset dictionary, as if it preceded the data.
+ */
+typedef enum {
+    COMPRESS_NONE = 0,
+    COMPRESS_RLE,
+    COMPRESS_LZ,
+    COMPRESS_CODEC_COUNT
+} CompressCodecT;
+
+/**
+ * Preset dictionary for the LZ codec, such as a page of the same document template. The
+ * same dictionary must be given to recover a secret compressed with it.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    uint32_t crc; // CRC32C of the whole dictionary, recorded in the stego metadata
+} CompressDictT;
+
+/**
+ * @brief Largest output of a codec for an input of len bytes.
+ */
+size_t compress_bound(CompressCodecT codec, size_t len);
+
+/**
+ * @brief Compresses a buffer.
+ * @param codec COMPRESS_RLE or COMPRESS_LZ.
+ * @param src The bytes to compress.
+ * @param len The amount of bytes.
+ * @param dst Output buffer of cap bytes.
+ * @param cap Size of dst. Compression stops once the output would not fit.
+ * @param dict Preset dictionary for COMPRESS_LZ, or NULL for none.
+ * @return The compressed length, or 0 if it does not fit in cap or memory is short.
+ */
+size_t compress_encode(CompressCodecT codec, const uint8_t *src, size_t len, uint8_t *dst, size_t cap,
+                       const CompressDictT *dict);
+
+/**
+ * @brief Decompresses a buffer, checking every length and offset against the buffers.
+ * @param out_len The exact length of the decompressed data.
+ * @param dict The dictionary the data was compressed with, or NULL for none.
+ * @return true if src decodes to exactly out_len bytes, false if it is corrupt.
+ */
+bool compress_decode(CompressCodecT codec, const uint8_t *src, size_t len, uint8_t *dst, size_t out_len,
+                     const CompressDictT *dict);
+
+/**
+ * @brief Parses a codec name.
+ * @param name One of none, rle or lz.
+ * @param codec Output codec.
+ * @return true if the name is known, false otherwise.
+ */
+bool compress_codec_parse(const char *name, CompressCodecT *codec);
+
+/**
+ * @brief Loads a preset dictionary from a file of any content.
+ * @return The dictionary, or NULL on failure. Free it with compress_dict_free.
+ */
+CompressDictT *compress_dict_load(const char *path);
+
+/**
+ * @brief Frees a dictionary. May be NULL.
+ */
+void compress_dict_free(CompressDictT *dict);
+
+/**
+ * @brief Sets the dictionary used by distribution and recovery.
+ * @param dict The dictionary, or NULL for none.
+ */
+void compress_dict_set_default(CompressDictT *dict);
+
+/**
+ * @brief Gets the dictionary set with compress_dict_set_default.
+ * @return The dictionary, or NULL if none is set.
+ */
+CompressDictT *compress_dict_get_default(void);
+
+#endif
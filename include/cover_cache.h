@@ -0,0 +1,56 @@
+#ifndef _COVER_CACHE_H
+#define _COVER_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bmp.h"
+
+#define COVER_CACHE_DEFAULT_MAX_BYTES ((size_t)256 << 20) // 256 MiB of decoded covers
+
+/**
+ * Decoded cover images kept in memory across jobs, for long-lived processes (see --serve).
+ * Entries are keyed by path and checked against the file's device, inode, size and times
+ * on every lookup, so an edited cover is decoded again. When the decoded images outgrow the
+ * size cap, the least recently used ones are dropped. Covers are handed out as copies taken
+ * from the default image pool, since embedding modifies them. Safe to share between threads.
+ */
+typedef struct CoverCacheT CoverCacheT;
+
+/**
+ * @brief Creates an empty cache.
+ * @param max_bytes The most bytes of decoded pixels and palettes kept.
+ * @return The cache, or NULL on allocation failure. Free it with cover_cache_destroy.
+ */
+CoverCacheT *cover_cache_create(size_t max_bytes);
+
+/**
+ * @brief Frees a cache and the images it holds. May be NULL.
+ */
+void cover_cache_destroy(CoverCacheT *cache);
+
+/**
+ * @brief Loads a cover, from the cache when its file did not change since it was decoded.
+ * @param cache The cache, or NULL to load the file into the default image pool.
+ * @param path The path of the BMP file.
+ * @return A copy the caller owns (see bmp_pool_release), or NULL on failure.
+ */
+BmpImage *cover_cache_load(CoverCacheT *cache, const char *path);
+
+/**
+ * @brief Number of loads served from memory and decoded from disk, since the cache was created.
+ */
+void cover_cache_counts(const CoverCacheT *cache, uint64_t *hits, uint64_t *misses);
+
+/**
+ * @brief Sets the cache the cover loads of distribution go through. NULL disables caching.
+ *        The caller keeps ownership.
+ */
+void cover_cache_set_default(CoverCacheT *cache);
+
+/**
+ * @brief The cache set with cover_cache_set_default, or NULL.
+ */
+CoverCacheT *cover_cache_get_default(void);
+
+#endif
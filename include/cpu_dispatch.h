@@ -0,0 +1,43 @@
+#ifndef _CPU_DISPATCH_H
+#define _CPU_DISPATCH_H
+
+#include <stdbool.h>
+
+/**
+ * Instruction set levels the hot kernels are built for, in increasing order.
+ * Every level is compiled into the binary with per-function target attributes, so the
+ * build flags stay generic and the level is picked at run time.
+ */
+typedef enum {
+    CPU_LEVEL_SCALAR = 0,
+    CPU_LEVEL_SSE42,
+    CPU_LEVEL_AVX2,
+    CPU_LEVEL_AVX512, // AVX-512 F and BW
+    CPU_LEVEL_COUNT
+} CpuLevelT;
+
+/**
+ * @brief Detects the highest level the running CPU supports.
+ */
+CpuLevelT cpu_detect_level(void);
+
+/**
+ * @brief The level the kernels run at: the detected one, unless the SHAMIGO_CPU environment
+ *        variable asks for a lower one (scalar, sse4.2, avx2 or avx512). Computed once.
+ */
+CpuLevelT cpu_level(void);
+
+/**
+ * @brief The name of a level, as accepted by SHAMIGO_CPU.
+ */
+const char *cpu_level_name(CpuLevelT level);
+
+/**
+ * @brief Parses a level name.
+ * @param name One of scalar, sse4.2, avx2 or avx512.
+ * @param level Output level.
+ * @return true if the name is known, false otherwise.
+ */
+bool cpu_level_parse(const char *name, CpuLevelT *level);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _CRC32C_H
+#define _CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC32C_CHECK 0xE3069283u // CRC32C of the ASCII string "123456789"
+
+/**
+ * @brief Extends a CRC32C (Castagnoli, reflected, as used by iSCSI and ext4) with more bytes.
+ * @param crc The CRC32C of the bytes before, or 0 for none.
+ * @param data The bytes to add.
+ * @param len The amount of bytes.
+ * @return The CRC32C of the bytes before followed by data.
+ * @note Portable slicing-by-8 implementation, the reference for the vector kernels; callers go
+ *       through the kernel set picked for this CPU (sss_kernels.h).
+ */
+uint32_t crc32c_update(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Updates the CRC32C of a string after a range of its bytes changed, reading only the range.
+ * @param crc The CRC32C of the whole string before the change.
+ * @param delta The old bytes of the range XOR the new ones.
+ * @param len The amount of bytes in the range.
+ * @param after The amount of bytes of the string after the range.
+ * @return The CRC32C of the whole string after the change, in O(len + log(after)).
+ */
+uint32_t crc32c_patch(uint32_t crc, const uint8_t *delta, size_t len, size_t after);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _KEYSTREAM_CACHE_H
+#define _KEYSTREAM_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define KSCACHE_DEFAULT_MAX_BYTES (64u << 20)  // 64 MiB
+#define KSCACHE_DEFAULT_PREFIX_LEN (1u << 20)  // 1 MiB of keystream per seed
+
+/**
+ * Persistent cache of keystream prefixes, keyed by (seed, keystream mode).
+ *
+ * The cache is a single file mapped in memory: a header, a fixed table of slots and one
+ * prefix-sized data area per slot. Slots are filled on demand and evicted in least
+ * recently used order. Since seeds are 16 bits, there are at most 65536 streams per mode.
+ * Every access holds an exclusive lock on the file, so several processes may share it.
+ */
+typedef struct KeystreamCacheT KeystreamCacheT;
+
+/**
+ * @brief Opens a keystream cache file, creating it if it does not exist.
+ * @param path The path of the cache file.
+ * @param max_bytes The size cap of the file. Determines how many seeds fit in the cache.
+ * @param prefix_len The amount of keystream bytes kept per seed.
+ * @return The opened cache, or NULL on failure.
+ * @note An existing file keeps the geometry it was created with.
+ */
+KeystreamCacheT *kscache_open(const char *path, size_t max_bytes, size_t prefix_len);
+
+/**
+ * @brief Unmaps and closes a keystream cache.
+ * @param cache The cache to close. May be NULL.
+ */
+void kscache_close(KeystreamCacheT *cache);
+
+/**
+ * @brief XORs a buffer in place with a keystream, reading the cached prefix straight from the mapping.
+ * @param cache The keystream cache.
+ * @param seed The 16-bit seed of the keystream.
+ * @param mode The keystream generator (RngptModeT).
+ * @param buf The buffer to XOR. buf[0] is XORed with the first byte of the keystream.
+ * @param size The amount of bytes to XOR. Bytes past the cached prefix are generated on the fly.
+ * @return true on success, false if the cache could not be used (buf is left untouched).
+ */
+bool kscache_xor(KeystreamCacheT *cache, uint16_t seed, uint8_t mode, uint8_t *buf, size_t size);
+
+/**
+ * @brief Sets the cache used by the keystream passes of distribution and recovery.
+ * @param cache The cache, or NULL to always generate keystreams from scratch.
+ */
+void kscache_set_default(KeystreamCacheT *cache);
+
+/**
+ * @brief Gets the cache set with kscache_set_default.
+ * @return The cache, or NULL if none is set.
+ */
+KeystreamCacheT *kscache_get_default(void);
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "bmp.h"
+#include "stego_meta.h"
 
 typedef struct
 {
@@ -28,16 +29,52 @@ bool lsb_decoder_lsb1_extract_to_buffer(uint8_t *out_shadow_data,
                                         const BMPImageT *cover);
 
 /**
- * @brief Decodes shadow data from a BMP image using LSB 1-bit method.
+ * @brief Decodes shadow data from a BMP image, with the amount of LSBs per cover byte its
+ *        metadata header records (meta->lsb_bits).
  * @param out_shadow_data Pointer to the output buffer where shadow data will be stored.
  * @param shadow_len Length of the array of shadow data to be extracted.
  * @param cover Pointer to the BMPImageT structure containing the cover image.
- * @param k The threshold number of shares required to reconstruct the image.
+ * @param meta The metadata header of this very image, read with lsb_decoder_lsb1_read_meta.
+ *             The shadow data starts right after it.
+ * @return true if the shadow data was extracted, false otherwise. With a versioned header,
+ *         false as well if the shadow data does not match the CRC32C the header records.
+ */
+bool lsb_decoder_lsb1_extract_to_buffer_extended(uint8_t *out_shadow_data,
+                                                 size_t shadow_len,
+                                                 const BMPImageT *cover,
+                                                 const StegoMetaT *meta);
+
+/**
+ * @brief Extracts a range of the shadow data of a stego image, the counterpart of
+ *        lsb_encoder_embed_shadow_range.
+ * @param cover The stego image, large enough for stego_meta_cover_bytes of the whole shadow.
+ * @param meta The metadata header of the stego image.
+ * @param seed The seed stored in the stego image (stego_meta_get_seed).
+ * @param bytes Output buffer of len bytes.
+ * @param offset Position of the range in the shadow data.
+ * @param len The amount of bytes in the range.
+ * @param crc The CRC32C of the shadow data before the range, 0 for none.
+ * @return The CRC32C of the shadow data up to the end of the range, computed in the same pass.
+ */
+uint32_t lsb_decoder_extract_shadow_range(const BMPImageT *cover, const StegoMetaT *meta, uint16_t seed,
+                                          uint8_t *bytes, size_t offset, size_t len, uint32_t crc);
+
+/**
+ * @brief Reads the metadata header hidden in the LSB prefix of a stego image.
+ * @param cover Pointer to the BMPImageT structure containing the stego image.
+ * @param meta Output metadata. Legacy images only fill in the secret's width and height.
+ * @return true if a valid header was read, false otherwise.
+ */
+bool lsb_decoder_lsb1_read_meta(const BMPImageT *cover, StegoMetaT *meta);
+
+/**
+ * @brief Reads the directory of packed secrets that follows the metadata header.
+ * @param cover The stego image.
+ * @param meta The metadata header of the stego image, read with lsb_decoder_lsb1_read_meta.
+ * @param entries Output directory of meta->entries entries.
+ * @return true if every entry was read and is valid, false otherwise.
  */
-LSBDecodeResult lsb_decoder_lsb1_extract_to_buffer_extended(uint8_t *out_shadow_data,
-                                                            size_t shadow_len,
-                                                            const BMPImageT *cover,
-                                                            int k);
+bool lsb_decoder_lsb1_read_entries(const BMPImageT *cover, const StegoMetaT *meta, StegoEntryT *entries);
 
 /**
  * @brief Extracts dimensions (width and height) of the secret image from a BMP
@@ -50,4 +87,31 @@ LSBDecodeResult lsb_decoder_lsb1_extract_to_buffer_extended(uint8_t *out_shadow_
  */
 LSBDecodeResult lsb_decoder_lsb1_get_dimensions(const BMPImageT *cover);
 
+/**
+ * @brief Extracts bytes MSB first, one bit from the LSB of each cover byte.
+ * @param cover_data The cover bytes, at least len * 8 of them.
+ * @param bytes Output buffer of len bytes.
+ * @param len The amount of bytes to extract.
+ * @note Portable implementation; the decoder goes through the kernel set picked for this CPU.
+ */
+void lsb_decoder_lsb1_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len);
+
+/**
+ * @brief Extracts bytes MSB first, two bits from the low bits of each cover byte.
+ * @param cover_data The cover bytes, at least len * 4 of them.
+ * @param bytes Output buffer of len bytes.
+ * @param len The amount of bytes to extract.
+ * @note Portable implementation; the decoder goes through the kernel set picked for this CPU.
+ */
+void lsb_decoder_lsb2_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len);
+
+/**
+ * @brief Extracts bytes high nibble first, four bits from the low bits of each cover byte.
+ * @param cover_data The cover bytes, at least len * 2 of them.
+ * @param bytes Output buffer of len bytes.
+ * @param len The amount of bytes to extract.
+ * @note Portable implementation; the decoder goes through the kernel set picked for this CPU.
+ */
+void lsb_decoder_lsb4_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len);
+
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "bmp.h"
+#include "stego_meta.h"
 
 /**
  * @brief Encodes shadow data into a BMP image using LSB 1-bit method.
@@ -23,23 +24,74 @@ bool lsb_encoder_lsb1_into_cover(const uint8_t *shadow_data,
                                  uint16_t seed);
 
 /**
- * @brief Encodes shadow data into a BMP image using LSB 1-bit method.
+ * @brief Encodes a metadata header with the LSB 1-bit method, then the shadow data with the
+ *        amount of LSBs per cover byte the header records (meta->lsb_bits).
  * @param shadow_data Pointer to the input buffer containing shadow data to be hidden.
  * @param shadow_len Length of the shadow data buffer.
  * @param cover Pointer to the BMPImageT structure containing the cover image.
- * @param seed A seed value for randomization (not used in this function).
- * @param k The threshold number of shares required to reconstruct the image.
- * @param s_width The width of the secret image to be encoded.
- * @param s_height The height of the secret image to be encoded.
+ * @param seed The seed stored in the stego image; it keys the scatter layout (meta->layout).
+ * @param meta The metadata header, hidden before the shadow data. Its shadow_crc is ignored;
+ *             the CRC32C of shadow_data is computed while embedding and stored instead.
  * @return true if the shadow data was successfully encoded into the cover image, false otherwise.
  * @note This function modifies the cover image's pixel data in-place.
+ *       The reserved bytes of the cover are not touched, see stego_meta_set_reserved.
  */
 bool lsb_encoder_lsb1_into_cover_extended(const uint8_t *shadow_data,
                                           size_t shadow_len,
                                           BMPImageT *cover,
                                           uint16_t seed,
-                                          int k,
-                                          int16_t s_width,
-                                          int16_t s_height);
+                                          const StegoMetaT *meta);
+
+/**
+ * @brief Embeds a range of the shadow data of a stego image where its metadata header puts it,
+ *        with meta->lsb_bits LSBs per cover byte and the layout of meta->layout.
+ * @param cover The stego image, large enough for stego_meta_cover_bytes of the whole shadow.
+ * @param meta The metadata header of the stego image.
+ * @param seed The seed stored in the stego image.
+ * @param bytes The bytes of the range.
+ * @param offset Position of the range in the shadow data.
+ * @param len The amount of bytes in the range.
+ * @param crc The CRC32C of the shadow data before the range, 0 for none.
+ * @return The CRC32C of the shadow data up to the end of the range, computed in the same pass.
+ * @note The metadata header is not touched; it is embedded once the CRC32C of the whole shadow
+ *       data is known.
+ */
+uint32_t lsb_encoder_embed_shadow_range(BMPImageT *cover, const StegoMetaT *meta, uint16_t seed,
+                                        const uint8_t *bytes, size_t offset, size_t len, uint32_t crc);
+
+/**
+ * @brief Embeds the directory of packed secrets right after the metadata header, with 1-bit LSB.
+ * @param cover The stego image, already holding the header and the shadow data.
+ * @param meta The metadata header of the stego image, with meta->entries entries.
+ * @param entries The directory, with this image's CRC32C of each secret's range.
+ */
+void lsb_encoder_lsb1_embed_entries(BMPImageT *cover, const StegoMetaT *meta, const StegoEntryT *entries);
+
+/**
+ * @brief Embeds bytes MSB first, one bit in the LSB of each cover byte.
+ * @param cover_data The cover bytes, at least len * 8 of them.
+ * @param bytes The bytes to embed.
+ * @param len The amount of bytes to embed.
+ * @note Portable implementation; the encoder goes through the kernel set picked for this CPU.
+ */
+void lsb_encoder_lsb1_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len);
+
+/**
+ * @brief Embeds bytes MSB first, two bits in the low bits of each cover byte.
+ * @param cover_data The cover bytes, at least len * 4 of them.
+ * @param bytes The bytes to embed.
+ * @param len The amount of bytes to embed.
+ * @note Portable implementation; the encoder goes through the kernel set picked for this CPU.
+ */
+void lsb_encoder_lsb2_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len);
+
+/**
+ * @brief Embeds bytes high nibble first, four bits in the low bits of each cover byte.
+ * @param cover_data The cover bytes, at least len * 2 of them.
+ * @param bytes The bytes to embed.
+ * @param len The amount of bytes to embed.
+ * @note Portable implementation; the encoder goes through the kernel set picked for this CPU.
+ */
+void lsb_encoder_lsb4_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len);
 
 #endif
\ No newline at end of file
@@ -6,21 +6,92 @@
 #include <stdio.h>
 #include "bmp.h"
 
+/**
+ * Keystream generators, identified by the id recorded in the stego metadata.
+ * New generators must take a new id: recovery picks the generator from it.
+ */
+typedef enum {
+    RNGPT_MODE_LCG48 = 0, // Sequential 48-bit LCG, one byte per step
+    RNGPT_MODE_CTR = 1,   // Philox4x32-10 keyed by the 16-bit seed, seekable
+    RNGPT_MODE_COUNT
+} RngptModeT;
+
+#define RNGPT_CTR_BLOCK_SIZE 16 // bytes produced per counter value
+
 void 
 rngpt_set_seed(int64_t s);
 
+uint8_t
+rngpt_next_char(void);
+
+/**
+ * @brief Gets the internal state of the LCG, so that a sequence can be resumed later.
+ * @return The current 48-bit state.
+ */
+int64_t
+rngpt_get_state(void);
+
+/**
+ * @brief Restores a state previously obtained with rngpt_get_state.
+ * @param state The 48-bit state to resume from.
+ */
+void
+rngpt_set_state(int64_t state);
+
+/**
+ * @brief Fills a caller-owned buffer with the next size bytes of the LCG keystream.
+ */
+void
+rngpt_fill_bytes(uint8_t *table, size_t size);
+
+/**
+ * @brief XORs the next size bytes of the LCG keystream into data, a chunk at a time, so no
+ *        table of the whole keystream is allocated.
+ */
+void
+rngpt_xor_stream(uint8_t *data, size_t size);
+
 uint8_t *
 rngpt_get_byte_table_noalign(size_t size);
 
 uint8_t *
 rngpt_get_byte_table_4balign(BMPImageT *image);
 
+/**
+ * @brief XORs table2 into table1, with the kernel set picked for this CPU.
+ */
 void
 rngpt_inplace_xor(uint8_t *table1, uint8_t *table2, size_t size);
 
+/**
+ * @brief Portable implementation of rngpt_inplace_xor, the reference for the vector kernels.
+ */
+void
+rngpt_xor_bytes_scalar(uint8_t *dst, const uint8_t *src, size_t size);
+
 void
 rngpt_inplace_xor_aligned(BMPImageT *image, uint8_t *table);
 
+/**
+ * @brief Generates four consecutive counter-mode keystream blocks (64 bytes).
+ * @param seed The 16-bit seed used as the generator's key.
+ * @param counter The index of the first block. Block i covers keystream bytes [16 * i, 16 * i + 16).
+ * @param out Output buffer of 4 * RNGPT_CTR_BLOCK_SIZE bytes.
+ */
+void
+rngpt_ctr_blocks4(uint16_t seed, uint64_t counter, uint8_t *out);
+
+/**
+ * @brief XORs a buffer in-place with the counter-mode keystream, starting at any position.
+ * @param buf The buffer to XOR.
+ * @param size The amount of bytes to XOR.
+ * @param seed The 16-bit seed used as the generator's key.
+ * @param offset Position in the keystream of buf[0]. Chunks of a buffer can be processed
+ *               independently by passing their own offset.
+ */
+void
+rngpt_ctr_xor(uint8_t *buf, size_t size, uint16_t seed, uint64_t offset);
+
 
 // /**
 //  * @brief Sets the seed for the pseudo-random character generator.
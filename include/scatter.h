@@ -0,0 +1,68 @@
+#ifndef _SCATTER_H
+#define _SCATTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sss_kernels.h"
+
+#define SCATTER_BLOCK 64  // Cover bytes per block: one cache line
+#define SCATTER_ROUNDS 4  // Feistel rounds
+
+/**
+ * Seeded spreading of shadow data over a cover region.
+ *
+ * The region is cut into blocks of SCATTER_BLOCK cover bytes, and the data goes through the
+ * LSB kernels block by block: logical block i is stored in physical block scatter_block(i).
+ * The permutation is a balanced Feistel network keyed by the seed, over the smallest power of
+ * four that holds every block, restricted to the region by cycle walking. Inside a block the
+ * bytes stay in order, so each block is one cache line written or read sequentially; blocks
+ * are independent of each other, so any range of them can be handled on its own.
+ */
+typedef struct {
+    uint64_t blocks;    // Physical blocks in the region
+    unsigned half_bits; // Width of each half of the Feistel domain
+    uint32_t keys[SCATTER_ROUNDS];
+} ScatterT;
+
+/**
+ * @brief Prepares the permutation of a cover region.
+ * @param scatter The permutation to fill in.
+ * @param region_len Cover bytes in the region. A partial block at the end is not used.
+ * @param seed The seed that keys the permutation.
+ */
+void scatter_init(ScatterT *scatter, size_t region_len, uint16_t seed);
+
+/**
+ * @brief Physical block that holds a logical block.
+ * @param scatter The permutation.
+ * @param block The logical block, smaller than scatter->blocks.
+ */
+uint64_t scatter_block(const ScatterT *scatter, uint64_t block);
+
+/**
+ * @brief Embeds a range of the data in the blocks of a region.
+ * @param scatter The permutation of the region.
+ * @param embed The LSB kernel for lsb_bits.
+ * @param lsb_bits Cover bits per byte carrying the data: 1, 2 or 4.
+ * @param region The first cover byte of the region.
+ * @param bytes The data to embed.
+ * @param offset Position of the first byte of the range in the whole data.
+ * @param len The amount of bytes in the range.
+ */
+void scatter_embed(const ScatterT *scatter, SSSEmbedKernelFnT embed, unsigned lsb_bits,
+                   uint8_t *region, const uint8_t *bytes, size_t offset, size_t len);
+
+/**
+ * @brief Extracts a range of the data from the blocks of a region.
+ * @param scatter The permutation of the region.
+ * @param extract The LSB kernel for lsb_bits.
+ * @param lsb_bits Cover bits per byte carrying the data: 1, 2 or 4.
+ * @param region The first cover byte of the region.
+ * @param bytes Output buffer of len bytes.
+ * @param offset Position of the first byte of the range in the whole data.
+ * @param len The amount of bytes in the range.
+ */
+void scatter_extract(const ScatterT *scatter, SSSExtractKernelFnT extract, unsigned lsb_bits,
+                     const uint8_t *region, uint8_t *bytes, size_t offset, size_t len);
+
+#endif
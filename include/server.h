@@ -0,0 +1,47 @@
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SERVER_MAX_REQUEST (64u << 10) // Largest request payload accepted
+#define SERVER_MAX_OUTPUT (1u << 20)   // Largest diagnostic output returned to a client
+
+/**
+ * Resident server over a UNIX domain socket. A request runs a command line, as if shamigo
+ * had been started with it in the client's working directory; the response carries its exit
+ * status and everything it printed. Keeping the process alive keeps the image pool, the cover
+ * cache, the keystream cache and the selected kernels warm between requests.
+ *
+ * Every message is a frame: a 32-bit payload length in network byte order, then the payload.
+ *   request:  the client's working directory and the arguments, each NUL-terminated
+ *   response: the exit status (32 bits, network byte order), then the output text
+ *
+ * One connection carries one request. Requests are served one at a time, in arrival order.
+ */
+
+/**
+ * Runs one request. argv[0] is the program name, like for main; the working directory is
+ * already the client's and stdout and stderr are captured for the response.
+ * @return The exit status of the request.
+ */
+typedef int (*ServerHandlerFnT)(int argc, char *argv[]);
+
+/**
+ * @brief Serves requests on a socket until SIGINT or SIGTERM.
+ * @param socket_path Where to create the socket. A stale socket left there is replaced.
+ * @param handler Runs each request.
+ * @return 0 after a clean shutdown, 1 if the socket could not be set up.
+ */
+int server_run(const char *socket_path, ServerHandlerFnT handler);
+
+/**
+ * @brief Sends a command line to a server and relays its output to stderr.
+ * @param socket_path The socket of the server.
+ * @param argc Number of arguments.
+ * @param argv The arguments to send, without the program name.
+ * @return The exit status of the request, or 1 if the server could not be reached.
+ */
+int server_client(const char *socket_path, int argc, char *const argv[]);
+
+#endif
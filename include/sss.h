@@ -1,6 +1,7 @@
 #ifndef _SSS_H
 #define _SSS_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,6 +9,32 @@
 #include "permutation_table.h"
 #include "bmp.h"
 
+/**
+ * Optional behaviour of the generic (k != 8) scheme. Anything recorded here that a recovery
+ * needs is stored in the stego metadata, so recovery does not take options of its own.
+ * The scheduling and I/O options (pipeline, mem_budget, writer, fsync) never change the
+ * stego images.
+ */
+typedef struct {
+    uint8_t keystream;  // RngptModeT used to scramble the secret before sharing
+    uint8_t lsb_bits;   // Cover bits per byte carrying the shadow data: 1, 2 or 4
+    uint8_t share_bits; // Bits per stored share: 8 (adjusted to fit a byte) or 9 (bit-packed, lossless)
+    bool scatter;       // Spread the shadow data over the cover in seeded blocks (scatter.h)
+    uint8_t compress;   // CompressCodecT applied to the secret's pixels before the scramble; implies
+                        // 9-bit shares, and LZ uses the default dictionary (compress_dict_set_default)
+    uint8_t stripes;    // Covers each shadow is split across, embedded and extracted in parallel (sss_stripes.h)
+    bool pipeline;      // Overlap cover reads, share computation and stego writes (sss_pipeline.h)
+    size_t mem_budget;  // Bytes of cover pixels the pipeline may hold in flight
+    uint8_t writer;     // BMPWriterModeT used to save the stego images
+    bool fsync;         // Sync the stego images to the device before returning
+} SSSOptionsT;
+
+/**
+ * @brief Fills in the default options, which produce stego images any version can recover.
+ * @param opts The options to initialize.
+ */
+void sss_options_init(SSSOptionsT *opts);
+
 /**
  * @brief Distributes a BMP image into multiple shadow images using a (k, n) threshold scheme.
  *
@@ -21,36 +48,105 @@
  * @param n Total number of shadow images to generate.
  * @param covers_dir Directory of path where the cover images are saved.
  * @param output_dir Directory path where the resulting shadow images will be saved.
+ * @param opts Distribution options, or NULL for the defaults. With k = 8 and non default options
+ *             the generic scheme is used, since the k = 8 scheme has no room for metadata.
  *
- * @return Pointer to an array of `n` BMPImageT* shadow images. Returns NULL on failure.
- *
- * @note The caller is responsible for freeing the returned BMP images. Use the `bmp_unload` function
- *       provided in bmp.h to do so.
+ * @return true if the n stego images were saved, false otherwise. On failure the image may be
+ *         left scrambled.
  */
-BMPImageT **sss_distribute(
+bool sss_distribute(
     BMPImageT *image,
     uint32_t k,
     uint32_t n,
     const char *covers_dir,
-    const char *output_dir
+    const char *output_dir,
+    const SSSOptionsT *opts
 );
 
+/**
+ * @brief Distributes several secrets into the same n stego images.
+ *
+ * The secrets are packed back to back, each starting on a group of 8 sections, and shared as
+ * one payload; each one is scrambled with its own keystream and, with opts->compress,
+ * compressed on its own. A directory after the metadata header records each secret's size,
+ * codec, place in the payload and the CRC32C of its range of each shadow, so that
+ * `sss_recover_entry` extracts and interpolates that range alone.
+ *
+ * @param images Array of `count` secret images. Their pixels are left as they are.
+ * @param count The amount of secrets, 1 to STEGO_META_MAX_ENTRIES. A single secret is
+ *              distributed by `sss_distribute`.
+ * @param opts Distribution options, or NULL for the defaults. A pack always uses the generic
+ *             scheme, and opts->pipeline is ignored.
+ * @return true if the n stego images were saved, false otherwise.
+ */
+bool sss_distribute_many(
+    BMPImageT **images,
+    uint32_t count,
+    uint32_t k,
+    uint32_t n,
+    const char *covers_dir,
+    const char *output_dir,
+    const SSSOptionsT *opts
+);
 
 /**
  * @brief Recovers the original BMP image from a set of shadow images.
  *
  * This function reconstructs the original image using any `k` shadow images
- * generated from a previous call to `sss_distribute`. If fewer than `k` valid shadows
- * are provided, the function may return corrupted or incomplete data.
+ * generated from a previous call to `sss_distribute`. Given more than `k`, the first `k`
+ * are checked against the others on a sample of sections; when they disagree, the stego
+ * images that are corrupt or foreign are located on the same sample and left out, and
+ * `k` that agree are used instead. Images failing their CRC32C are left out from the start.
  *
- * @param shadows Array of at least `k` pointers to BMPImageT shadow images.
+ * @param shadows Array of `count` pointers to BMPImageT shadow images.
+ * @param count The amount of shadow images, at least `k`.
  * @param k The minimum number of shadows required to reconstruct the image.
- * @param recovered_filename Pointer to the filename where the recovered secret will be saved.
  *
  * @return Pointer to the recovered BMPImageT image, or NULL on failure or invalid input.
+ *         It is not saved anywhere: see bmp_save and bmp_save_stream.
  *
  * @note The caller is responsible for freeing the returned BMP images. Use the `bmp_unload` function
  *       provided in bmp.h to do so.
+ * @note Locating one bad image takes at least `k + 2` of them; with `k + 1` a disagreement is
+ *       detected but not located, and with exactly `k` only the CRC32C is checked.
+ * @note A secret compressed with a dictionary (opts->compress) is only decompressed with the
+ *       same dictionary set as the default (compress_dict_set_default).
+ */
+BMPImageT *sss_recover(BMPImageT **shadows, uint32_t count, uint32_t k);
+/**
+ * @brief Recovers one secret of stego images made by `sss_distribute_many`.
+ *
+ * Only the secret's range of each shadow is extracted, checked against the CRC32C of the
+ * image's directory and interpolated. Otherwise it works like `sss_recover`, which packed
+ * stego images refuse.
+ *
+ * @param index The secret's place in the pack, from 0. Stego images of a single secret hold
+ *              secret 0.
+ * @return Pointer to the recovered BMPImageT image, or NULL on failure or invalid input.
+ */
+BMPImageT *sss_recover_entry(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t index);
+/**
+ * @brief Adds one share to an existing set, without the secret and without touching the others.
+ *
+ * The k polynomials of every section are implied by any `k` of the shadow images, so the
+ * share at a new x is the Lagrange basis of their x coordinates evaluated at it, applied to
+ * their values. It is hidden in `cover` with the header and seed of the others, and saved as
+ * `stego<x>.bmp` in `output_dir`. Like `sss_recover`, shadows past the first `k` check them
+ * and stand in for corrupt ones.
+ *
+ * @param shadows Array of `count` pointers to BMPImageT shadow images of the same distribution.
+ * @param count The amount of shadow images, at least `k`.
+ * @param k The minimum number of shadows required to reconstruct the image.
+ * @param x The x coordinate of the new share, 1 to 256, used by none of the shadows.
+ * @param cover The cover image of the new share. Its pixels are overwritten.
+ * @param output_dir Directory of the new stego image, usually the one of the others.
+ * @param opts Options for the writer (opts->writer, opts->fsync). The other options are taken
+ *             from the shadows.
+ *
+ * @return true if the new stego image was saved, false otherwise.
+ *
+ * @note With byte shares (no `--packed`), a section whose share at x would be 256 cannot be
+ *       fixed up without changing the existing shares; it is stored as 255 and reported.
  */
-BMPImageT *sss_recover(BMPImageT **shadows, uint32_t k, const char * recovered_filename);
+bool sss_extend(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts);
 #endif
\ No newline at end of file
@@ -1,18 +1,164 @@
 #ifndef _SSS_ALGOS_H
 #define _SSS_ALGOS_H
 #include "bmp.h"
+#include "sss.h"
 #include "sss_helpers.h"
 #include "permutation_table.h"
 #include "lsb_decoder.h"
 #include "lsb_encoder.h"
+#include "stego_meta.h"
+#include "keystream_cache.h"
+#include "arena.h"
 
-typedef BMPImageT **(*DistributeFnT)(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir);
-typedef BMPImageT *(*RecoverFnT)(BMPImageT **shadows, uint32_t k, const char * recovered_filename);
+/**
+ * Precomputed Lagrange weights for a fixed set of shadow x coordinates.
+ * Row c holds the coefficients of every basis polynomial at degree c, so recovering
+ * the k coefficients of a section is a k x k matrix-vector product mod 257.
+ */
+typedef struct {
+    int k;
+    uint16_t x[SSS_MAX_K];
+    uint16_t w[SSS_MAX_K][SSS_MAX_K];
+} SSSInterpT;
 
-BMPImageT **sss_distribute_8(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir);
-BMPImageT **sss_distribute_generic(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir);
+typedef bool (*DistributeFnT)(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts);
+typedef BMPImageT *(*RecoverFnT)(BMPImageT **shadows, uint32_t count, uint32_t k);
+typedef bool (*ExtendFnT)(BMPImageT **shadows, uint32_t count, uint32_t k, uint16_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts);
 
-BMPImageT *sss_recover_8(BMPImageT **shadows, uint32_t k, const char * recovered_filename);
-BMPImageT *sss_recover_generic(BMPImageT **shadows, uint32_t k, const char * recovered_filename);
+bool sss_distribute_8(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts);
+bool sss_distribute_generic(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts);
+bool sss_distribute_pack(BMPImageT **images, uint32_t count, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts);
+
+BMPImageT *sss_recover_8(BMPImageT **shadows, uint32_t count, uint32_t k);
+BMPImageT *sss_recover_generic(BMPImageT **shadows, uint32_t count, uint32_t k);
+BMPImageT *sss_recover_pack_entry(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t index);
+
+bool sss_extend_8(BMPImageT **shadows, uint32_t count, uint32_t k, uint16_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts);
+bool sss_extend_generic(BMPImageT **shadows, uint32_t count, uint32_t k, uint16_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts);
+
+/**
+ * @brief Computes the n shadows of a secret image with the generic (k, n) scheme.
+ * @param Q The scrambled secret image.
+ * @param shadows Optional array of n images that also receive each shadow as pixels. May be NULL.
+ * @param k The threshold number of shares required to reconstruct the image.
+ * @param n The total number of shadows to generate.
+ * @param share_bits STEGO_META_SHARE_BYTE for one byte per section, or STEGO_META_SHARE_PACKED
+ *                   for exact 9-bit shares packed with bitpack_pack.
+ * @param shadow_data Output array of n pointers. Each is set to a buffer of
+ *                    ceil(width * height / k) shares (stego_meta_shadow_bytes), allocated from arena.
+ * @param arena The job arena the shadow buffers and the share tables are allocated from.
+ *              They stay valid until the caller releases it.
+ * @return true on success, false otherwise.
+ */
+bool sss_distribute_share_image_k(const BMPImageT *Q, BMPImageT **shadows, int k, int n, unsigned share_bits, uint8_t **shadow_data, ArenaT *arena);
+
+/**
+ * @brief Shares a run of sections, reading their coefficients from a linear iterator.
+ * @param it Iterator over the scrambled secret, positioned at the first pixel of section first.
+ *           Left at the first pixel after the run.
+ * @param powers Table built by sss_share_powers_create for the same k and n.
+ * @param shadow_data The n shadow buffers. Receives bytes [first, first + count) of each.
+ * @param first Index of the first section of the run.
+ * @param count Number of sections in the run.
+ */
+void sss_share_sections(BMPLinearIterT *it, int k, int n, const uint16_t *powers, uint8_t **shadow_data, size_t first, size_t count);
+
+/**
+ * @brief Shares a run of sections like sss_share_sections, with exact 9-bit shares.
+ * @param shadow_data The n packed shadow buffers (bitpack_pack, 9 bits per share). Receives the
+ *                    shares of sections [first, first + count) of each.
+ * @param first Index of the first section of the run. A multiple of 8, so that the run starts
+ *              on a byte of the packed shadows.
+ */
+void sss_share_sections_packed(BMPLinearIterT *it, int k, int n, const uint16_t *powers, uint8_t **shadow_data, size_t first, size_t count);
+
+/**
+ * @brief XORs the padded pixel buffer of an image with the keystream of the given seed.
+ * @param image The image to scramble (or unscramble) in place.
+ * @param seed The 16-bit keystream seed.
+ * @param mode The keystream generator (RngptModeT).
+ * @return The same image.
+ */
+BMPImageT *sss_distribute_initial_xor_inplace(BMPImageT *image, uint16_t seed, uint8_t mode);
+
+/**
+ * @brief Builds the table of powers x^j mod 257 for x = 1..n and j = 0..k-1.
+ * @return A row-major n x SSS_MAX_K table, or NULL on allocation failure. Must be freed by the caller.
+ */
+uint16_t *sss_share_powers_create(int k, int n);
+
+/**
+ * @brief Evaluates the section polynomial at x = 1..n, making sure no share equals 256.
+ *
+ * When a share hits 256, the first non-zero coefficient is decreased by one, as the scheme
+ * requires, until every share fits in a byte.
+ *
+ * @param coeffs The k section coefficients. May be modified by the overflow fixup.
+ * @param k The threshold number of shares required to reconstruct the image.
+ * @param n The number of shares to evaluate.
+ * @param powers Table built by sss_share_powers_create for the same k and n.
+ * @param fx Output buffer of n shares, all in [0, 255] on return.
+ */
+void sss_share_section(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx);
+
+/**
+ * @brief Evaluates the section polynomial at x = 1..n, keeping shares equal to 256.
+ *
+ * Used when the shares are stored in 9 bits: the coefficients are never adjusted, so the
+ * secret is recovered exactly.
+ *
+ * @param coeffs The k section coefficients.
+ * @param k The threshold number of shares required to reconstruct the image.
+ * @param n The number of shares to evaluate.
+ * @param powers Table built by sss_share_powers_create for the same k and n.
+ * @param fx Output buffer of n shares, in [0, 256].
+ */
+void sss_share_section_wide(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx);
+
+/**
+ * @brief The overflow fixup of sss_share_section, for kernels that evaluate the shares themselves.
+ * @param coeffs The k section coefficients, decreased as the scheme requires.
+ * @param fx The n shares of coeffs, at least one of them equal to 256. All in [0, 255] on return.
+ */
+void sss_share_fix_overflow(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx);
+
+/**
+ * @brief Number of times a share evaluated to 256 and its section had to be adjusted,
+ *        accumulated over every distribution run by this process.
+ */
+uint64_t sss_get_overflow_fixups(void);
+
+/**
+ * @brief Precomputes the interpolation weights for the given x coordinates in O(k^2).
+ * @param interp Output weights.
+ * @param x The x coordinates of the k shadows, all distinct mod 257.
+ * @param k The threshold number of shares required to reconstruct the image.
+ * @return true on success, false if k is out of range or two coordinates are repeated.
+ */
+bool sss_interp_prepare(SSSInterpT *interp, const uint16_t *x, int k);
+
+/**
+ * @brief Recovers the k polynomial coefficients of one section from its k shadow values.
+ * @param interp Weights obtained with sss_interp_prepare.
+ * @param y The shadow values of the section, in the same order as the x coordinates.
+ * @param out_coeffs Output buffer of k coefficients.
+ */
+void sss_interp_coeffs(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs);
+
+/**
+ * @brief Recovers the k polynomial coefficients of one section from 9-bit shadow values.
+ * @param interp Weights obtained with sss_interp_prepare.
+ * @param y The shadow values of the section, in [0, 256].
+ * @param out_coeffs Output buffer of k coefficients.
+ */
+void sss_interp_coeffs_wide(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs);
+
+/**
+ * Earlier interpolation routines, which solve every section from scratch. They are kept as
+ * references for shamigo_kbench; recovery goes through sss_interp_prepare and sss_interp_coeffs.
+ */
+uint16_t modinv(int a, int p);
+uint8_t lagrange_reconstruct_pixel(uint8_t *y, uint16_t *x, int k);
+void lagrange_reconstruct_coeffs(const uint8_t *y, const uint16_t *x, int k, uint8_t *out_coeffs);
 
 #endif
\ No newline at end of file
@@ -27,12 +27,14 @@ typedef bool (*BMPFilterFunc)(const BMPImageT *bmp, const char *path, void *cont
 bool sssh_8bit_lsb_into_cover(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed);
 
 /**
- * Hide an array of packets of k bits of data inside a cover image using 1bit LSB steganography
- * @param shadow_data The array of data packets to hide.
+ * Hide an array of packets of k bits of data inside a cover image using 1bit LSB steganography.
+ * The packets are bit-packed (see bitpack.h): n packets take bitpack_size(n, k) bytes, that is
+ * k bits each, instead of a whole byte or two each.
+ * @param shadow_data The array of data packets to hide. Bits above the k low ones are ignored.
  * @param shadow_len The amount of packets expected to be hidden.
  * @param cover The cover image where the data will be hidden.
- * @param seed The seed used to generate the pseudo-random table.
- * @param k The number of bits to use for hiding (1-10).
+ * @param seed The seed used to generate the pseudo-random table (not used).
+ * @param k The number of bits of each packet (1-16).
  * @param s_width The width of the secret image.
  * @param s_height The height of the secret image.
  * 
@@ -41,7 +43,7 @@ bool sssh_8bit_lsb_into_cover(const uint8_t *shadow_data, size_t shadow_len, BMP
  * @note The width and height are stored in the first 4 bytes of the cover image, with
  *       the width in the first 2 bytes and the height in the next 2 bytes.
  */
-bool sssh_lsb1_into_cover_k(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed, int k, int16_t s_width, int16_t s_height);
+bool sssh_lsb1_into_cover_k(const uint16_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed, int k, int16_t s_width, int16_t s_height);
 
 /**
  * Check if a BMP image has enough capacity to hide a given amount of bits.
@@ -52,12 +54,41 @@ bool sssh_lsb1_into_cover_k(const uint8_t *shadow_data, size_t shadow_len, BMPIm
  */
 bool sssh_can_hide_bits(const BMPImageT *cover, size_t bits_needed);
 
+/**
+ * Extract an array of data hidden with sssh_8bit_lsb_into_cover.
+ * @param out_shadow_data Output buffer of shadow_len bytes.
+ * @param shadow_len The amount of bytes expected to be hidden.
+ * @param cover The stego image.
+ *
+ * @return true if the data was extracted, false otherwise.
+ */
 bool extract_shadow_lsb_to_buffer(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover);
 
-LSBDecodeResultT sssh_extract_lsb1_kshadow(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover, int k);
+/**
+ * Extract an array of packets of k bits hidden with sssh_lsb1_into_cover_k.
+ * @param out_shadow_data Output buffer of shadow_len packets.
+ * @param shadow_len The amount of packets expected to be hidden.
+ * @param cover The stego image.
+ * @param k The number of bits of each packet (1-16).
+ *
+ * @return The dimensions of the secret image; result is false if the packets could not be extracted.
+ */
+LSBDecodeResultT sssh_extract_lsb1_kshadow(uint16_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover, int k);
 
+/**
+ * Read the dimensions of the secret image hidden by sssh_lsb1_into_cover_k.
+ * @param cover The stego image.
+ *
+ * @return The dimensions of the secret image; result is false if the cover is too small.
+ */
 LSBDecodeResultT sssh_extract_kshadow_dimensions(const BMPImageT *cover);
 
+/**
+ * Whether a directory entry is a regular file with a .bmp extension, which is what
+ * load_bmp_images considers.
+ */
+bool sssh_is_bmp_entry(const struct dirent *entry);
+
 /**
  * Loads up to `max_images` .bmp files from a directory, applying an optional filter.
  *
@@ -66,13 +97,15 @@ LSBDecodeResultT sssh_extract_kshadow_dimensions(const BMPImageT *cover);
  * @param filter A callback function to validate/filter images, or NULL to accept all.
  * @param context An optional context passed to the filter.
  *
- * @return An array of BMPImageT pointers (must be freed), or NULL on failure.
+ * @return An array of BMPImageT pointers (must be freed, see free_bmp_images), or NULL on failure.
+ *         The images are taken from the default image pool, if any.
  */
 BMPImageT **load_bmp_images(const char *dir_path, uint32_t max_images, BMPFilterFunc filter, void *context);
 
 
 /**
  * Frees an array of BMPImageT pointers previously allocated by load_bmp_images.
+ * The images go back to the default image pool, if any (see bmp_pool.h).
  *
  * @param images Array of BMPImageT pointers.
  * @param n Number of cover images in the array.
@@ -0,0 +1,115 @@
+#ifndef _SSS_KERNELS_H
+#define _SSS_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sss_algos.h"
+#include "cpu_dispatch.h"
+#include "crc32c.h"
+
+/**
+ * @brief Evaluates one section polynomial at x = 1..n, with the overflow fixup of sss_share_section.
+ * @param coeffs The k section coefficients. May be modified by the overflow fixup.
+ * @param powers Table built by sss_share_powers_create for the same k and n.
+ * @param fx Output buffer of n shares, all in [0, 255] on return.
+ */
+typedef void (*SSSShareKernelFnT)(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx);
+
+/**
+ * @brief Recovers the k coefficients of one section, with the semantics of sss_interp_coeffs.
+ */
+typedef void (*SSSInterpKernelFnT)(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs);
+
+/**
+ * @brief Evaluates one section polynomial at x = 1..n with shares in [0, 256], with the
+ *        semantics of sss_share_section_wide.
+ */
+typedef void (*SSSShareWideKernelFnT)(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx);
+
+/**
+ * @brief Recovers the k coefficients of one section from shares in [0, 256], with the
+ *        semantics of sss_interp_coeffs_wide.
+ */
+typedef void (*SSSInterpWideKernelFnT)(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs);
+
+/**
+ * @brief XORs size bytes of src into dst, with the semantics of rngpt_inplace_xor.
+ */
+typedef void (*SSSXorKernelFnT)(uint8_t *dst, const uint8_t *src, size_t size);
+
+/**
+ * @brief Extends a CRC32C with len bytes, with the semantics of crc32c_update.
+ */
+typedef uint32_t (*SSSCrcKernelFnT)(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Embeds len bytes MSB first in the low b bits of len * 8 / b cover bytes, with the
+ *        semantics of lsb_encoder_lsb<b>_embed_bytes for b = 1, 2 or 4.
+ */
+typedef void (*SSSEmbedKernelFnT)(uint8_t *cover_data, const uint8_t *bytes, size_t len);
+
+/**
+ * @brief Extracts len bytes MSB first from the low b bits of len * 8 / b cover bytes, with the
+ *        semantics of lsb_decoder_lsb<b>_extract_bytes for b = 1, 2 or 4.
+ */
+typedef void (*SSSExtractKernelFnT)(const uint8_t *cover_data, uint8_t *bytes, size_t len);
+
+/**
+ * A set of implementations of the hot kernels for one instruction set level. Every set must
+ * produce exactly the same output as the scalar one (the first entry of the registry) for
+ * every input; shamigo_kbench checks it.
+ */
+typedef struct {
+    const char *name;
+    CpuLevelT level; // Minimum level the CPU must support to run the set
+    SSSShareKernelFnT share_section;
+    SSSInterpKernelFnT interp_coeffs;
+    SSSXorKernelFnT xor_bytes;
+    SSSEmbedKernelFnT lsb1_embed;
+    SSSExtractKernelFnT lsb1_extract;
+    SSSEmbedKernelFnT lsb2_embed;     // Pair spread
+    SSSExtractKernelFnT lsb2_extract; // Pair gather
+    SSSEmbedKernelFnT lsb4_embed;     // Nibble spread
+    SSSExtractKernelFnT lsb4_extract; // Nibble gather
+    SSSShareWideKernelFnT share_wide;   // 9-bit shares, no overflow fixup
+    SSSInterpWideKernelFnT interp_wide; // 9-bit shares
+    SSSCrcKernelFnT crc32c;             // Integrity tag of the shadow data
+} SSSKernelsT;
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SSS_KERNELS_X86 1
+extern const SSSKernelsT sss_kernels_sse42;
+extern const SSSKernelsT sss_kernels_avx2;
+extern const SSSKernelsT sss_kernels_avx512;
+#endif
+
+/**
+ * @brief Number of kernel sets compiled into this binary.
+ */
+size_t sss_kernels_count(void);
+
+/**
+ * @brief Gets a kernel set from the registry.
+ * @param index Index in [0, sss_kernels_count()). Index 0 is always the scalar set.
+ * @return The kernel set, or NULL if the index is out of range.
+ */
+const SSSKernelsT *sss_kernels_at(size_t index);
+
+/**
+ * @brief The kernel set of the highest level not above cpu_level(). Resolved once.
+ */
+const SSSKernelsT *sss_kernels_active(void);
+
+/**
+ * @brief The embed kernel of a set for 1, 2 or 4 LSBs per cover byte.
+ * @return The kernel, or NULL if lsb_bits is not a supported mode.
+ */
+SSSEmbedKernelFnT sss_kernels_embed(const SSSKernelsT *kernels, unsigned lsb_bits);
+
+/**
+ * @brief The extract kernel of a set for 1, 2 or 4 LSBs per cover byte.
+ * @return The kernel, or NULL if lsb_bits is not a supported mode.
+ */
+SSSExtractKernelFnT sss_kernels_extract(const SSSKernelsT *kernels, unsigned lsb_bits);
+
+#endif
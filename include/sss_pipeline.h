@@ -0,0 +1,43 @@
+#ifndef _SSS_PIPELINE_H
+#define _SSS_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bmp.h"
+#include "stego_meta.h"
+
+#define SSS_PIPELINE_DEFAULT_BUDGET ((size_t)256 << 20)
+#define SSS_PIPELINE_BLOCK_SECTIONS 65536 // Sections shared between two progress updates, a multiple of 8
+
+/**
+ * A distribution run split in three overlapping stages:
+ *  - a reader thread scans the covers directory and loads suitable covers in order,
+ *  - the calling thread shares the secret in blocks of SSS_PIPELINE_BLOCK_SECTIONS sections,
+ *  - a writer thread embeds each shadow in its cover as its blocks become ready, then saves it.
+ * Covers are handed from the reader to the writer through a bounded queue: the reader stops
+ * loading while the covers in flight hold mem_budget bytes of pixels or more.
+ * The stego images are byte for byte the ones the sequential distribution writes.
+ */
+typedef struct {
+    const BMPImageT *image; // The scrambled secret
+    uint32_t k;
+    uint32_t n;
+    uint16_t seed;
+    const StegoMetaT *meta; // Header hidden before each shadow, or NULL for the k = 8 layout
+    const char *covers_dir;
+    const char *output_dir;
+    size_t mem_budget;      // Bytes of cover pixels the reader may keep in flight
+    uint8_t writer;         // BMPWriterModeT used to save the stego images
+    unsigned writer_flags;  // BMP_WRITER_* flags
+} SSSPipelineJobT;
+
+/**
+ * @brief Shares the secret of a job and writes its n stego images, overlapping I/O and compute.
+ * @param job The job to run.
+ * @return true if every stego image was written, false otherwise. Stego images written before
+ *         a failure are left in the output directory.
+ */
+bool sss_pipeline_distribute(const SSSPipelineJobT *job);
+
+#endif
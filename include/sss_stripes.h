@@ -0,0 +1,42 @@
+#ifndef _SSS_STRIPES_H
+#define _SSS_STRIPES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bmp.h"
+#include "stego_meta.h"
+
+#define SSS_STRIPES_MAX_THREADS 8
+
+/**
+ * One stripe of a shadow and the stego image holding it (see stego_meta.h). A shadow split in
+ * stripes only needs covers of stego_meta_cover_bytes of a stripe, and the stripes of all the
+ * shadows are embedded or extracted in parallel, each in its own cover.
+ */
+typedef struct {
+    BMPImageT *cover; // The cover (embedding) or the stego image (extraction)
+    StegoMetaT meta;  // Header of the stripe, with its index and length
+    uint8_t *data;    // The stripe's bytes of the shadow data, meta.stripe_len of them
+    uint16_t seed;    // Seed of the distribution
+    uint16_t x;       // x coordinate of the shadow, stored in the cover when embedding
+    bool ok;          // Whether the stripe was embedded, or extracted and passed its CRC32C
+} SSSStripeT;
+
+/**
+ * @brief Embeds every stripe in its cover, with its header, seed and x.
+ * @param stripes The stripes, each with a distinct cover.
+ * @param count The amount of stripes.
+ * @return true if every stripe was embedded, false otherwise. stripes[i].ok tells which.
+ */
+bool sss_stripes_embed(SSSStripeT *stripes, uint32_t count);
+
+/**
+ * @brief Extracts every stripe from its stego image and checks its CRC32C.
+ * @param stripes The stripes, with the header read from each stego image and a destination
+ *                of meta.stripe_len bytes. Destinations must not overlap.
+ * @param count The amount of stripes.
+ * @return true if every stripe was extracted, false otherwise. stripes[i].ok tells which.
+ */
+bool sss_stripes_extract(SSSStripeT *stripes, uint32_t count);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _SSS_UPDATE_H
+#define _SSS_UPDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bmp.h"
+#include "sss.h"
+
+#define SSS_UPDATE_CHUNK_SECTIONS 4096 // Sections shared and patched at a time, a multiple of 8
+
+/**
+ * @brief Updates the stego images of a directory in place for a new version of their secret.
+ *
+ * Sections are runs of k pixels and each share has a fixed place in its cover, so only the
+ * sections where the two secrets differ are shared again, with the seed of the stego images,
+ * and only the cover bytes carrying them are read and written back (pread and pwrite), along
+ * with the header, whose CRC32C is patched from the changed bytes alone. The rest of each file
+ * is not read.
+ *
+ * Every change is made in memory before any file is written. The shares of the old secret
+ * are computed for the changed sections too and must be the ones each stego image holds, so a
+ * stale old secret, like a read error, leaves the stego images untouched.
+ *
+ * @param old_secret The secret the stego images hold now, the same size. It is scrambled in place.
+ * @param new_secret The new secret. It is scrambled in place.
+ * @param k The threshold the stego images were distributed with.
+ * @param dir Directory of the stego images. Every stego image of the set must be there: one
+ *            left elsewhere keeps the old sections and no longer agrees with the others.
+ * @param opts Options of the run; only opts->fsync is used.
+ * @return true if every stego image was updated, false otherwise. Only a write error can leave
+ *         the set half updated: the files are written one after the other, so those before the
+ *         failed one hold the new secret, those after it the old one, and the failed one, which
+ *         fails its CRC32C, neither. This is reported on stderr.
+ */
+bool sss_update(BMPImageT *old_secret, BMPImageT *new_secret, uint32_t k, const char *dir, const SSSOptionsT *opts);
+
+#endif
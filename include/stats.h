@@ -0,0 +1,89 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Stages of a distribution or recovery run, in pipeline order.
+ * Stages may nest (a directory scan loads images, for instance); time is always charged to
+ * the innermost stage, so the per-stage times add up to the instrumented part of the run.
+ * Stages nest per thread. When stages run concurrently (see --pipeline) their times add up to
+ * more than the wall time.
+ */
+typedef enum {
+    STATS_SCAN = 0, // Directory scans and cover selection
+    STATS_LOAD,     // bmp_load
+    STATS_COMPRESS, // Compression of the secret before sharing, decompression after recovery
+    STATS_XOR,      // Keystream scramble and unscramble
+    STATS_SHARE,    // Polynomial evaluation of the shares
+    STATS_EMBED,    // LSB embedding of the shares into the covers
+    STATS_EXTRACT,  // LSB extraction of the shares from the stego images
+    STATS_INTERP,   // Lagrange interpolation of the sections
+    STATS_SAVE,     // bmp_save
+    STATS_STAGE_COUNT
+} StatsStageT;
+
+typedef enum {
+    STATS_FORMAT_TABLE = 0,
+    STATS_FORMAT_JSON
+} StatsFormatT;
+
+typedef struct {
+    uint64_t ns;            // Monotonic time spent in the stage, excluding nested stages
+    uint64_t calls;         // Times the stage was entered
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t sections;      // Sections of k pixels processed
+    uint64_t retries;       // Share overflow fixups (f(x) == 256)
+    long peak_rss_kb;       // Peak resident set size of the process when the stage last ended
+} StatsStageInfoT;
+
+/**
+ * @brief Starts collecting statistics. Until this is called every stats_* call is a no-op.
+ */
+void stats_enable(void);
+
+/**
+ * @brief Stops collecting statistics, so a later stats_enable starts from zero.
+ */
+void stats_disable(void);
+
+/**
+ * @brief Whether statistics are being collected.
+ */
+bool stats_enabled(void);
+
+/**
+ * @brief Enters a stage. Must be paired with stats_end for the same stage.
+ * @param stage The stage being entered.
+ */
+void stats_begin(StatsStageT stage);
+
+/**
+ * @brief Leaves the innermost stage, charging it the time elapsed since stats_begin.
+ * @param stage The stage being left.
+ */
+void stats_end(StatsStageT stage);
+
+void stats_add_bytes_read(StatsStageT stage, uint64_t bytes);
+void stats_add_bytes_written(StatsStageT stage, uint64_t bytes);
+void stats_add_sections(StatsStageT stage, uint64_t sections);
+void stats_add_retries(StatsStageT stage, uint64_t retries);
+
+/**
+ * @brief Gets the counters collected for a stage.
+ * @param stage The stage to query.
+ * @return The counters of the stage. Valid until the next stats_* call.
+ */
+const StatsStageInfoT *stats_get(StatsStageT stage);
+
+/**
+ * @brief Prints the collected statistics, one row (or JSON object) per stage plus the totals.
+ * @param out The stream to print to.
+ * @param format Either a human readable table or a single JSON document.
+ */
+void stats_print(FILE *out, StatsFormatT format);
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef _STEGO_META_H
+#define _STEGO_META_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bmp.h"
+
+#define SSS_MIN_K 2
+#define SSS_MAX_K 64
+#define SSS_MAX_N 256 // x = 1..n stay distinct and non-zero mod 257
+
+#define STEGO_META_VERSION 1
+#define STEGO_META_LEGACY_SIZE 4  // width and height, 2 bytes each
+#define STEGO_META_PEEK_SIZE 6    // bytes needed to know the size of a versioned header
+#define STEGO_META_SIZE 31        // versioned header, in bytes
+#define STEGO_META_MAX_SIZE 64    // upper bound for the serialized header, in bytes
+#define STEGO_META_ENTRY_SIZE 21  // serialized directory entry, in bytes
+#define STEGO_META_MAX_ENTRIES 255
+#define STEGO_META_MAX_STRIPES 255
+
+#define STEGO_META_SHARE_BYTE 8   // One byte per share; a section is adjusted when a share hits 256
+#define STEGO_META_SHARE_PACKED 9 // Exact 9-bit shares, bit-packed (bitpack.h); recovery is lossless
+
+#define STEGO_META_LAYOUT_SEQUENTIAL 0 // Shadow data right after the header, in order
+#define STEGO_META_LAYOUT_SCATTER 1    // Shadow data spread over the cover in seeded blocks (scatter.h)
+
+/**
+ * Flag stored in the high byte of the x coordinate (reserved[3]) of a stego image.
+ * When set, the LSB prefix of the cover holds a versioned header after width and height.
+ * Shadow x coordinates never exceed 256, so the bit is free in every stego image.
+ */
+#define STEGO_META_RESERVED_EXTENDED 0x80
+
+/**
+ * Metadata hidden in the LSB prefix of every stego image.
+ *
+ * Wire layout (big endian, embedded with 1-bit LSB before the shadow data):
+ *   u16 s_width | u16 s_height                  -- legacy header (version 0), then for version 1:
+ *   u8 version | u8 size | u8 k                 -- size is the total header length, STEGO_META_SIZE
+ *   u8 keystream                                -- a RngptModeT
+ *   u8 lsb_bits                                 -- 1, 2 or 4
+ *   u8 share_bits                               -- 8 or 9
+ *   u8 layout                                   -- STEGO_META_LAYOUT_*
+ *   u32 shadow_crc                              -- CRC32C of the shadow data
+ *   u8 compress | u32 payload_len | u32 dict_crc -- a CompressCodecT, the compressed length and
+ *                                                  the dictionary's CRC32C
+ *   u8 entries                                  -- secrets packed in the shadow data
+ *   u8 stripes | u8 stripe | u32 stripe_len     -- covers each shadow is split across, this
+ *                                                  cover's stripe and its length
+ *
+ * The header itself always takes the LSB of 8 cover bytes per byte; the shadow data after it
+ * takes the lsb_bits low bits of 8 / lsb_bits cover bytes per byte, MSB first. With 9-bit
+ * shares the shadow data is the bitpack_pack stream of the shares, in section order.
+ * With the scatter layout, the shadow data starts at the first SCATTER_BLOCK boundary after
+ * the header, and its blocks are permuted over the rest of the cover with the image's seed.
+ * The CRC32C covers the shadow data bytes (before LSB embedding), so it differs between the
+ * stego images of one distribution; extraction rejects a shadow whose CRC32C does not match.
+ * A compressed secret is shared as the payload_len bytes of its compressed pixels instead of
+ * its s_width * s_height pixels, and decompressed to that size once recovered.
+ *
+ * With more than one entry, a directory of StegoEntryT follows the header, also with 1-bit LSB,
+ * and the shadow data holds payload_len bytes of secrets packed back to back (sss_distribute_many);
+ * the header's own size and compression fields are then unused.
+ *
+ * With more than one stripe, each stego image carries one stripe of its shadow: the shadow data
+ * is cut in `stripes` runs of stego_meta_stripe_len bytes, and this image's run is embedded as if
+ * it were the whole shadow data, with its own CRC32C. The stego images of a shadow share its x.
+ */
+typedef struct {
+    uint16_t s_width;
+    uint16_t s_height;
+    uint8_t version;     // 0 when the image only carries width and height
+    uint8_t k;           // 0 when unknown (legacy images)
+    uint8_t keystream;   // RngptModeT used to scramble the secret
+    uint8_t lsb_bits;    // Cover bits per byte carrying shadow data; 1 for legacy images
+    uint8_t share_bits;  // STEGO_META_SHARE_BYTE or STEGO_META_SHARE_PACKED; 8 for legacy images
+    uint8_t layout;      // STEGO_META_LAYOUT_*; sequential for legacy images
+    uint32_t shadow_crc; // CRC32C of this image's shadow data; see stego_meta_has_crc
+    uint8_t compress;    // CompressCodecT of the secret's pixels; none for legacy images
+    uint32_t payload_len; // Bytes of compressed pixels, 0 when not compressed
+    uint32_t dict_crc;   // CRC32C of the LZ dictionary, 0 when none was used
+    uint8_t entries;     // Secrets packed in the shadow data; 1 for legacy images
+    uint8_t stripes;     // Stego images each shadow is split across; 1 for legacy images
+    uint8_t stripe;      // This image's stripe, from 0
+    uint32_t stripe_len; // Bytes of shadow data in this image's stripe, 0 when not striped
+} StegoMetaT;
+
+/**
+ * Directory entry of one secret packed with others.
+ *
+ * Wire layout (big endian):
+ *   u16 s_width | u16 s_height | u8 compress | u32 dict_crc | u32 offset | u32 payload_len | u32 shadow_crc
+ *
+ * The secret's payload_len bytes (its pixels, or their compressed form) start at byte offset of
+ * the packed payload, a multiple of 8 * k so that its shares start on a byte of the shadow data
+ * with either share width. Its shadow_crc covers only its own range of the shadow data.
+ */
+typedef struct {
+    uint16_t s_width;
+    uint16_t s_height;
+    uint8_t compress;     // CompressCodecT of the secret's pixels
+    uint32_t dict_crc;    // CRC32C of the LZ dictionary, 0 when none was used
+    uint32_t offset;      // First byte of the secret in the packed payload
+    uint32_t payload_len; // Bytes of the secret in the packed payload
+    uint32_t shadow_crc;  // CRC32C of the secret's range of this image's shadow data
+} StegoEntryT;
+
+/**
+ * @brief Initializes a metadata header with the current version for a secret of the given size.
+ * @param meta The metadata structure to fill.
+ * @param s_width The width of the secret image.
+ * @param s_height The height of the secret image.
+ * @param k The threshold number of shares required to reconstruct the image.
+ */
+void stego_meta_init(StegoMetaT *meta, uint16_t s_width, uint16_t s_height, uint8_t k);
+
+/**
+ * @brief Size in bytes of the serialized header.
+ * @param meta The metadata to measure.
+ * @return The amount of bytes the header takes once serialized. Each byte takes 8 cover bytes.
+ */
+size_t stego_meta_size(const StegoMetaT *meta);
+
+/**
+ * @brief Whether a number of LSBs per cover byte is one the shadow data can be embedded with.
+ */
+static inline bool stego_meta_lsb_bits_valid(unsigned lsb_bits)
+{
+    return lsb_bits == 1 || lsb_bits == 2 || lsb_bits == 4;
+}
+
+/**
+ * @brief Whether a share width is one the shadow data can be stored with.
+ */
+static inline bool stego_meta_share_bits_valid(unsigned share_bits)
+{
+    return share_bits == STEGO_META_SHARE_BYTE || share_bits == STEGO_META_SHARE_PACKED;
+}
+
+/**
+ * @brief Whether the header carries the CRC32C of the shadow data, which legacy headers lack.
+ */
+static inline bool stego_meta_has_crc(const StegoMetaT *meta)
+{
+    return meta->version != 0;
+}
+
+/**
+ * @brief Whether two headers describe shadows of the same distribution. The CRC32C and the
+ *        stripe, which are specific to each stego image, are not compared.
+ */
+bool stego_meta_compatible(const StegoMetaT *a, const StegoMetaT *b);
+
+/**
+ * @brief Whether a layout is one the shadow data can be embedded with.
+ */
+static inline bool stego_meta_layout_valid(unsigned layout)
+{
+    return layout == STEGO_META_LAYOUT_SEQUENTIAL || layout == STEGO_META_LAYOUT_SCATTER;
+}
+
+/**
+ * @brief Number of shadow data bytes that hold the shares of the first sections of a shadow.
+ * @param meta The metadata, whose share_bits sets the width of each share.
+ * @param sections The number of sections. With 9-bit shares, a multiple of 8 or all of them.
+ */
+size_t stego_meta_shadow_bytes(const StegoMetaT *meta, size_t sections);
+
+/**
+ * @brief Size in bytes of the directory after the header, 0 unless secrets are packed.
+ */
+static inline size_t stego_meta_dir_size(const StegoMetaT *meta)
+{
+    return meta->entries > 1 ? (size_t)meta->entries * STEGO_META_ENTRY_SIZE : 0;
+}
+
+/**
+ * @brief Number of bytes of the secret that are shared: its pixels, their compressed form, or
+ *        the whole packed payload.
+ */
+size_t stego_meta_payload_len(const StegoMetaT *meta);
+
+/**
+ * @brief Length in bytes of the shadow data of each stego image.
+ * @param meta The metadata, with the secret's size or payload length, k and the width of each share.
+ */
+size_t stego_meta_shadow_len(const StegoMetaT *meta);
+
+/**
+ * @brief Offset of a stripe in the shadow data. Every stripe but the last is the same length.
+ * @param meta The metadata, with the shadow length and the number of stripes.
+ * @param stripe The stripe, from 0 to meta->stripes - 1.
+ */
+size_t stego_meta_stripe_offset(const StegoMetaT *meta, uint32_t stripe);
+
+/**
+ * @brief Length in bytes of a stripe of the shadow data, the whole of it without stripes.
+ * @param meta The metadata, with the shadow length and the number of stripes.
+ * @param stripe The stripe, from 0 to meta->stripes - 1.
+ * @return The length, 0 when the shadow data is too short for that many stripes.
+ */
+size_t stego_meta_stripe_len(const StegoMetaT *meta, uint32_t stripe);
+
+/**
+ * @brief Offset of the cover region holding the shadow data, in cover bytes.
+ * @param meta The metadata, whose size, directory and layout set where the shadow data starts.
+ */
+size_t stego_meta_shadow_offset(const StegoMetaT *meta);
+
+/**
+ * @brief Number of cover bytes a stego image needs for the header and the shadow data.
+ * @param meta The metadata, whose lsb_bits sets how densely the shadow data is packed and
+ *             whose layout may round the shadow data up to whole blocks.
+ * @param shadow_len Length of the shadow data in bytes.
+ */
+size_t stego_meta_cover_bytes(const StegoMetaT *meta, size_t shadow_len);
+
+/**
+ * @brief Serializes a metadata header.
+ * @param meta The metadata to serialize.
+ * @param out Output buffer, at least STEGO_META_MAX_SIZE bytes long.
+ * @return The amount of bytes written to out.
+ */
+size_t stego_meta_serialize(const StegoMetaT *meta, uint8_t *out);
+
+/**
+ * @brief Reads the total header size from the first bytes of a serialized header.
+ * @param buf The beginning of the serialized header.
+ * @param len The amount of bytes available in buf. At least STEGO_META_PEEK_SIZE.
+ * @param extended Whether the stego image was flagged as carrying a versioned header.
+ * @return The size of the whole header in bytes, or 0 if it is invalid.
+ */
+size_t stego_meta_peek_size(const uint8_t *buf, size_t len, bool extended);
+
+/**
+ * @brief Parses a serialized metadata header.
+ * @param buf The serialized header, as long as reported by stego_meta_peek_size.
+ * @param len The amount of bytes available in buf.
+ * @param extended Whether the stego image was flagged as carrying a versioned header.
+ * @param meta Output metadata. Legacy headers only fill in the width and height; the rest is
+ *             zeroed, except lsb_bits which is 1, share_bits which is 8, and entries and
+ *             stripes which are 1.
+ * @return true if the header was parsed successfully, false otherwise.
+ */
+bool stego_meta_parse(const uint8_t *buf, size_t len, bool extended, StegoMetaT *meta);
+
+/**
+ * @brief Serializes a directory entry.
+ * @param out Output buffer of STEGO_META_ENTRY_SIZE bytes.
+ */
+void stego_entry_serialize(const StegoEntryT *entry, uint8_t *out);
+
+/**
+ * @brief Parses a directory entry.
+ * @param buf The serialized entry, STEGO_META_ENTRY_SIZE bytes.
+ * @return true if the entry was parsed successfully, false otherwise.
+ */
+bool stego_entry_parse(const uint8_t *buf, StegoEntryT *entry);
+
+/**
+ * @brief Stores the seed and the shadow's x coordinate in the reserved bytes of a stego image.
+ * @param cover The stego image. Its reserved buffer must be allocated.
+ * @param seed The seed used for the keystream.
+ * @param x The x coordinate at which the shadow was evaluated.
+ * @param extended Whether the LSB prefix holds a versioned header.
+ */
+void stego_meta_set_reserved(BMPImageT *cover, uint16_t seed, uint16_t x, bool extended);
+
+static inline uint16_t stego_meta_get_seed(const BMPImageT *cover)
+{
+    return cover->reserved[0] | (cover->reserved[1] << 8);
+}
+
+static inline uint16_t stego_meta_get_x(const BMPImageT *cover)
+{
+    return cover->reserved[2] | ((cover->reserved[3] & ~STEGO_META_RESERVED_EXTENDED) << 8);
+}
+
+static inline bool stego_meta_is_extended(const BMPImageT *cover)
+{
+    return (cover->reserved[3] & STEGO_META_RESERVED_EXTENDED) != 0;
+}
+
+#endif
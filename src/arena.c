@@ -0,0 +1,137 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS, MAP_HUGETLB and MADV_HUGEPAGE
+#include "../include/arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ARENA_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+struct ArenaBlockT
+{
+    ArenaBlockT *next;
+    size_t size; // Bytes mapped, this header included
+    size_t used; // Bytes handed out, this header included
+};
+
+static unsigned gl_arena_default_flags = 0;
+
+static size_t arena_round_up(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+static ArenaBlockT *arena_map_block(size_t size, unsigned flags)
+{
+    void *map = MAP_FAILED;
+    if (flags & ARENA_HUGE_PAGES)
+    {
+        size = arena_round_up(size, ARENA_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        // Reserved huge pages first; most systems have none, and then transparent ones are asked for
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    }
+    else
+    {
+        size = arena_round_up(size, (size_t)sysconf(_SC_PAGESIZE));
+    }
+
+    if (map == MAP_FAILED)
+    {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (flags & ARENA_HUGE_PAGES)
+            madvise(map, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    ArenaBlockT *block = map;
+    block->next = NULL;
+    block->size = size;
+    block->used = arena_round_up(sizeof(ArenaBlockT), ARENA_ALIGN);
+    return block;
+}
+
+void arena_init(ArenaT *arena, size_t block_size)
+{
+    arena->blocks = NULL;
+    arena->block_size = block_size > 0 ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->flags = gl_arena_default_flags;
+}
+
+void *arena_alloc(ArenaT *arena, size_t size)
+{
+    size = arena_round_up(size > 0 ? size : 1, ARENA_ALIGN);
+
+    ArenaBlockT *block = arena->blocks;
+    if (block == NULL || block->size - block->used < size)
+    {
+        size_t header = arena_round_up(sizeof(ArenaBlockT), ARENA_ALIGN);
+        size_t needed = header + size;
+        if (needed < header)
+            return NULL;
+
+        ArenaBlockT *fresh = arena_map_block(needed > arena->block_size ? needed : arena->block_size, arena->flags);
+        if (fresh == NULL)
+        {
+            fprintf(stderr, "Out of memory: Failed to map an arena block of %zu bytes\n", needed);
+            return NULL;
+        }
+
+        // A block of its own for a large allocation keeps the current block open for small ones
+        if (block != NULL && needed > arena->block_size)
+        {
+            fresh->next = block->next;
+            block->next = fresh;
+        }
+        else
+        {
+            fresh->next = block;
+            arena->blocks = fresh;
+        }
+        block = fresh;
+    }
+
+    void *ptr = (uint8_t *)block + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void *arena_calloc(ArenaT *arena, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+        return NULL;
+
+    void *ptr = arena_alloc(arena, count * size);
+    if (ptr != NULL)
+        memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void arena_release(ArenaT *arena)
+{
+    ArenaBlockT *block = arena->blocks;
+    while (block != NULL)
+    {
+        ArenaBlockT *next = block->next;
+        munmap(block, block->size);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
+
+void arena_set_default_flags(unsigned flags)
+{
+    gl_arena_default_flags = flags;
+}
+
+unsigned arena_get_default_flags(void)
+{
+    return gl_arena_default_flags;
+}
+
+#undef ARENA_HUGE_PAGE_SIZE
@@ -0,0 +1,102 @@
+#include "../include/bitpack.h"
+#include <string.h>
+
+static inline void bitpack_store_be64(uint8_t *out, uint64_t word)
+{
+    word = __builtin_bswap64(word);
+    memcpy(out, &word, sizeof(word));
+}
+
+static inline uint64_t bitpack_load_be64(const uint8_t *in)
+{
+    uint64_t word;
+    memcpy(&word, in, sizeof(word));
+    return __builtin_bswap64(word);
+}
+
+/*
+ * Eight 9-bit values are 72 bits: the top 8 bits of the first value, then a 64-bit word with
+ * its last bit followed by the other seven values. Building the word is a handful of shifts
+ * and ors, and one byte swap puts it in stream order.
+ */
+static inline void bitpack_pack9_group(uint8_t *out, const uint16_t *v)
+{
+    uint64_t word = (uint64_t)(v[0] & 0x001) << 63 | (uint64_t)(v[1] & 0x1FF) << 54 |
+                    (uint64_t)(v[2] & 0x1FF) << 45 | (uint64_t)(v[3] & 0x1FF) << 36 |
+                    (uint64_t)(v[4] & 0x1FF) << 27 | (uint64_t)(v[5] & 0x1FF) << 18 |
+                    (uint64_t)(v[6] & 0x1FF) << 9 | (uint64_t)(v[7] & 0x1FF);
+    out[0] = (v[0] >> 1) & 0xFF;
+    bitpack_store_be64(out + 1, word);
+}
+
+static inline void bitpack_unpack9_group(uint16_t *v, const uint8_t *in)
+{
+    uint64_t word = bitpack_load_be64(in + 1);
+    v[0] = (uint16_t)(in[0] << 1 | word >> 63);
+    v[1] = (word >> 54) & 0x1FF;
+    v[2] = (word >> 45) & 0x1FF;
+    v[3] = (word >> 36) & 0x1FF;
+    v[4] = (word >> 27) & 0x1FF;
+    v[5] = (word >> 18) & 0x1FF;
+    v[6] = (word >> 9) & 0x1FF;
+    v[7] = word & 0x1FF;
+}
+
+// Any width, through a bit accumulator; only its low `held` bits are meaningful
+static void bitpack_pack_bits(uint8_t *out, const uint16_t *values, size_t count, unsigned bits)
+{
+    uint32_t mask = (1u << bits) - 1;
+    uint64_t acc = 0;
+    unsigned held = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        acc = acc << bits | (values[i] & mask);
+        held += bits;
+        while (held >= 8)
+        {
+            held -= 8;
+            *out++ = (uint8_t)(acc >> held);
+        }
+    }
+    if (held > 0)
+        *out = (uint8_t)(acc << (8 - held));
+}
+
+static void bitpack_unpack_bits(uint16_t *values, const uint8_t *in, size_t count, unsigned bits)
+{
+    uint32_t mask = (1u << bits) - 1;
+    uint64_t acc = 0;
+    unsigned held = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        while (held < bits)
+        {
+            acc = acc << 8 | *in++;
+            held += 8;
+        }
+        held -= bits;
+        values[i] = (uint16_t)((acc >> held) & mask);
+    }
+}
+
+void bitpack_pack(uint8_t *out, const uint16_t *values, size_t count, unsigned bits)
+{
+    size_t i = 0;
+    if (bits == 9)
+    {
+        for (; i + 8 <= count; i += 8, out += 9)
+            bitpack_pack9_group(out, values + i);
+    }
+    bitpack_pack_bits(out, values + i, count - i, bits);
+}
+
+void bitpack_unpack(uint16_t *values, const uint8_t *in, size_t count, unsigned bits)
+{
+    size_t i = 0;
+    if (bits == 9)
+    {
+        for (; i + 8 <= count; i += 8, in += 9)
+            bitpack_unpack9_group(values + i, in);
+    }
+    bitpack_unpack_bits(values + i, in, count - i, bits);
+}
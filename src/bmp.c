@@ -1,4 +1,7 @@
 #include "../include/bmp.h"
+#include "../include/stats.h"
+#include <errno.h>
+#include <unistd.h>
 #define CHECK_HEADER_RESERVED(a, b, c, d) (a == 0 && b == 0 && c == 0 && d == 0)
 
 #pragma pack(push, 1)
@@ -34,78 +37,52 @@ typedef struct
 } Win3xBmpImageData;
 #pragma pack(pop)
 
-bool is_readable_bmp(FILE *file)
+/**
+ * @brief Checks that the headers describe an image this module can read.
+ */
+static bool bmp_check_headers(const BitmapFileHeader *fheader, const BitmapInfoHeader *iheader)
 {
-    BitmapFileHeader fheader;
-    BitmapInfoHeader iheader;
-
-    // Attempt to read file header
-    fread(&fheader, sizeof(BitmapFileHeader), 1, file);
-    if (ferror(file))
-    {
-        perror("Error reading file header");
-        rewind(file);
-        return false;
-    }
-
     // Check BMP signature
-    if (fheader.signature[0] != 'B' || fheader.signature[1] != 'M')
+    if (fheader->signature[0] != 'B' || fheader->signature[1] != 'M')
     {
         fprintf(stderr, "Invalid BMP signature\n");
-        rewind(file);
-        return false;
-    }
-
-    // Attempt to read info header
-    fread(&iheader, sizeof(BitmapInfoHeader), 1, file);
-    if (ferror(file))
-    {
-        perror("Error reading info header");
-        rewind(file);
         return false;
     }
 
     // Check header size (Win3.x format)
-    if (iheader.dib_header_size != sizeof(BitmapInfoHeader))
+    if (iheader->dib_header_size != sizeof(BitmapInfoHeader))
     {
-        fprintf(stderr, "Unsupported DIB header size: %u\n", iheader.compression);
-        rewind(file);
+        fprintf(stderr, "Unsupported DIB header size: %u\n", iheader->dib_header_size);
         return false;
     }
 
     // Only support 8-bit images
-    if (iheader.bpp != 8)
+    if (iheader->bpp != 8)
     {
-        fprintf(stderr, "Unsupported bits per pixel: %u\n", iheader.bpp);
-        rewind(file);
+        fprintf(stderr, "Unsupported bits per pixel: %u\n", iheader->bpp);
         return false;
     }
 
     // Only support uncompressed images
-    if (iheader.compression != 0)
+    if (iheader->compression != 0)
     {
-        fprintf(stderr, "Unsupported compression type: %u\n", iheader.compression);
-        rewind(file);
+        fprintf(stderr, "Unsupported compression type: %u\n", iheader->compression);
         return false;
     }
 
     // Only support bottom-up images
-    if (iheader.height < 0)
+    if (iheader->height < 0)
     {
         fprintf(stderr, "Unsupported image orientation: Top-down\n");
-        rewind(file);
         return false;
     }
 
-    if (iheader.width <= 0 || abs(iheader.height) <= 0)
+    if (iheader->width <= 0 || abs(iheader->height) <= 0)
     {
-        fprintf(stderr, "Invalid image dimensions: %d x %d\n", iheader.width, abs(iheader.height));
-        rewind(file);
+        fprintf(stderr, "Invalid image dimensions: %d x %d\n", iheader->width, abs(iheader->height));
         return false;
     }
 
-    // All checks passed
-    rewind(file);
     return true;
 }
 
@@ -142,6 +119,8 @@ BMPImageT *bmp_copy(BMPImageT *image)
     copy->width = image->width;
     copy->height = image->height;
     copy->bpp = image->bpp;
+    copy->colors_used = image->colors_used;
+    copy->reserved = NULL;
 
     uint32_t palette_size = (image->bpp <= 8) ? ((1 << image->bpp) * sizeof(BMPColorT)) : 0;
     copy->palette = malloc(palette_size);
@@ -152,6 +131,7 @@ BMPImageT *bmp_copy(BMPImageT *image)
         return NULL;
     }
     memcpy(copy->palette, image->palette, palette_size);
+    copy->palette_capacity = palette_size / sizeof(BMPColorT);
 
     uint32_t bytes_per_pixel = image->bpp / 8;
     // Each scanline must be aligned to a 4-byte boundary as per BMP format
@@ -167,6 +147,19 @@ BMPImageT *bmp_copy(BMPImageT *image)
         return NULL;
     }
     memcpy(copy->pixels, image->pixels, image_size);
+    copy->pixels_capacity = image_size;
+
+    copy->reserved = calloc(4, 1);
+    if (copy->reserved == NULL)
+    {
+        fprintf(stderr, "bmp_copy: Error allocating memory for reserved bytes\n");
+        free(copy->pixels);
+        free(copy->palette);
+        free(copy);
+        return NULL;
+    }
+    if (image->reserved != NULL)
+        memcpy(copy->reserved, image->reserved, 4);
 
     return copy;
 }
@@ -221,13 +214,23 @@ BmpImage *bmp_create(int32_t width, int32_t height, uint8_t bpp, BMPColorT *pale
     image->height = height;
     image->bpp = bpp;
 
+    // Standard reserved bytes, so that the image can be saved right away
+    image->reserved = calloc(4, 1);
+    if (image->reserved == NULL)
+    {
+        fprintf(stderr, "bmp_create: Error allocating memory for reserved bytes\n");
+        goto error_clean_image;
+    }
+
     uint32_t new_pcolors = (1 << bpp);
+    image->colors_used = new_pcolors;
     image->palette = calloc(new_pcolors, sizeof(BMPColorT));
     if (image->palette == NULL)
     {
         fprintf(stderr, "bmp_create: Error allocating memory for palette\n");
-        goto error_clean_image;
+        goto error_clean_reserved;
     }
+    image->palette_capacity = new_pcolors;
 
     bool can_copy_palette = pcolors > 0 && pcolors <= new_pcolors;
     if (!can_copy_palette)
@@ -243,7 +246,7 @@ BmpImage *bmp_create(int32_t width, int32_t height, uint8_t bpp, BMPColorT *pale
     // 4-byte alignment for pixel scanline, required by BMP spec
     uint32_t bytes_per_pixel = bpp / 8;
     uint32_t bytes_per_scanline = (width * bytes_per_pixel + 3) & ~3;
-    uint32_t image_size = bytes_per_scanline * abs(height); // height can be negative!
+    size_t image_size = (size_t)bytes_per_scanline * abs(height); // height can be negative!
 
     image->pixels = calloc(image_size, 1);
     if (image->pixels == NULL)
@@ -251,174 +254,249 @@ BmpImage *bmp_create(int32_t width, int32_t height, uint8_t bpp, BMPColorT *pale
         fprintf(stderr, "bmp_create: Error allocating memory for pixel data\n");
         goto error_clean_palette;
     }
+    image->pixels_capacity = image_size;
 
     return image;
 
 error_clean_palette:
     free(image->palette);
     image->palette = NULL;
+error_clean_reserved:
+    free(image->reserved);
+    image->reserved = NULL;
 error_clean_image:
     free(image);
     image = NULL;
     return NULL;
 }
 
-BmpImage *bmp_load(const char *filename)
+bool bmp_reshape(BmpImage *image, int32_t width, int32_t height, uint32_t colors)
 {
-    FILE *file = fopen(filename, "rb");
+    if (width <= 0 || height <= 0)
+    {
+        fprintf(stderr, "bmp_reshape: Invalid image dimensions: %d x %d\n", width, height);
+        return false;
+    }
 
-    if (file == NULL)
+    if (image->reserved == NULL)
     {
-        perror("Error opening file");
-        return NULL;
+        image->reserved = calloc(4, 1);
+        if (image->reserved == NULL)
+        {
+            fprintf(stderr, "bmp_reshape: Error allocating memory for reserved bytes\n");
+            return false;
+        }
     }
 
-    BmpImage *image = malloc(sizeof(BmpImage));
+    // Always room for a full 8-bit palette, which bmp_copy_palette reads
+    uint32_t palette_entries = colors > 256 ? colors : 256;
+    if (image->palette == NULL || image->palette_capacity < palette_entries)
+    {
+        free(image->palette);
+        image->palette_capacity = 0;
+        image->palette = calloc(palette_entries, sizeof(BMPColorT));
+        if (image->palette == NULL)
+        {
+            fprintf(stderr, "bmp_reshape: Error allocating memory for palette\n");
+            return false;
+        }
+        image->palette_capacity = palette_entries;
+    }
 
-    if (image == NULL)
+    // The old pixels are never needed, so a larger buffer is allocated rather than reallocated
+    size_t image_size = (size_t)bmp_align(width) * height;
+    if (image->pixels == NULL || image->pixels_capacity < image_size)
     {
-        perror("Error allocating memory");
-        goto cleanup_file;
+        free(image->pixels);
+        image->pixels_capacity = 0;
+        image->pixels = malloc(image_size);
+        if (image->pixels == NULL)
+        {
+            fprintf(stderr, "bmp_reshape: Error allocating memory for pixel data\n");
+            return false;
+        }
+        image->pixels_capacity = image_size;
     }
 
-    if (!is_readable_bmp(file))
+    image->width = width;
+    image->height = height;
+    image->bpp = 8;
+    image->colors_used = colors;
+    return true;
+}
+
+/**
+ * @brief Discards bytes of a stream by reading them, so pipes can be skipped through too.
+ */
+static bool bmp_skip(FILE *file, size_t count)
+{
+    uint8_t scratch[512];
+    while (count > 0)
     {
-        fprintf(stderr, "Invalid BMP file\n");
-        goto cleanup_image;
+        size_t chunk = count < sizeof(scratch) ? count : sizeof(scratch);
+        if (fread(scratch, 1, chunk, file) != chunk)
+            return false;
+        count -= chunk;
     }
+    return true;
+}
 
+/**
+ * @brief Reads a BMP image front to back: headers, palette, then pixels. Never seeks.
+ */
+static bool bmp_read_stream(BmpImage *image, FILE *file)
+{
     BitmapFileHeader fheader;
     BitmapInfoHeader iheader;
-    fread(&fheader, sizeof(BitmapFileHeader), 1, file);
-    if (ferror(file))
+    if (fread(&fheader, sizeof(BitmapFileHeader), 1, file) != 1)
     {
-        perror("Error reading file header");
-        goto cleanup_image;
+        fprintf(stderr, "Error reading file header: %s\n", ferror(file) ? strerror(errno) : "Unexpected end of file");
+        return false;
     }
 
-    fread(&iheader, sizeof(BitmapInfoHeader), 1, file);
-    if (ferror(file))
+    if (fread(&iheader, sizeof(BitmapInfoHeader), 1, file) != 1)
     {
-        perror("Error reading info header");
-        goto cleanup_image;
+        fprintf(stderr, "Error reading info header: %s\n", ferror(file) ? strerror(errno) : "Unexpected end of file");
+        return false;
     }
 
-    uint32_t palette_entries = iheader.colors_used ? iheader.colors_used : (1 << iheader.bpp);
-    image->colors_used = palette_entries;
-    uint32_t palette_offset = sizeof(BitmapFileHeader) + iheader.dib_header_size;
-    uint32_t bytes_per_scanline = (iheader.bpp * iheader.width + 31) / 32 * 4;
-    uint32_t image_size = bytes_per_scanline * abs(iheader.height);
-    image->reserved = malloc(4);
-    if (image->reserved == NULL)
+    if (!bmp_check_headers(&fheader, &iheader))
     {
-        goto cleanup_reserved;
+        fprintf(stderr, "Invalid BMP file\n");
+        return false;
     }
-    image->palette = calloc(palette_entries, sizeof(*image->palette));
-    if (image->palette == NULL)
+
+    // The palette follows the info header, and the pixels start at bof
+    uint32_t palette_entries = iheader.colors_used ? iheader.colors_used : (1 << iheader.bpp);
+    size_t palette_end = sizeof(BitmapFileHeader) + iheader.dib_header_size + (size_t)palette_entries * sizeof(BMPColorT);
+    if (fheader.bof < palette_end)
     {
-        perror("Error allocating memory for palette data");
-        goto cleanup_image;
+        fprintf(stderr, "Invalid BMP file: pixel data overlaps the palette\n");
+        return false;
     }
 
-    image->pixels = malloc(image_size);
-    if (image->pixels == NULL)
+    if (!bmp_reshape(image, iheader.width, abs(iheader.height), palette_entries))
+        return false;
+    size_t image_size = (size_t)bmp_stride(image) * image->height;
+    memcpy(image->reserved, fheader.reserved, 4);
+
+    if (fread(image->palette, sizeof(BMPColorT), palette_entries, file) != palette_entries)
     {
-        perror("Error allocating memory for pixel data");
-        goto cleanup_palette;
+        fprintf(stderr, "Error reading palette data: %s\n", ferror(file) ? strerror(errno) : "Unexpected end of file");
+        return false;
     }
-    image->bpp = iheader.bpp;
-    image->width = iheader.width;
-    image->height = abs(iheader.height);
 
-    fseek(file, 6, SEEK_SET);
-    fread(image->reserved, 1, 4, file);
-    if (ferror(file))
+    if (!bmp_skip(file, fheader.bof - palette_end) || fread(image->pixels, 1, image_size, file) != image_size)
     {
-        perror("Error reading reserved bytes in header");
-        goto cleanup_all;
+        fprintf(stderr, "Error reading pixel data: %s\n", ferror(file) ? strerror(errno) : "Unexpected end of file");
+        return false;
     }
-    fseek(file, fheader.bof, SEEK_SET);
-    fread(image->pixels, 1, image_size, file);
-    if (ferror(file))
+
+    return true;
+}
+
+static bool bmp_load_file(BmpImage *image, const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL)
     {
-        perror("Error reading pixel data");
-        goto cleanup_all;
+        perror("Error opening file");
+        return false;
     }
 
-    if (palette_entries == 0)
+    bool ok = bmp_read_stream(image, file);
+    fclose(file);
+    return ok;
+}
+
+bool bmp_load_headers_fd(BmpImage *image, int fd, uint32_t *pixel_offset)
+{
+    uint8_t headers[sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader)];
+    ssize_t got = pread(fd, headers, sizeof(headers), 0);
+    if (got != (ssize_t)sizeof(headers))
     {
-        fprintf(stderr, "No palette found in BMP file\n");
-        goto cleanup_all;
+        fprintf(stderr, "Error reading BMP headers: %s\n", got < 0 ? strerror(errno) : "Unexpected end of file");
+        return false;
     }
 
-    fseek(file, palette_offset, SEEK_SET);
-    fread(image->palette, sizeof(BMPColorT), palette_entries, file);
-    if (ferror(file))
+    BitmapFileHeader fheader;
+    BitmapInfoHeader iheader;
+    memcpy(&fheader, headers, sizeof(fheader));
+    memcpy(&iheader, headers + sizeof(fheader), sizeof(iheader));
+    if (!bmp_check_headers(&fheader, &iheader))
     {
-        perror("Error reading palette data");
-        goto cleanup_all;
+        fprintf(stderr, "Invalid BMP file\n");
+        return false;
     }
 
-    fclose(file);
-    return image;
+    uint32_t palette_entries = iheader.colors_used ? iheader.colors_used : (1 << iheader.bpp);
+    size_t palette_end = sizeof(BitmapFileHeader) + iheader.dib_header_size + (size_t)palette_entries * sizeof(BMPColorT);
+    if (fheader.bof < palette_end)
+    {
+        fprintf(stderr, "Invalid BMP file: pixel data overlaps the palette\n");
+        return false;
+    }
 
-cleanup_all:
-    free(image->pixels);
-    image->pixels = NULL;
-cleanup_palette:
-    free(image->palette);
-    image->palette = NULL;
-cleanup_reserved:
-    free(image->reserved);
-    image->reserved = NULL;
-cleanup_image:
-    free(image);
-    image = NULL;
-cleanup_file:
-    fclose(file);
-    return NULL;
+    if (!bmp_reshape(image, iheader.width, abs(iheader.height), palette_entries))
+        return false;
+    memcpy(image->reserved, fheader.reserved, 4);
+    *pixel_offset = fheader.bof;
+    return true;
 }
 
-int bmp_save(const char *filename, const BmpImage *image)
-{
-    FILE *file = fopen(filename, "wb");
-    if (file == NULL)
-    {
-        perror("Error opening file for writing");
-        return -1;
-    }
+_Static_assert(sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) == BMP_HEADERS_SIZE,
+               "BMP_HEADERS_SIZE must match the packed headers");
 
+static void bmp_fill_headers(const BmpImage *image, BitmapFileHeader *fheader, BitmapInfoHeader *iheader)
+{
     // const uint8_t *res = image->reserved;
     // if (!CHECK_HEADER_RESERVED(res[0], res[1], res[2], res[3]))
     //     printf("Saving non-standard image with modified reserved bytes.\n");
 
-    BitmapFileHeader fheader = {0};
-    BitmapInfoHeader iheader = {0};
-
-    fheader.signature[0] = 'B';
-    fheader.signature[1] = 'M';
-    fheader.file_size = calculate_file_size(image);
-    fheader.bof = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + image->colors_used * sizeof(BMPColorT);
-    fheader.reserved[0] = image->reserved[0];
-    fheader.reserved[1] = image->reserved[1];
-    fheader.reserved[2] = image->reserved[2];
-    fheader.reserved[3] = image->reserved[3];
-    iheader.dib_header_size = sizeof(BitmapInfoHeader);
-    iheader.width = image->width;
-    iheader.height = image->height;
-    iheader.planes = 1;
-    iheader.bpp = image->bpp;
-    iheader.compression = 0;
-    iheader.image_size = 0;                   // Set to 0 for uncompressed
-    iheader.h_resolution = 0;                 // Set to 0 for default resolution
-    iheader.v_resolution = 0;                 // Set to 0 for default resolution
-    iheader.colors_used = image->colors_used; // Set to 0 when no palette is used
-    iheader.important_colors = 0;             // Set to 0 for all colors
+    memset(fheader, 0, sizeof(*fheader));
+    memset(iheader, 0, sizeof(*iheader));
+
+    fheader->signature[0] = 'B';
+    fheader->signature[1] = 'M';
+    fheader->file_size = calculate_file_size(image);
+    fheader->bof = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + image->colors_used * sizeof(BMPColorT);
+    fheader->reserved[0] = image->reserved[0];
+    fheader->reserved[1] = image->reserved[1];
+    fheader->reserved[2] = image->reserved[2];
+    fheader->reserved[3] = image->reserved[3];
+    iheader->dib_header_size = sizeof(BitmapInfoHeader);
+    iheader->width = image->width;
+    iheader->height = image->height;
+    iheader->planes = 1;
+    iheader->bpp = image->bpp;
+    iheader->compression = 0;
+    iheader->image_size = 0;                   // Set to 0 for uncompressed
+    iheader->h_resolution = 0;                 // Set to 0 for default resolution
+    iheader->v_resolution = 0;                 // Set to 0 for default resolution
+    iheader->colors_used = image->colors_used; // Set to 0 when no palette is used
+    iheader->important_colors = 0;             // Set to 0 for all colors
+}
+
+uint32_t bmp_encode_headers(const BmpImage *image, uint8_t *out)
+{
+    BitmapFileHeader fheader;
+    BitmapInfoHeader iheader;
+    bmp_fill_headers(image, &fheader, &iheader);
+    memcpy(out, &fheader, sizeof(fheader));
+    memcpy(out + sizeof(fheader), &iheader, sizeof(iheader));
+    return fheader.file_size;
+}
+
+static int bmp_write_stream(FILE *file, const BmpImage *image)
+{
+    BitmapFileHeader fheader;
+    BitmapInfoHeader iheader;
+    bmp_fill_headers(image, &fheader, &iheader);
     fwrite(&fheader, sizeof(BitmapFileHeader), 1, file);
     if (ferror(file))
     {
         perror("Error writing file header");
-        fclose(file);
         return -1;
     }
 
@@ -426,7 +504,6 @@ int bmp_save(const char *filename, const BmpImage *image)
     if (ferror(file))
     {
         perror("Error writing info header");
-        fclose(file);
         return -1;
     }
 
@@ -437,7 +514,6 @@ int bmp_save(const char *filename, const BmpImage *image)
         if (ferror(file))
         {
             perror("Error writing palette data");
-            fclose(file);
             return -1;
         }
     }
@@ -447,14 +523,149 @@ int bmp_save(const char *filename, const BmpImage *image)
     if (ferror(file))
     {
         perror("Error writing pixel data");
-        fclose(file);
         return -1;
     }
 
-    fclose(file);
     return 0;
 }
 
+static int bmp_save_file(const char *filename, const BmpImage *image)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        perror("Error opening file for writing");
+        return -1;
+    }
+
+    int ret = bmp_write_stream(file, image);
+    if (fclose(file) != 0 && ret == 0)
+    {
+        perror("Error closing file");
+        ret = -1;
+    }
+    return ret;
+}
+
+bool bmp_load_into(BmpImage *image, const char *filename)
+{
+    stats_begin(STATS_LOAD);
+    bool ok = bmp_load_file(image, filename);
+    if (ok)
+        stats_add_bytes_read(STATS_LOAD, calculate_file_size(image));
+    stats_end(STATS_LOAD);
+    return ok;
+}
+
+bool bmp_load_stream(BmpImage *image, FILE *file)
+{
+    stats_begin(STATS_LOAD);
+    bool ok = bmp_read_stream(image, file);
+    if (ok)
+        stats_add_bytes_read(STATS_LOAD, calculate_file_size(image));
+    stats_end(STATS_LOAD);
+    return ok;
+}
+
+BmpImage *bmp_load(const char *filename)
+{
+    BmpImage *image = calloc(1, sizeof(BmpImage));
+    if (image == NULL)
+    {
+        perror("Error allocating memory");
+        return NULL;
+    }
+
+    if (!bmp_load_into(image, filename))
+    {
+        bmp_unload(image);
+        return NULL;
+    }
+    return image;
+}
+
+int bmp_save(const char *filename, const BmpImage *image)
+{
+    stats_begin(STATS_SAVE);
+    int ret = bmp_save_file(filename, image);
+    if (ret == 0)
+        stats_add_bytes_written(STATS_SAVE, calculate_file_size(image));
+    stats_end(STATS_SAVE);
+    return ret;
+}
+
+int bmp_save_stream(FILE *file, const BmpImage *image)
+{
+    stats_begin(STATS_SAVE);
+    int ret = bmp_write_stream(file, image);
+    if (ret == 0 && fflush(file) != 0)
+    {
+        perror("Error flushing the image");
+        ret = -1;
+    }
+    if (ret == 0)
+        stats_add_bytes_written(STATS_SAVE, calculate_file_size(image));
+    stats_end(STATS_SAVE);
+    return ret;
+}
+
+void bmp_linear_iter_init(BMPLinearIterT *it, const BMPImageT *image, size_t start)
+{
+    it->row_bytes = image->width * image->bpp / 8;
+    it->stride = bmp_stride(image);
+
+    size_t y = start / it->row_bytes;
+    if (y >= (size_t)image->height)
+    {
+        // Past the end: park on the last row, with nothing left
+        it->row = bmp_row(image, image->height - 1);
+        it->x = it->row_bytes;
+        it->rows_left = 0;
+        return;
+    }
+
+    it->row = bmp_row(image, y);
+    it->x = start % it->row_bytes;
+    it->rows_left = image->height - 1 - (int32_t)y;
+}
+
+static size_t bmp_linear_copy(BMPLinearIterT *it, uint8_t *buf, size_t count, bool to_image)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        if (it->x == it->row_bytes)
+        {
+            if (it->rows_left == 0)
+                break;
+            it->row += it->stride;
+            it->x = 0;
+            it->rows_left--;
+        }
+
+        size_t chunk = it->row_bytes - it->x;
+        if (chunk > count - done)
+            chunk = count - done;
+        if (to_image)
+            memcpy(it->row + it->x, buf + done, chunk);
+        else
+            memcpy(buf + done, it->row + it->x, chunk);
+        done += chunk;
+        it->x += chunk;
+    }
+    return done;
+}
+
+size_t bmp_linear_read(BMPLinearIterT *it, uint8_t *dst, size_t count)
+{
+    return bmp_linear_copy(it, dst, count, false);
+}
+
+size_t bmp_linear_write(BMPLinearIterT *it, const uint8_t *src, size_t count)
+{
+    return bmp_linear_copy(it, (uint8_t *)src, count, true);
+}
+
 void bmp_unload(BmpImage *image)
 {
     if (image)
@@ -0,0 +1,207 @@
+#include "../include/bmp_pool.h"
+#include <pthread.h>
+
+struct BMPPoolT
+{
+    pthread_mutex_t lock;
+    BmpImage **idle; // Released images, most recent last
+    uint32_t idle_count;
+    uint32_t max_idle;
+    uint64_t allocations;
+};
+
+static BMPPoolT *gl_default_pool = NULL;
+
+BMPPoolT *bmp_pool_create(uint32_t max_idle)
+{
+    BMPPoolT *pool = calloc(1, sizeof(BMPPoolT));
+    if (pool == NULL)
+        return NULL;
+
+    pool->idle = calloc(max_idle > 0 ? max_idle : 1, sizeof(BmpImage *));
+    if (pool->idle == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+    pool->max_idle = max_idle;
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+void bmp_pool_destroy(BMPPoolT *pool)
+{
+    if (pool == NULL)
+        return;
+    if (gl_default_pool == pool)
+        gl_default_pool = NULL;
+
+    for (uint32_t i = 0; i < pool->idle_count; i++)
+        bmp_unload(pool->idle[i]);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->idle);
+    free(pool);
+}
+
+/**
+ * @brief Takes an idle image out of the pool, or allocates an empty one.
+ * @param pixels_needed Pixel bytes the caller will need, or 0 if unknown. The smallest idle image
+ *                      large enough is preferred, falling back to the most recently released one.
+ */
+static BmpImage *bmp_pool_take(BMPPoolT *pool, size_t pixels_needed)
+{
+    BmpImage *image = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0)
+    {
+        uint32_t pick = pool->idle_count - 1;
+        for (uint32_t i = 0; pixels_needed > 0 && i < pool->idle_count; i++)
+        {
+            size_t capacity = pool->idle[i]->pixels_capacity;
+            if (capacity >= pixels_needed &&
+                (pool->idle[pick]->pixels_capacity < pixels_needed || capacity < pool->idle[pick]->pixels_capacity))
+                pick = i;
+        }
+        image = pool->idle[pick];
+        pool->idle[pick] = pool->idle[--pool->idle_count];
+    }
+    else
+    {
+        pool->allocations++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (image == NULL)
+    {
+        image = calloc(1, sizeof(BmpImage));
+        if (image == NULL)
+            fprintf(stderr, "Out of memory: Failed to allocate a pooled image\n");
+    }
+    return image;
+}
+
+BmpImage *bmp_pool_load(BMPPoolT *pool, const char *filename)
+{
+    if (pool == NULL)
+        return bmp_load(filename);
+
+    BmpImage *image = bmp_pool_take(pool, 0);
+    if (image == NULL)
+        return NULL;
+
+    if (!bmp_load_into(image, filename))
+    {
+        bmp_pool_release(pool, image);
+        return NULL;
+    }
+    return image;
+}
+
+BmpImage *bmp_pool_load_stream(BMPPoolT *pool, FILE *file)
+{
+    BmpImage *image = pool != NULL ? bmp_pool_take(pool, 0) : calloc(1, sizeof(BmpImage));
+    if (image == NULL)
+        return NULL;
+
+    if (!bmp_load_stream(image, file))
+    {
+        bmp_pool_release(pool, image);
+        return NULL;
+    }
+    return image;
+}
+
+BmpImage *bmp_pool_create_image(BMPPoolT *pool, int32_t width, int32_t height, const BMPColorT *palette, uint32_t colors)
+{
+    if (pool == NULL)
+    {
+        BmpImage *image = bmp_create(width, height, 8, (BMPColorT *)palette, colors);
+        if (image != NULL)
+            image->colors_used = colors;
+        return image;
+    }
+
+    if (width <= 0 || height <= 0)
+    {
+        fprintf(stderr, "bmp_pool_create_image: Invalid image dimensions: %d x %d\n", width, height);
+        return NULL;
+    }
+
+    BmpImage *image = bmp_pool_take(pool, (size_t)bmp_align(width) * height);
+    if (image == NULL)
+        return NULL;
+
+    if (!bmp_reshape(image, width, height, colors))
+    {
+        bmp_pool_release(pool, image);
+        return NULL;
+    }
+
+    memset(image->pixels, 0, (size_t)bmp_stride(image) * height);
+    memset(image->reserved, 0, 4);
+    memset(image->palette, 0, image->palette_capacity * sizeof(BMPColorT));
+    if (palette != NULL)
+        memcpy(image->palette, palette, colors * sizeof(BMPColorT));
+    return image;
+}
+
+BmpImage *bmp_pool_copy(BMPPoolT *pool, const BmpImage *image)
+{
+    if (pool == NULL)
+        return bmp_copy((BmpImage *)image);
+
+    if (image == NULL || image->bpp != 8 || image->palette == NULL || image->pixels == NULL)
+    {
+        fprintf(stderr, "bmp_pool_copy: Invalid image or unsupported format\n");
+        return NULL;
+    }
+
+    BmpImage *copy = bmp_pool_take(pool, (size_t)bmp_stride(image) * image->height);
+    if (copy == NULL)
+        return NULL;
+
+    if (!bmp_reshape(copy, image->width, image->height, image->colors_used))
+    {
+        bmp_pool_release(pool, copy);
+        return NULL;
+    }
+
+    // Both palettes hold at least the 256 entries of an 8-bit image, see bmp_reshape
+    memcpy(copy->pixels, image->pixels, (size_t)bmp_stride(image) * image->height);
+    memcpy(copy->palette, image->palette, 256 * sizeof(BMPColorT));
+    memcpy(copy->reserved, image->reserved, 4);
+    return copy;
+}
+
+void bmp_pool_release(BMPPoolT *pool, BmpImage *image)
+{
+    if (image == NULL)
+        return;
+
+    if (pool != NULL)
+    {
+        pthread_mutex_lock(&pool->lock);
+        bool kept = pool->idle_count < pool->max_idle;
+        if (kept)
+            pool->idle[pool->idle_count++] = image;
+        pthread_mutex_unlock(&pool->lock);
+        if (kept)
+            return;
+    }
+    bmp_unload(image);
+}
+
+uint64_t bmp_pool_allocations(const BMPPoolT *pool)
+{
+    return pool != NULL ? pool->allocations : 0;
+}
+
+void bmp_pool_set_default(BMPPoolT *pool)
+{
+    gl_default_pool = pool;
+}
+
+BMPPoolT *bmp_pool_get_default(void)
+{
+    return gl_default_pool;
+}
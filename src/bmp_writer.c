@@ -0,0 +1,530 @@
+#define _GNU_SOURCE // fallocate
+#include "../include/bmp_writer.h"
+#include "../include/stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define BMP_WRITER_HAS_URING
+#endif
+#endif
+
+#define BMP_WRITER_MAX_THREADS 8
+#define BMP_WRITER_MAX_RING 1024 // Submission queue entries; larger batches go in several rounds
+#define BMP_WRITER_IOVECS 3      // Headers, palette and pixels
+
+// Operations submitted per file, tagged in the low bits of the completion user data
+#define BMP_WRITER_OP_FALLOCATE 0
+#define BMP_WRITER_OP_WRITEV 1
+#define BMP_WRITER_OP_FSYNC 2
+#define BMP_WRITER_OP_BITS 2
+
+typedef struct
+{
+    char path[512];
+    const BmpImage *image;
+    uint8_t headers[BMP_HEADERS_SIZE];
+    struct iovec iov[BMP_WRITER_IOVECS];
+    int iovcnt;
+    size_t size;
+    size_t written;
+    int fd;
+    bool synced;
+    bool failed;
+} BMPWriterEntryT;
+
+#ifdef BMP_WRITER_HAS_URING
+typedef struct
+{
+    int fd;
+    unsigned entries;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_map_size;
+    size_t cq_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} BMPWriterRingT;
+#endif
+
+struct BMPWriterT
+{
+    BMPWriterModeT mode;
+    unsigned flags;
+    uint32_t capacity;
+    uint32_t count;
+    BMPWriterEntryT *entries;
+#ifdef BMP_WRITER_HAS_URING
+    BMPWriterRingT ring;
+#endif
+};
+
+static const char *gl_bmp_writer_mode_names[BMP_WRITER_MODE_COUNT] = {"auto", "uring", "threads", "stdio"};
+
+/**
+ * @brief Fills iov with the part of the file not written yet.
+ * @return The number of iovecs filled.
+ */
+static int bmp_writer_remaining(const BMPWriterEntryT *entry, struct iovec *iov)
+{
+    size_t skip = entry->written;
+    int count = 0;
+    for (int i = 0; i < entry->iovcnt; i++)
+    {
+        if (skip >= entry->iov[i].iov_len)
+        {
+            skip -= entry->iov[i].iov_len;
+            continue;
+        }
+        iov[count].iov_base = (uint8_t *)entry->iov[i].iov_base + skip;
+        iov[count].iov_len = entry->iov[i].iov_len - skip;
+        skip = 0;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Writes (and syncs) whatever part of a file the asynchronous backend left undone.
+ */
+static void bmp_writer_finish_entry(BMPWriterEntryT *entry, unsigned flags)
+{
+    while (entry->written < entry->size)
+    {
+        struct iovec iov[BMP_WRITER_IOVECS];
+        int iovcnt = bmp_writer_remaining(entry, iov);
+        ssize_t ret = pwritev(entry->fd, iov, iovcnt, (off_t)entry->written);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Error writing '%s': %s\n", entry->path, ret < 0 ? strerror(errno) : "no progress");
+            entry->failed = true;
+            return;
+        }
+        entry->written += (size_t)ret;
+    }
+
+    if ((flags & BMP_WRITER_FSYNC) && !entry->synced)
+    {
+        if (fsync(entry->fd) != 0)
+        {
+            fprintf(stderr, "Error syncing '%s': %s\n", entry->path, strerror(errno));
+            entry->failed = true;
+            return;
+        }
+        entry->synced = true;
+    }
+}
+
+typedef struct
+{
+    BMPWriterT *writer;
+    uint32_t next;
+} BMPWriterPoolT;
+
+static void *bmp_writer_pool_worker(void *arg)
+{
+    BMPWriterPoolT *pool = arg;
+    BMPWriterT *writer = pool->writer;
+    uint32_t i;
+    while ((i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < writer->count)
+    {
+        BMPWriterEntryT *entry = &writer->entries[i];
+        if (entry->failed)
+            continue;
+        // Only a hint: filesystems without fallocate still get the file written
+        fallocate(entry->fd, 0, 0, (off_t)entry->size);
+        bmp_writer_finish_entry(entry, writer->flags);
+    }
+    return NULL;
+}
+
+static void bmp_writer_flush_threads(BMPWriterT *writer)
+{
+    BMPWriterPoolT pool = {writer, 0};
+    pthread_t threads[BMP_WRITER_MAX_THREADS];
+    uint32_t started = 0;
+    uint32_t wanted = writer->count < BMP_WRITER_MAX_THREADS ? writer->count : BMP_WRITER_MAX_THREADS;
+
+    // The calling thread is one of the workers
+    while (started + 1 < wanted && pthread_create(&threads[started], NULL, bmp_writer_pool_worker, &pool) == 0)
+        started++;
+    bmp_writer_pool_worker(&pool);
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+}
+
+#ifdef BMP_WRITER_HAS_URING
+static bool bmp_writer_ring_init(BMPWriterRingT *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+        return false;
+
+    ring->entries = params.sq_entries;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_map)
+    {
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+        goto error;
+
+    ring->cq_map = single_map ? ring->sq_map
+                              : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED)
+        goto error;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        goto error;
+
+    uint8_t *sq = ring->sq_map;
+    uint8_t *cq = ring->cq_map;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+
+error:
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != NULL && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map != NULL && ring->sq_map != MAP_FAILED)
+        munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+    ring->fd = -1;
+    return false;
+}
+
+static void bmp_writer_ring_free(BMPWriterRingT *ring)
+{
+    if (ring->fd < 0)
+        return;
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+static struct io_uring_sqe *bmp_writer_ring_sqe(BMPWriterRingT *ring, unsigned *tail, uint8_t opcode, int fd,
+                                                uint64_t user_data)
+{
+    unsigned index = *tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    (*tail)++;
+    return sqe;
+}
+
+static void bmp_writer_ring_complete(BMPWriterT *writer, const struct io_uring_cqe *cqe)
+{
+    BMPWriterEntryT *entry = &writer->entries[cqe->user_data >> BMP_WRITER_OP_BITS];
+    switch (cqe->user_data & ((1u << BMP_WRITER_OP_BITS) - 1))
+    {
+    case BMP_WRITER_OP_WRITEV:
+        // A short or failed write breaks the link to the fsync; bmp_writer_finish_entry resumes it
+        entry->written = cqe->res > 0 ? (size_t)cqe->res : 0;
+        break;
+    case BMP_WRITER_OP_FSYNC:
+        entry->synced = cqe->res == 0;
+        break;
+    default: // fallocate is only a hint
+        break;
+    }
+}
+
+/**
+ * @brief Submits the fallocate, writev and fsync of every file of a round with a single
+ *        io_uring_enter, then waits for all of them.
+ * @return false if the ring failed, leaving the round to bmp_writer_finish_entry.
+ */
+static bool bmp_writer_ring_round(BMPWriterT *writer, uint32_t first, uint32_t last)
+{
+    BMPWriterRingT *ring = &writer->ring;
+    bool fsync_files = writer->flags & BMP_WRITER_FSYNC;
+    unsigned tail = *ring->sq_tail; // Only this thread moves the tail
+    unsigned submitted = 0;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        BMPWriterEntryT *entry = &writer->entries[i];
+        if (entry->failed)
+            continue;
+
+        uint64_t tag = (uint64_t)i << BMP_WRITER_OP_BITS;
+        struct io_uring_sqe *sqe = bmp_writer_ring_sqe(ring, &tail, IORING_OP_FALLOCATE, entry->fd,
+                                                       tag | BMP_WRITER_OP_FALLOCATE);
+        sqe->addr = entry->size; // The length goes in addr, the mode in len
+        sqe = bmp_writer_ring_sqe(ring, &tail, IORING_OP_WRITEV, entry->fd, tag | BMP_WRITER_OP_WRITEV);
+        sqe->addr = (uint64_t)(uintptr_t)entry->iov;
+        sqe->len = entry->iovcnt;
+        submitted += 2;
+        if (fsync_files)
+        {
+            sqe->flags = IOSQE_IO_LINK; // Sync only once the pixels are written
+            bmp_writer_ring_sqe(ring, &tail, IORING_OP_FSYNC, entry->fd, tag | BMP_WRITER_OP_FSYNC);
+            submitted++;
+        }
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = submitted;
+    unsigned pending = submitted;
+    while (pending > 0)
+    {
+        int ret = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, pending, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && errno != EINTR)
+        {
+            perror("io_uring_enter");
+            return false;
+        }
+        if (ret > 0)
+            to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+        unsigned head = *ring->cq_head;
+        unsigned cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail && pending > 0; head++, pending--)
+            bmp_writer_ring_complete(writer, &ring->cqes[head & *ring->cq_mask]);
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+static void bmp_writer_flush_uring(BMPWriterT *writer)
+{
+    uint32_t per_round = writer->ring.entries / ((writer->flags & BMP_WRITER_FSYNC) ? 3 : 2);
+    for (uint32_t first = 0; first < writer->count; first += per_round)
+    {
+        uint32_t last = writer->count - first > per_round ? first + per_round : writer->count;
+        if (!bmp_writer_ring_round(writer, first, last))
+        {
+            // Completions may still be in flight, so the ring cannot be trusted any more.
+            // Rewriting what it may still be writing is harmless: the bytes are the same.
+            for (uint32_t i = first; i < last; i++)
+                writer->entries[i].written = 0;
+            bmp_writer_ring_free(&writer->ring);
+            writer->mode = BMP_WRITER_THREADS;
+            break;
+        }
+    }
+
+    // Short writes, errors and broken links are finished synchronously
+    for (uint32_t i = 0; i < writer->count; i++)
+    {
+        if (!writer->entries[i].failed)
+            bmp_writer_finish_entry(&writer->entries[i], writer->flags);
+    }
+}
+#endif
+
+BMPWriterT *bmp_writer_create(uint32_t capacity, BMPWriterModeT mode, unsigned flags)
+{
+    BMPWriterT *writer = calloc(1, sizeof(BMPWriterT));
+    if (writer == NULL)
+        return NULL;
+
+    writer->entries = calloc(capacity > 0 ? capacity : 1, sizeof(BMPWriterEntryT));
+    if (writer->entries == NULL)
+    {
+        free(writer);
+        return NULL;
+    }
+    writer->capacity = capacity;
+    writer->flags = flags;
+
+#ifdef BMP_WRITER_HAS_URING
+    writer->ring.fd = -1;
+    if (mode == BMP_WRITER_AUTO || mode == BMP_WRITER_URING)
+    {
+        unsigned entries = capacity * 3 < BMP_WRITER_MAX_RING ? capacity * 3 : BMP_WRITER_MAX_RING;
+        if (bmp_writer_ring_init(&writer->ring, entries < 4 ? 4 : entries))
+            mode = BMP_WRITER_URING;
+    }
+#endif
+    if (mode == BMP_WRITER_URING)
+    {
+#ifdef BMP_WRITER_HAS_URING
+        if (writer->ring.fd < 0)
+#endif
+        {
+            fprintf(stderr, "Warning: io_uring unavailable, writing with threads\n");
+            mode = BMP_WRITER_THREADS;
+        }
+    }
+    writer->mode = mode == BMP_WRITER_AUTO ? BMP_WRITER_THREADS : mode;
+    return writer;
+}
+
+BMPWriterModeT bmp_writer_mode(const BMPWriterT *writer)
+{
+    return writer->mode;
+}
+
+bool bmp_writer_add(BMPWriterT *writer, const char *filename, const BmpImage *image)
+{
+    if (writer->count >= writer->capacity)
+    {
+        fprintf(stderr, "BMP writer batch is full (%u files)\n", writer->capacity);
+        return false;
+    }
+
+    BMPWriterEntryT *entry = &writer->entries[writer->count];
+    memset(entry, 0, sizeof(*entry));
+    if ((size_t)snprintf(entry->path, sizeof(entry->path), "%s", filename) >= sizeof(entry->path))
+    {
+        fprintf(stderr, "Output path too long: '%s'\n", filename);
+        return false;
+    }
+
+    entry->image = image;
+    entry->fd = -1;
+    entry->size = bmp_encode_headers(image, entry->headers);
+    size_t palette_size = image->bpp <= 8 ? image->colors_used * sizeof(BMPColorT) : 0;
+    entry->iov[entry->iovcnt].iov_base = entry->headers;
+    entry->iov[entry->iovcnt++].iov_len = BMP_HEADERS_SIZE;
+    if (palette_size > 0)
+    {
+        entry->iov[entry->iovcnt].iov_base = image->palette;
+        entry->iov[entry->iovcnt++].iov_len = palette_size;
+    }
+    entry->iov[entry->iovcnt].iov_base = image->pixels;
+    entry->iov[entry->iovcnt++].iov_len = entry->size - BMP_HEADERS_SIZE - palette_size;
+
+    writer->count++;
+    return true;
+}
+
+bool bmp_writer_flush(BMPWriterT *writer)
+{
+    if (writer->count == 0)
+        return true;
+
+    if (writer->mode == BMP_WRITER_STDIO)
+    {
+        bool ok = true;
+        for (uint32_t i = 0; i < writer->count; i++)
+            ok &= bmp_save(writer->entries[i].path, writer->entries[i].image) == 0;
+        writer->count = 0;
+        return ok;
+    }
+
+    stats_begin(STATS_SAVE);
+    for (uint32_t i = 0; i < writer->count; i++)
+    {
+        BMPWriterEntryT *entry = &writer->entries[i];
+        entry->fd = open(entry->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (entry->fd < 0)
+        {
+            fprintf(stderr, "Error opening '%s' for writing: %s\n", entry->path, strerror(errno));
+            entry->failed = true;
+        }
+    }
+
+#ifdef BMP_WRITER_HAS_URING
+    if (writer->mode == BMP_WRITER_URING)
+        bmp_writer_flush_uring(writer);
+    else
+#endif
+        bmp_writer_flush_threads(writer);
+
+    bool ok = true;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < writer->count; i++)
+    {
+        BMPWriterEntryT *entry = &writer->entries[i];
+        if (entry->fd >= 0 && close(entry->fd) != 0)
+        {
+            fprintf(stderr, "Error closing '%s': %s\n", entry->path, strerror(errno));
+            entry->failed = true;
+        }
+        ok &= !entry->failed;
+        if (!entry->failed)
+            bytes += entry->size;
+    }
+    stats_add_bytes_written(STATS_SAVE, bytes);
+    stats_end(STATS_SAVE);
+
+    writer->count = 0;
+    return ok;
+}
+
+void bmp_writer_destroy(BMPWriterT *writer)
+{
+    if (writer == NULL)
+        return;
+#ifdef BMP_WRITER_HAS_URING
+    bmp_writer_ring_free(&writer->ring);
+#endif
+    free(writer->entries);
+    free(writer);
+}
+
+const char *bmp_writer_mode_name(BMPWriterModeT mode)
+{
+    if (mode >= BMP_WRITER_MODE_COUNT)
+        return "unknown";
+    return gl_bmp_writer_mode_names[mode];
+}
+
+bool bmp_writer_mode_parse(const char *name, BMPWriterModeT *mode)
+{
+    for (int i = 0; i < BMP_WRITER_MODE_COUNT; i++)
+    {
+        if (strcmp(name, gl_bmp_writer_mode_names[i]) == 0)
+        {
+            *mode = (BMPWriterModeT)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+#undef BMP_WRITER_MAX_THREADS
+#undef BMP_WRITER_MAX_RING
+#undef BMP_WRITER_IOVECS
+#undef BMP_WRITER_OP_FALLOCATE
+#undef BMP_WRITER_OP_WRITEV
+#undef BMP_WRITER_OP_FSYNC
+#undef BMP_WRITER_OP_BITS
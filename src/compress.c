@@ -0,0 +1,348 @@
+#include "../include/compress.h"
+#include "../include/crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPRESS_RLE_MAX_LITERALS 128
+#define COMPRESS_RLE_MAX_RUN 129
+#define COMPRESS_LZ_HASH_BITS 16
+#define COMPRESS_LZ_NIBBLE 15 // Token nibble meaning that length bytes follow
+
+static const char *gl_compress_codec_names[COMPRESS_CODEC_COUNT] = {"none", "rle", "lz"};
+static CompressDictT *gl_default_dict = NULL;
+
+size_t compress_bound(CompressCodecT codec, size_t len)
+{
+    if (codec == COMPRESS_RLE)
+        return len + (len + COMPRESS_RLE_MAX_LITERALS - 1) / COMPRESS_RLE_MAX_LITERALS;
+    if (codec == COMPRESS_LZ)
+        return len + len / 255 + 16;
+    return len;
+}
+
+static size_t compress_rle_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    size_t ip = 0, op = 0;
+    while (ip < len)
+    {
+        size_t run = 1;
+        while (ip + run < len && run < COMPRESS_RLE_MAX_RUN && src[ip + run] == src[ip])
+            run++;
+        if (run >= 3)
+        {
+            if (op + 2 > cap)
+                return 0;
+            dst[op++] = (uint8_t)(run + 126);
+            dst[op++] = src[ip];
+            ip += run;
+            continue;
+        }
+
+        // Literals up to the next run of 3, which is where a repeat starts to pay off
+        size_t lit = 0;
+        while (ip + lit < len && lit < COMPRESS_RLE_MAX_LITERALS)
+        {
+            if (ip + lit + 2 < len && src[ip + lit] == src[ip + lit + 1] && src[ip + lit] == src[ip + lit + 2])
+                break;
+            lit++;
+        }
+        if (op + 1 + lit > cap)
+            return 0;
+        dst[op++] = (uint8_t)(lit - 1);
+        memcpy(dst + op, src + ip, lit);
+        op += lit;
+        ip += lit;
+    }
+    return op;
+}
+
+static bool compress_rle_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t out_len)
+{
+    size_t ip = 0, op = 0;
+    while (ip < len)
+    {
+        uint8_t c = src[ip++];
+        if (c < 128)
+        {
+            size_t lit = (size_t)c + 1;
+            if (lit > len - ip || lit > out_len - op)
+                return false;
+            memcpy(dst + op, src + ip, lit);
+            ip += lit;
+            op += lit;
+        }
+        else
+        {
+            size_t run = (size_t)c - 126;
+            if (ip >= len || run > out_len - op)
+                return false;
+            memset(dst + op, src[ip++], run);
+            op += run;
+        }
+    }
+    return op == out_len;
+}
+
+static inline uint32_t compress_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t compress_lz_hash(const uint8_t *p)
+{
+    return (compress_read32(p) * 2654435761u) >> (32 - COMPRESS_LZ_HASH_BITS);
+}
+
+static uint8_t *compress_lz_put_length(uint8_t *out, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *out++ = 255;
+    *out++ = (uint8_t)len;
+    return out;
+}
+
+static bool compress_lz_get_length(const uint8_t *src, size_t len, size_t *ip, size_t *value)
+{
+    uint8_t b;
+    do
+    {
+        if (*ip >= len)
+            return false;
+        b = src[(*ip)++];
+        *value += b;
+    } while (b == 255);
+    return true;
+}
+
+/**
+ * @brief Writes a sequence: literals, then a match unless match_len is 0 (the last sequence).
+ * @return false if the sequence does not fit in cap.
+ */
+static bool compress_lz_sequence(uint8_t *dst, size_t cap, size_t *op, const uint8_t *literals, size_t lit,
+                                 size_t offset, size_t match_len)
+{
+    size_t extra = match_len > 0 ? match_len - COMPRESS_LZ_MIN_MATCH : 0;
+    size_t need = 1 + lit / 255 + 1 + lit + (match_len > 0 ? 2 + extra / 255 + 1 : 0);
+    if (need > cap - *op)
+        return false;
+
+    uint8_t *out = dst + *op;
+    *out++ = (uint8_t)((lit < COMPRESS_LZ_NIBBLE ? lit : COMPRESS_LZ_NIBBLE) << 4 |
+                       (extra < COMPRESS_LZ_NIBBLE ? extra : COMPRESS_LZ_NIBBLE));
+    if (lit >= COMPRESS_LZ_NIBBLE)
+        out = compress_lz_put_length(out, lit - COMPRESS_LZ_NIBBLE);
+    memcpy(out, literals, lit);
+    out += lit;
+    if (match_len > 0)
+    {
+        *out++ = offset & 0xFF;
+        *out++ = offset >> 8;
+        if (extra >= COMPRESS_LZ_NIBBLE)
+            out = compress_lz_put_length(out, extra - COMPRESS_LZ_NIBBLE);
+    }
+    *op = out - dst;
+    return true;
+}
+
+static size_t compress_lz_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t cap, const CompressDictT *dict)
+{
+    // The dictionary goes right before the data, so matches into it are plain back references
+    size_t dict_len = dict != NULL ? (dict->len < COMPRESS_LZ_WINDOW ? dict->len : COMPRESS_LZ_WINDOW) : 0;
+    size_t end = dict_len + len;
+    uint8_t *buf = malloc(end > 0 ? end : 1);
+    size_t *table = calloc((size_t)1 << COMPRESS_LZ_HASH_BITS, sizeof(size_t)); // Position + 1, 0 when empty
+    size_t op = 0;
+    if (buf == NULL || table == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the compressor\n");
+        goto cleanup;
+    }
+    if (dict_len > 0)
+        memcpy(buf, dict->data + dict->len - dict_len, dict_len);
+    memcpy(buf + dict_len, src, len);
+
+    for (size_t p = 0; p < dict_len && p + COMPRESS_LZ_MIN_MATCH <= end; p++)
+        table[compress_lz_hash(buf + p)] = p + 1;
+
+    size_t anchor = dict_len, p = dict_len;
+    while (p + COMPRESS_LZ_MIN_MATCH <= end)
+    {
+        uint32_t h = compress_lz_hash(buf + p);
+        size_t cand = table[h];
+        table[h] = p + 1;
+        if (cand == 0 || p - (cand - 1) > COMPRESS_LZ_WINDOW || compress_read32(buf + cand - 1) != compress_read32(buf + p))
+        {
+            p++;
+            continue;
+        }
+
+        cand--;
+        size_t match_len = COMPRESS_LZ_MIN_MATCH;
+        while (p + match_len < end && buf[cand + match_len] == buf[p + match_len])
+            match_len++;
+        if (!compress_lz_sequence(dst, cap, &op, buf + anchor, p - anchor, p - cand, match_len))
+        {
+            op = 0;
+            goto cleanup;
+        }
+        for (size_t q = p + 1; q < p + match_len && q + COMPRESS_LZ_MIN_MATCH <= end; q++)
+            table[compress_lz_hash(buf + q)] = q + 1;
+        p += match_len;
+        anchor = p;
+    }
+    if (!compress_lz_sequence(dst, cap, &op, buf + anchor, end - anchor, 0, 0))
+        op = 0;
+
+cleanup:
+    free(buf);
+    free(table);
+    return op;
+}
+
+static bool compress_lz_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t out_len, const CompressDictT *dict)
+{
+    size_t dict_len = dict != NULL ? (dict->len < COMPRESS_LZ_WINDOW ? dict->len : COMPRESS_LZ_WINDOW) : 0;
+    const uint8_t *window = dict_len > 0 ? dict->data + dict->len - dict_len : NULL;
+
+    size_t ip = 0, op = 0;
+    for (;;)
+    {
+        if (ip >= len)
+            return false;
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == COMPRESS_LZ_NIBBLE && !compress_lz_get_length(src, len, &ip, &lit))
+            return false;
+        if (lit > len - ip || lit > out_len - op)
+            return false;
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+        if (op == out_len)
+            return ip == len;
+
+        if (len - ip < 2)
+            return false;
+        size_t offset = src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        size_t match_len = token & COMPRESS_LZ_NIBBLE;
+        if (match_len == COMPRESS_LZ_NIBBLE && !compress_lz_get_length(src, len, &ip, &match_len))
+            return false;
+        match_len += COMPRESS_LZ_MIN_MATCH;
+        if (offset == 0 || offset > op + dict_len || match_len > out_len - op)
+            return false;
+
+        if (offset <= op && offset >= match_len)
+        {
+            memcpy(dst + op, dst + op - offset, match_len);
+            op += match_len;
+            continue;
+        }
+        // Overlapping matches repeat the bytes they produce, and early ones start in the dictionary
+        for (size_t i = 0; i < match_len; i++, op++)
+            dst[op] = op >= offset ? dst[op - offset] : window[dict_len + op - offset];
+    }
+}
+
+size_t compress_encode(CompressCodecT codec, const uint8_t *src, size_t len, uint8_t *dst, size_t cap,
+                       const CompressDictT *dict)
+{
+    if (codec == COMPRESS_RLE)
+        return compress_rle_encode(src, len, dst, cap);
+    if (codec == COMPRESS_LZ)
+        return compress_lz_encode(src, len, dst, cap, dict);
+    return 0;
+}
+
+bool compress_decode(CompressCodecT codec, const uint8_t *src, size_t len, uint8_t *dst, size_t out_len,
+                     const CompressDictT *dict)
+{
+    if (codec == COMPRESS_RLE)
+        return compress_rle_decode(src, len, dst, out_len);
+    if (codec == COMPRESS_LZ)
+        return compress_lz_decode(src, len, dst, out_len, dict);
+    return false;
+}
+
+bool compress_codec_parse(const char *name, CompressCodecT *codec)
+{
+    for (int i = 0; i < COMPRESS_CODEC_COUNT; i++)
+    {
+        if (strcmp(name, gl_compress_codec_names[i]) == 0)
+        {
+            *codec = (CompressCodecT)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+CompressDictT *compress_dict_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror("Error opening dictionary");
+        return NULL;
+    }
+
+    CompressDictT *dict = calloc(1, sizeof(CompressDictT));
+    long size = -1;
+    if (dict != NULL && fseek(file, 0, SEEK_END) == 0)
+        size = ftell(file);
+    if (dict == NULL || size <= 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "Error: dictionary '%s' is empty or unreadable\n", path);
+        goto error;
+    }
+
+    dict->len = (size_t)size;
+    dict->data = malloc(dict->len);
+    if (dict->data == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the dictionary\n");
+        goto error;
+    }
+    if (fread(dict->data, 1, dict->len, file) != dict->len)
+    {
+        fprintf(stderr, "Error reading dictionary '%s'\n", path);
+        goto error;
+    }
+    dict->crc = crc32c_update(0, dict->data, dict->len);
+    fclose(file);
+    return dict;
+
+error:
+    compress_dict_free(dict);
+    fclose(file);
+    return NULL;
+}
+
+void compress_dict_free(CompressDictT *dict)
+{
+    if (dict == NULL)
+        return;
+    if (gl_default_dict == dict)
+        gl_default_dict = NULL;
+    free(dict->data);
+    free(dict);
+}
+
+void compress_dict_set_default(CompressDictT *dict)
+{
+    gl_default_dict = dict;
+}
+
+CompressDictT *compress_dict_get_default(void)
+{
+    return gl_default_dict;
+}
+
+#undef COMPRESS_RLE_MAX_LITERALS
+#undef COMPRESS_RLE_MAX_RUN
+#undef COMPRESS_LZ_HASH_BITS
+#undef COMPRESS_LZ_NIBBLE
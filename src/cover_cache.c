@@ -0,0 +1,184 @@
+#include "../include/cover_cache.h"
+#include "../include/bmp_pool.h"
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct CoverCacheEntryT
+{
+    char *path;
+    struct stat st;   // File identity when the image was decoded
+    BmpImage *image;  // Decoded image, never handed out
+    size_t bytes;
+    struct CoverCacheEntryT *prev;
+    struct CoverCacheEntryT *next;
+} CoverCacheEntryT;
+
+struct CoverCacheT
+{
+    pthread_mutex_t lock;
+    CoverCacheEntryT *head; // Most recently used first
+    CoverCacheEntryT *tail;
+    size_t bytes;
+    size_t max_bytes;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+static CoverCacheT *gl_default_cover_cache = NULL;
+
+static bool cover_cache_same_file(const struct stat *a, const struct stat *b)
+{
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec &&
+           a->st_ctim.tv_sec == b->st_ctim.tv_sec && a->st_ctim.tv_nsec == b->st_ctim.tv_nsec;
+}
+
+static void cover_cache_unlink(CoverCacheT *cache, CoverCacheEntryT *entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void cover_cache_push_front(CoverCacheT *cache, CoverCacheEntryT *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+    cache->head = entry;
+}
+
+static void cover_cache_drop(CoverCacheT *cache, CoverCacheEntryT *entry)
+{
+    cover_cache_unlink(cache, entry);
+    cache->bytes -= entry->bytes;
+    bmp_unload(entry->image);
+    free(entry->path);
+    free(entry);
+}
+
+CoverCacheT *cover_cache_create(size_t max_bytes)
+{
+    CoverCacheT *cache = calloc(1, sizeof(CoverCacheT));
+    if (cache == NULL)
+        return NULL;
+
+    cache->max_bytes = max_bytes;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void cover_cache_destroy(CoverCacheT *cache)
+{
+    if (cache == NULL)
+        return;
+    if (gl_default_cover_cache == cache)
+        gl_default_cover_cache = NULL;
+
+    while (cache->head)
+        cover_cache_drop(cache, cache->head);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/**
+ * @brief Takes ownership of a decoded image, evicting older entries to stay under the cap.
+ *        Images larger than the whole cap are freed right away.
+ */
+static void cover_cache_insert(CoverCacheT *cache, const char *path, const struct stat *st, BmpImage *image)
+{
+    size_t bytes = image->pixels_capacity + (size_t)image->palette_capacity * sizeof(BMPColorT);
+    CoverCacheEntryT *entry = bytes <= cache->max_bytes ? calloc(1, sizeof(CoverCacheEntryT)) : NULL;
+    if (entry != NULL)
+        entry->path = strdup(path);
+    if (entry == NULL || entry->path == NULL)
+    {
+        free(entry);
+        bmp_unload(image);
+        return;
+    }
+    entry->st = *st;
+    entry->image = image;
+    entry->bytes = bytes;
+
+    pthread_mutex_lock(&cache->lock);
+    // Another thread may have decoded the same file meanwhile
+    for (CoverCacheEntryT *it = cache->head; it != NULL; it = it->next)
+    {
+        if (strcmp(it->path, path) == 0)
+        {
+            cover_cache_drop(cache, it);
+            break;
+        }
+    }
+    while (cache->tail && cache->bytes + bytes > cache->max_bytes)
+        cover_cache_drop(cache, cache->tail);
+    cover_cache_push_front(cache, entry);
+    cache->bytes += bytes;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+BmpImage *cover_cache_load(CoverCacheT *cache, const char *path)
+{
+    BMPPoolT *pool = bmp_pool_get_default();
+    struct stat st;
+    if (cache == NULL || stat(path, &st) != 0)
+        return bmp_pool_load(pool, path);
+
+    pthread_mutex_lock(&cache->lock);
+    for (CoverCacheEntryT *entry = cache->head; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->path, path) != 0)
+            continue;
+
+        if (!cover_cache_same_file(&entry->st, &st))
+        {
+            cover_cache_drop(cache, entry);
+            break;
+        }
+
+        // The copy is made under the lock, so the entry cannot be evicted meanwhile
+        cover_cache_unlink(cache, entry);
+        cover_cache_push_front(cache, entry);
+        cache->hits++;
+        BmpImage *copy = bmp_pool_copy(pool, entry->image);
+        pthread_mutex_unlock(&cache->lock);
+        return copy;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    BmpImage *image = bmp_load(path);
+    if (image == NULL)
+        return NULL;
+
+    BmpImage *copy = bmp_pool_copy(pool, image);
+    cover_cache_insert(cache, path, &st, image);
+    return copy;
+}
+
+void cover_cache_counts(const CoverCacheT *cache, uint64_t *hits, uint64_t *misses)
+{
+    *hits = cache != NULL ? __atomic_load_n(&cache->hits, __ATOMIC_RELAXED) : 0;
+    *misses = cache != NULL ? __atomic_load_n(&cache->misses, __ATOMIC_RELAXED) : 0;
+}
+
+void cover_cache_set_default(CoverCacheT *cache)
+{
+    gl_default_cover_cache = cache;
+}
+
+CoverCacheT *cover_cache_get_default(void)
+{
+    return gl_default_cover_cache;
+}
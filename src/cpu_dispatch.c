@@ -0,0 +1,71 @@
+#include "../include/cpu_dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CPU_LEVEL_UNSET (-1)
+
+static const char *gl_cpu_level_names[CPU_LEVEL_COUNT] = {"scalar", "sse4.2", "avx2", "avx512"};
+static int gl_cpu_level = CPU_LEVEL_UNSET;
+
+CpuLevelT cpu_detect_level(void)
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return CPU_LEVEL_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return CPU_LEVEL_AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return CPU_LEVEL_SSE42;
+#endif
+    return CPU_LEVEL_SCALAR;
+}
+
+CpuLevelT cpu_level(void)
+{
+    int level = __atomic_load_n(&gl_cpu_level, __ATOMIC_ACQUIRE);
+    if (level != CPU_LEVEL_UNSET)
+        return (CpuLevelT)level;
+
+    CpuLevelT detected = cpu_detect_level();
+    level = detected;
+
+    const char *forced = getenv("SHAMIGO_CPU");
+    CpuLevelT requested;
+    if (forced && *forced)
+    {
+        if (!cpu_level_parse(forced, &requested))
+            fprintf(stderr, "Warning: unknown SHAMIGO_CPU level '%s', using %s\n", forced, cpu_level_name(detected));
+        else if (requested > detected)
+            fprintf(stderr, "Warning: this CPU does not support %s, using %s\n", forced, cpu_level_name(detected));
+        else
+            level = requested;
+    }
+
+    // Every thread computes the same value, so a racing first call is harmless
+    __atomic_store_n(&gl_cpu_level, level, __ATOMIC_RELEASE);
+    return (CpuLevelT)level;
+}
+
+const char *cpu_level_name(CpuLevelT level)
+{
+    if (level < 0 || level >= CPU_LEVEL_COUNT)
+        return "unknown";
+    return gl_cpu_level_names[level];
+}
+
+bool cpu_level_parse(const char *name, CpuLevelT *level)
+{
+    for (int i = 0; i < CPU_LEVEL_COUNT; i++)
+    {
+        if (strcmp(name, gl_cpu_level_names[i]) == 0)
+        {
+            *level = (CpuLevelT)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+#undef CPU_LEVEL_UNSET
@@ -0,0 +1,86 @@
+#include "../include/crc32c.h"
+#include <pthread.h>
+#include <string.h>
+
+#define CRC32C_POLY 0x82F63B78u // Castagnoli polynomial, reflected
+
+static uint32_t gl_crc32c_table[8][256];
+static pthread_once_t gl_crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_build_table(void)
+{
+    for (uint32_t b = 0; b < 256; b++)
+    {
+        uint32_t crc = b;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+        gl_crc32c_table[0][b] = crc;
+    }
+    // Table t gives the contribution of a byte followed by t zero bytes
+    for (int t = 1; t < 8; t++)
+        for (int b = 0; b < 256; b++)
+            gl_crc32c_table[t][b] = (gl_crc32c_table[t - 1][b] >> 8) ^ gl_crc32c_table[0][gl_crc32c_table[t - 1][b] & 0xFF];
+}
+
+uint32_t crc32c_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    pthread_once(&gl_crc32c_once, crc32c_build_table);
+    const uint32_t (*t)[256] = (const uint32_t (*)[256])gl_crc32c_table;
+
+    crc = ~crc;
+    for (; len >= 8; len -= 8, data += 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, data, sizeof(lo));
+        memcpy(&hi, data + 4, sizeof(hi));
+        lo ^= crc; // The CRC is reflected, so the first byte is the low byte of a little endian word
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; len > 0; len--, data++)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+    return ~crc;
+}
+
+// Product of two polynomials modulo the reflected polynomial, bit 31 holding x^0; a is not zero
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+// x^(8 * len) modulo the polynomial, which is what len zero bytes do to a CRC register
+static uint32_t crc32c_zeros_operator(size_t len)
+{
+    uint32_t op = 1u << 31, square = 1u << 23; // x^0 and x^8
+    for (; len > 0; len >>= 1)
+    {
+        if (len & 1)
+            op = crc32c_multmodp(square, op);
+        square = crc32c_multmodp(square, square);
+    }
+    return op;
+}
+
+uint32_t crc32c_patch(uint32_t crc, const uint8_t *delta, size_t len, size_t after)
+{
+    // Without the initial and final inversions the CRC is linear, and for strings of the same
+    // length those inversions cancel out: only the CRC of the difference is left to add
+    uint32_t raw = ~crc32c_update(~0u, delta, len);
+    if (raw == 0)
+        return crc;
+    return crc ^ crc32c_multmodp(crc32c_zeros_operator(after), raw);
+}
+
+#undef CRC32C_POLY
@@ -0,0 +1,258 @@
+#include "../include/keystream_cache.h"
+#include "../include/permutation_table.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KSCACHE_MAGIC "SHKSC01"
+#define KSCACHE_MAGIC_SIZE 8
+
+typedef struct
+{
+    char magic[KSCACHE_MAGIC_SIZE];
+    uint32_t slot_count;
+    uint32_t prefix_len;
+    uint64_t clock; // Incremented on every access, for LRU ordering
+} KSCacheHeader;
+
+typedef struct
+{
+    uint16_t seed;
+    uint8_t mode;
+    uint8_t used;
+    uint32_t length;    // Bytes of keystream stored in the slot
+    int64_t lcg_state;  // LCG state after `length` bytes, to resume the stream
+    uint64_t last_used;
+} KSCacheSlot;
+
+struct KeystreamCacheT
+{
+    int fd;
+    uint8_t *map;
+    size_t map_size;
+    KSCacheHeader *header;
+    KSCacheSlot *slots;
+    uint8_t *data;
+};
+
+static KeystreamCacheT *gl_default_cache = NULL;
+
+static size_t kscache_file_size(uint32_t slot_count, uint32_t prefix_len)
+{
+    return sizeof(KSCacheHeader) + (size_t)slot_count * (sizeof(KSCacheSlot) + prefix_len);
+}
+
+KeystreamCacheT *kscache_open(const char *path, size_t max_bytes, size_t prefix_len)
+{
+    if (prefix_len == 0 || prefix_len > UINT32_MAX)
+    {
+        fprintf(stderr, "kscache_open: Invalid prefix length %zu\n", prefix_len);
+        return NULL;
+    }
+
+    KeystreamCacheT *cache = calloc(1, sizeof(KeystreamCacheT));
+    if (cache == NULL)
+    {
+        fprintf(stderr, "kscache_open: Error allocating memory for cache\n");
+        return NULL;
+    }
+
+    cache->fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (cache->fd < 0)
+    {
+        perror("Error opening keystream cache");
+        goto error_free;
+    }
+
+    if (flock(cache->fd, LOCK_EX) != 0)
+    {
+        perror("Error locking keystream cache");
+        goto error_close;
+    }
+
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0)
+    {
+        perror("Error reading keystream cache");
+        goto error_unlock;
+    }
+
+    KSCacheHeader header;
+    if (st.st_size == 0)
+    {
+        // New cache: as many slots as fit under the cap, at least one
+        size_t slot_bytes = sizeof(KSCacheSlot) + prefix_len;
+        size_t slot_count = max_bytes > sizeof(KSCacheHeader) ? (max_bytes - sizeof(KSCacheHeader)) / slot_bytes : 0;
+        if (slot_count == 0)
+            slot_count = 1;
+        if (slot_count > 65536 * RNGPT_MODE_COUNT)
+            slot_count = 65536 * RNGPT_MODE_COUNT;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, KSCACHE_MAGIC, KSCACHE_MAGIC_SIZE);
+        header.slot_count = slot_count;
+        header.prefix_len = prefix_len;
+
+        // The file is sparse: data pages only take space once a slot is filled
+        if (ftruncate(cache->fd, kscache_file_size(header.slot_count, header.prefix_len)) != 0 ||
+            pwrite(cache->fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            perror("Error initializing keystream cache");
+            goto error_unlock;
+        }
+    }
+    else if (pread(cache->fd, &header, sizeof(header), 0) != sizeof(header) ||
+             memcmp(header.magic, KSCACHE_MAGIC, KSCACHE_MAGIC_SIZE) != 0 ||
+             header.slot_count == 0 || header.prefix_len == 0 ||
+             (size_t)st.st_size != kscache_file_size(header.slot_count, header.prefix_len))
+    {
+        fprintf(stderr, "kscache_open: '%s' is not a keystream cache\n", path);
+        goto error_unlock;
+    }
+
+    cache->map_size = kscache_file_size(header.slot_count, header.prefix_len);
+    cache->map = mmap(NULL, cache->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    if (cache->map == MAP_FAILED)
+    {
+        perror("Error mapping keystream cache");
+        goto error_unlock;
+    }
+
+    cache->header = (KSCacheHeader *)cache->map;
+    cache->slots = (KSCacheSlot *)(cache->map + sizeof(KSCacheHeader));
+    cache->data = cache->map + sizeof(KSCacheHeader) + (size_t)header.slot_count * sizeof(KSCacheSlot);
+
+    flock(cache->fd, LOCK_UN);
+    return cache;
+
+error_unlock:
+    flock(cache->fd, LOCK_UN);
+error_close:
+    close(cache->fd);
+error_free:
+    free(cache);
+    return NULL;
+}
+
+void kscache_close(KeystreamCacheT *cache)
+{
+    if (cache == NULL)
+        return;
+
+    if (gl_default_cache == cache)
+        gl_default_cache = NULL;
+
+    munmap(cache->map, cache->map_size);
+    close(cache->fd);
+    free(cache);
+}
+
+static KSCacheSlot *kscache_find_slot(KeystreamCacheT *cache, uint16_t seed, uint8_t mode)
+{
+    KSCacheSlot *victim = NULL;
+    for (uint32_t i = 0; i < cache->header->slot_count; i++)
+    {
+        KSCacheSlot *slot = &cache->slots[i];
+
+        // The file is shared: a slot with an unknown mode or more bytes than a prefix holds is empty
+        if (slot->used && (slot->mode >= RNGPT_MODE_COUNT || slot->length > cache->header->prefix_len))
+        {
+            slot->used = 0;
+            slot->length = 0;
+        }
+
+        if (slot->used && slot->seed == seed && slot->mode == mode)
+            return slot;
+
+        if (victim == NULL || (victim->used && (!slot->used || slot->last_used < victim->last_used)))
+            victim = slot;
+    }
+
+    // Evict the least recently used slot (or take a free one)
+    victim->used = 1;
+    victim->seed = seed;
+    victim->mode = mode;
+    victim->length = 0;
+    return victim;
+}
+
+// Extends the keystream held by a slot to `length` bytes
+static void kscache_fill_slot(KSCacheSlot *slot, uint8_t *data, size_t length)
+{
+    if (slot->mode == RNGPT_MODE_CTR)
+    {
+        memset(data + slot->length, 0, length - slot->length);
+        rngpt_ctr_xor(data + slot->length, length - slot->length, slot->seed, slot->length);
+    }
+    else
+    {
+        if (slot->length == 0)
+            rngpt_set_seed(slot->seed);
+        else
+            rngpt_set_state(slot->lcg_state);
+
+        for (size_t i = slot->length; i < length; i++)
+            data[i] = rngpt_next_char();
+        slot->lcg_state = rngpt_get_state();
+    }
+    slot->length = length;
+}
+
+bool kscache_xor(KeystreamCacheT *cache, uint16_t seed, uint8_t mode, uint8_t *buf, size_t size)
+{
+    if (cache == NULL || buf == NULL || mode >= RNGPT_MODE_COUNT)
+        return false;
+
+    if (flock(cache->fd, LOCK_EX) != 0)
+    {
+        perror("Error locking keystream cache");
+        return false;
+    }
+
+    KSCacheSlot *slot = kscache_find_slot(cache, seed, mode);
+    slot->last_used = ++cache->header->clock;
+
+    size_t prefix_len = cache->header->prefix_len;
+    uint8_t *data = cache->data + (size_t)(slot - cache->slots) * prefix_len;
+    size_t cached = size < prefix_len ? size : prefix_len;
+    if (slot->length < cached)
+        kscache_fill_slot(slot, data, cached);
+
+    rngpt_inplace_xor(buf, data, cached);
+
+    // Past the prefix (the slot is full then), resume the generator where the slot left off
+    if (size > cached)
+    {
+        if (mode == RNGPT_MODE_CTR)
+        {
+            rngpt_ctr_xor(buf + cached, size - cached, seed, cached);
+        }
+        else
+        {
+            rngpt_set_state(slot->lcg_state);
+            for (size_t i = cached; i < size; i++)
+                buf[i] ^= rngpt_next_char();
+        }
+    }
+
+    flock(cache->fd, LOCK_UN);
+    return true;
+}
+
+void kscache_set_default(KeystreamCacheT *cache)
+{
+    gl_default_cache = cache;
+}
+
+KeystreamCacheT *kscache_get_default(void)
+{
+    return gl_default_cache;
+}
+
+#undef KSCACHE_MAGIC
+#undef KSCACHE_MAGIC_SIZE
@@ -1,5 +1,8 @@
 #include "../include/lsb_decoder.h"
-#define METADATA_SIZE 32 // 2 bytes for width and 2 bytes for height * 8 bits per byte
+#include "../include/sss_kernels.h"
+#include "../include/scatter.h"
+
+#define LSB_CRC_CHUNK 4096 // Shadow bytes extracted and tagged at a time
 
 bool lsb_decoder_lsb1_extract_to_buffer(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover)
 {
@@ -18,80 +21,152 @@ bool lsb_decoder_lsb1_extract_to_buffer(uint8_t *out_shadow_data, size_t shadow_
         return false;
     }
 
-    const uint8_t *cover_data = cover->pixels;
-
-    size_t shadow_byte_index = 0;
-    uint8_t current_byte = 0;
-    int bit_index = 7; // Start from MSB
+    sss_kernels_active()->lsb1_extract(cover->pixels, out_shadow_data, shadow_len);
+    return true;
+}
 
-    for (size_t i = 0; i < cover_capacity && shadow_byte_index < shadow_len; ++i)
+void lsb_decoder_lsb1_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
     {
-        uint8_t bit = cover_data[i] & 0x01;
-        current_byte |= (bit << bit_index);
-
-        bit_index--;
-        if (bit_index < 0)
+        uint8_t current_byte = 0;
+        for (int bit_index = 7; bit_index >= 0; --bit_index, ++cover_data)
         {
-            out_shadow_data[shadow_byte_index] = current_byte;
-            current_byte = 0;
-            bit_index = 7;
-            shadow_byte_index++;
+            current_byte |= (*cover_data & 0x01) << bit_index;
         }
+        bytes[i] = current_byte;
     }
+}
 
-    return true;
+void lsb_decoder_lsb2_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t current_byte = 0;
+        for (int shift = 6; shift >= 0; shift -= 2, ++cover_data)
+        {
+            current_byte |= (*cover_data & 0x03) << shift;
+        }
+        bytes[i] = current_byte;
+    }
 }
 
-LSBDecodeResult lsb_decoder_lsb1_extract_to_buffer_extended(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover, int k)
+void lsb_decoder_lsb4_extract_bytes(const uint8_t *cover_data, uint8_t *bytes, size_t len)
 {
-    if (!out_shadow_data || !cover || !cover->pixels || k < 2 || k > 10)
-        return (LSBDecodeResult){.result = false, .s_width = 0, .s_height = 0};
+    for (size_t i = 0; i < len; ++i, cover_data += 2)
+    {
+        bytes[i] = ((cover_data[0] & 0x0F) << 4) | (cover_data[1] & 0x0F);
+    }
+}
 
-    size_t bits_needed = shadow_len * 8 + METADATA_SIZE;
+bool lsb_decoder_lsb1_read_meta(const BMPImageT *cover, StegoMetaT *meta)
+{
+    if (!cover || !cover->pixels || !meta)
+        return false;
 
     uint32_t width_bytes = cover->width * cover->bpp / 8;
-    uint32_t padded_width_bytes = bmp_align(width_bytes); // Align to 4 bytes
-    size_t cover_capacity = padded_width_bytes * cover->height;
+    size_t cover_capacity = (size_t)bmp_align(width_bytes) * cover->height;
+    bool extended = stego_meta_is_extended(cover);
 
-    if (cover_capacity < bits_needed)
+    uint8_t header[STEGO_META_MAX_SIZE];
+    size_t peek = extended ? STEGO_META_PEEK_SIZE : STEGO_META_LEGACY_SIZE;
+    if (cover_capacity < peek * 8)
     {
-        fprintf(stderr, "Cover image too small to extract shadow data\n");
-        return (LSBDecodeResult){.result = false, .s_width = 0, .s_height = 0};
+        fprintf(stderr, "Cover image too small to hold a stego header\n");
+        return false;
     }
+    lsb_decoder_lsb1_extract_bytes(cover->pixels, header, peek);
 
-    const uint8_t *cover_data = cover->pixels;
+    size_t header_len = stego_meta_peek_size(header, peek, extended);
+    if (header_len == 0 || cover_capacity < header_len * 8)
+    {
+        fprintf(stderr, "Invalid stego header\n");
+        return false;
+    }
+    lsb_decoder_lsb1_extract_bytes((const uint8_t *)cover->pixels + peek * 8, header + peek, header_len - peek);
 
-    uint16_t s_width = 0, s_height = 0;
-    for (int i = 0; i < 16; ++i)
+    return stego_meta_parse(header, header_len, extended, meta);
+}
+
+bool lsb_decoder_lsb1_read_entries(const BMPImageT *cover, const StegoMetaT *meta, StegoEntryT *entries)
+{
+    if (!cover || !cover->pixels || !meta || !entries)
+        return false;
+
+    uint32_t width_bytes = cover->width * cover->bpp / 8;
+    size_t cover_capacity = (size_t)bmp_align(width_bytes) * cover->height;
+    if (cover_capacity < (stego_meta_size(meta) + stego_meta_dir_size(meta)) * 8)
     {
-        s_width <<= 1;
-        s_width |= (cover_data[i] & 0x01);
+        fprintf(stderr, "Cover image too small to hold a directory of %u secrets\n", meta->entries);
+        return false;
     }
-    for (int i = 16; i < 32; ++i)
+
+    const uint8_t *dir = (const uint8_t *)cover->pixels + stego_meta_size(meta) * 8;
+    for (uint32_t i = 0; i < meta->entries; ++i, dir += STEGO_META_ENTRY_SIZE * 8)
     {
-        s_height <<= 1;
-        s_height |= (cover_data[i] & 0x01);
+        uint8_t entry[STEGO_META_ENTRY_SIZE];
+        lsb_decoder_lsb1_extract_bytes(dir, entry, STEGO_META_ENTRY_SIZE);
+        if (!stego_entry_parse(entry, &entries[i]))
+            return false;
     }
-    size_t shadow_byte_index = 0;
-    uint16_t current_word = 0;
-    int bit_index = 7; // Start from MSB
+    return true;
+}
+
+bool lsb_decoder_lsb1_extract_to_buffer_extended(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover, const StegoMetaT *meta)
+{
+    if (!out_shadow_data || !cover || !cover->pixels || !meta)
+        return false;
+
+    if (!stego_meta_lsb_bits_valid(meta->lsb_bits) || !stego_meta_layout_valid(meta->layout))
+        return false;
+
+    size_t bits_needed = stego_meta_cover_bytes(meta, shadow_len);
 
-    for (size_t i = METADATA_SIZE; i < cover_capacity && shadow_byte_index < shadow_len; ++i)
+    uint32_t width_bytes = cover->width * cover->bpp / 8;
+    uint32_t padded_width_bytes = bmp_align(width_bytes); // Align to 4 bytes
+    size_t cover_capacity = (size_t)padded_width_bytes * cover->height;
+
+    if (cover_capacity < bits_needed)
     {
-        uint8_t bit = cover_data[i] & 0x01;
-        current_word |= (bit << bit_index);
+        fprintf(stderr, "Cover image too small to extract shadow data\n");
+        return false;
+    }
 
-        bit_index--;
-        if (bit_index < 0)
-        {
-            out_shadow_data[shadow_byte_index] = current_word;
-            current_word = 0;
-            bit_index = 7;
-            shadow_byte_index++;
-        }
+    uint32_t crc = lsb_decoder_extract_shadow_range(cover, meta, stego_meta_get_seed(cover), out_shadow_data, 0, shadow_len, 0);
+    if (stego_meta_has_crc(meta) && crc != meta->shadow_crc)
+    {
+        fprintf(stderr, "Shadow data of the stego image with x = %u fails its CRC32C check\n", stego_meta_get_x(cover));
+        return false;
     }
+    return true;
+}
 
-    return (LSBDecodeResult){.result = true, .s_width = s_width, .s_height = s_height};
+uint32_t lsb_decoder_extract_shadow_range(const BMPImageT *cover, const StegoMetaT *meta, uint16_t seed,
+                                          uint8_t *bytes, size_t offset, size_t len, uint32_t crc)
+{
+    const SSSKernelsT *kernels = sss_kernels_active();
+    SSSExtractKernelFnT extract = sss_kernels_extract(kernels, meta->lsb_bits);
+    size_t region_offset = stego_meta_shadow_offset(meta);
+    const uint8_t *region = (const uint8_t *)cover->pixels + region_offset;
+    bool scattered = meta->layout == STEGO_META_LAYOUT_SCATTER;
+    ScatterT scatter;
+    if (scattered)
+        scatter_init(&scatter, (size_t)bmp_stride(cover) * cover->height - region_offset, seed);
+
+    // Each chunk is tagged right after it is extracted, while it is still in L1
+    while (len > 0)
+    {
+        size_t run = len < LSB_CRC_CHUNK ? len : LSB_CRC_CHUNK;
+        if (scattered)
+            scatter_extract(&scatter, extract, meta->lsb_bits, region, bytes, offset, run);
+        else
+            extract(region + offset * (8 / meta->lsb_bits), bytes, run);
+        crc = kernels->crc32c(crc, bytes, run);
+        bytes += run;
+        offset += run;
+        len -= run;
+    }
+    return crc;
 }
 
 LSBDecodeResult lsb_decoder_lsb1_get_dimensions(const BMPImageT *cover)
@@ -116,4 +191,4 @@ LSBDecodeResult lsb_decoder_lsb1_get_dimensions(const BMPImageT *cover)
     return (LSBDecodeResult){.result = true, .s_width = s_width, .s_height = s_height};
 }
 
-#undef METADATA_SIZE
\ No newline at end of file
+#undef LSB_CRC_CHUNK
@@ -1,5 +1,8 @@
 #include "../include/lsb_encoder.h"
-#define METADATA_SIZE 32 // 2 bytes for width and 2 bytes for height * 8 bits per byte
+#include "../include/sss_kernels.h"
+#include "../include/scatter.h"
+
+#define LSB_CRC_CHUNK 4096 // Shadow bytes tagged and embedded at a time
 
 bool lsb_encoder_lsb1_into_cover(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed)
 {
@@ -19,50 +22,72 @@ bool lsb_encoder_lsb1_into_cover(const uint8_t *shadow_data, size_t shadow_len,
         return false;
     }
 
-    uint8_t *cover_data = cover->pixels;
-
-    size_t shadow_byte_index = 0;
-    uint8_t current_byte = shadow_data[shadow_byte_index];
-    int bit_index = 7; // Start from MSB
+    sss_kernels_active()->lsb1_embed(cover->pixels, shadow_data, shadow_len);
+    return true;
+}
 
-    for (size_t i = 0; i < cover_capacity && shadow_byte_index < shadow_len; ++i)
+void lsb_encoder_lsb1_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
     {
-        // Clear LSB of cover byte
-        cover_data[i] &= 0xFE;
+        uint8_t current_byte = bytes[i];
+        for (int bit_index = 7; bit_index >= 0; --bit_index, ++cover_data)
+        {
+            uint8_t bit = (current_byte >> bit_index) & 0x01;
+            *cover_data = (*cover_data & 0xFE) | bit;
+        }
+    }
+}
 
-        // Insert current bit from shadow
-        uint8_t bit = (current_byte >> bit_index) & 0x01;
-        cover_data[i] |= bit;
+void lsb_encoder_lsb1_embed_entries(BMPImageT *cover, const StegoMetaT *meta, const StegoEntryT *entries)
+{
+    uint8_t *dir = (uint8_t *)cover->pixels + stego_meta_size(meta) * 8;
+    for (uint32_t i = 0; i < meta->entries; ++i, dir += STEGO_META_ENTRY_SIZE * 8)
+    {
+        uint8_t entry[STEGO_META_ENTRY_SIZE];
+        stego_entry_serialize(&entries[i], entry);
+        lsb_encoder_lsb1_embed_bytes(dir, entry, STEGO_META_ENTRY_SIZE);
+    }
+}
 
-        bit_index--;
-        if (bit_index < 0)
+void lsb_encoder_lsb2_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t current_byte = bytes[i];
+        for (int shift = 6; shift >= 0; shift -= 2, ++cover_data)
         {
-            bit_index = 7;
-            shadow_byte_index++;
-            if (shadow_byte_index < shadow_len)
-            {
-                current_byte = shadow_data[shadow_byte_index];
-            }
+            *cover_data = (*cover_data & 0xFC) | ((current_byte >> shift) & 0x03);
         }
     }
+}
 
-    return true;
+void lsb_encoder_lsb4_embed_bytes(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; ++i, cover_data += 2)
+    {
+        cover_data[0] = (cover_data[0] & 0xF0) | (bytes[i] >> 4);
+        cover_data[1] = (cover_data[1] & 0xF0) | (bytes[i] & 0x0F);
+    }
 }
 
-bool lsb_encoder_lsb1_into_cover_extended(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed, int k, int16_t s_width, int16_t s_height)
+bool lsb_encoder_lsb1_into_cover_extended(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed, const StegoMetaT *meta)
 {
-    // 2 bytes for width and 2 bytes for height, 8 bits per byte
+    if (!shadow_data || !cover || !cover->pixels || !meta)
+        return false;
 
-    if (!shadow_data || !cover || !cover->pixels || k < 1 || k > 10)
+    if (meta->version != 0 && (meta->k < SSS_MIN_K || meta->k > SSS_MAX_K))
+        return false;
+    if (!stego_meta_lsb_bits_valid(meta->lsb_bits) || !stego_meta_layout_valid(meta->layout))
         return false;
 
-    // Each byte in the shadow buffer needs 8 bits (LSBs in the cover) + 4 bytes for width and height
-    size_t bits_needed = shadow_len * 8 + METADATA_SIZE;
+    // Each header byte needs 8 cover bytes, each shadow byte 8 / lsb_bits of them
+    size_t bits_needed = stego_meta_cover_bytes(meta, shadow_len);
 
     // padding is usable for the LSB
     uint32_t width_bytes = cover->width * cover->bpp / 8;
     uint32_t padded_width_bytes = bmp_align(width_bytes); // Align to 4 bytes
-    size_t cover_capacity = padded_width_bytes * cover->height;
+    size_t cover_capacity = (size_t)padded_width_bytes * cover->height;
 
     if (cover_capacity < bits_needed)
     {
@@ -70,47 +95,42 @@ bool lsb_encoder_lsb1_into_cover_extended(const uint8_t *shadow_data, size_t sha
         return false;
     }
 
-    uint8_t *cover_data = cover->pixels;
-
-    size_t i = 0; // use the same index for metadata and shadow data
-    for (int j = 0; j < 16; ++j, ++i)
-    {
-        uint8_t bit = (s_width >> (15 - j)) & 0x01;
-        cover_data[i] = (cover_data[i] & 0xFE) | bit;
-    }
-
-    for (int j = 0; j < 16; ++j, ++i)
-    {
-        uint8_t bit = (s_height >> (15 - j)) & 0x01;
-        cover_data[i] = (cover_data[i] & 0xFE) | bit;
-    }
+    // The header goes in last, once the CRC32C of the shadow data is known
+    StegoMetaT tagged = *meta;
+    tagged.shadow_crc = lsb_encoder_embed_shadow_range(cover, meta, seed, shadow_data, 0, shadow_len, 0);
+    uint8_t header[STEGO_META_MAX_SIZE];
+    size_t header_len = stego_meta_serialize(&tagged, header);
+    lsb_encoder_lsb1_embed_bytes(cover->pixels, header, header_len);
 
-    size_t shadow_byte_index = 0;
-    uint16_t current_word = shadow_data[shadow_byte_index];
-    int bit_index = 7; // Start from MSB
+    return true;
+}
 
-    for (; i < cover_capacity && shadow_byte_index < shadow_len; ++i)
+uint32_t lsb_encoder_embed_shadow_range(BMPImageT *cover, const StegoMetaT *meta, uint16_t seed,
+                                        const uint8_t *bytes, size_t offset, size_t len, uint32_t crc)
+{
+    const SSSKernelsT *kernels = sss_kernels_active();
+    SSSEmbedKernelFnT embed = sss_kernels_embed(kernels, meta->lsb_bits);
+    size_t region_offset = stego_meta_shadow_offset(meta);
+    uint8_t *region = (uint8_t *)cover->pixels + region_offset;
+    bool scattered = meta->layout == STEGO_META_LAYOUT_SCATTER;
+    ScatterT scatter;
+    if (scattered)
+        scatter_init(&scatter, (size_t)bmp_stride(cover) * cover->height - region_offset, seed);
+
+    // Each chunk is tagged right before it is embedded, while it is still in L1
+    while (len > 0)
     {
-        // Clear LSB of cover byte
-        cover_data[i] &= 0xFE;
-
-        // Insert current bit from shadow
-        uint8_t bit = (current_word >> bit_index) & 0x01;
-        cover_data[i] |= bit;
-
-        bit_index--;
-        if (bit_index < 0)
-        {
-            bit_index = 7;
-            shadow_byte_index++;
-            if (shadow_byte_index < shadow_len)
-            {
-                current_word = shadow_data[shadow_byte_index];
-            }
-        }
+        size_t run = len < LSB_CRC_CHUNK ? len : LSB_CRC_CHUNK;
+        crc = kernels->crc32c(crc, bytes, run);
+        if (scattered)
+            scatter_embed(&scatter, embed, meta->lsb_bits, region, bytes, offset, run);
+        else
+            embed(region + offset * (8 / meta->lsb_bits), bytes, run);
+        bytes += run;
+        offset += run;
+        len -= run;
     }
-
-    return true;
+    return crc;
 }
 
-#undef METADATA_SIZE
\ No newline at end of file
+#undef LSB_CRC_CHUNK
@@ -1,33 +1,109 @@
 #include "../include/sss.h"
+#include "../include/sss_update.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <dirent.h>
 #include "../include/sss_helpers.h"
+#include "../include/keystream_cache.h"
+#include "../include/stats.h"
+#include "../include/bmp_writer.h"
+#include "../include/bmp_pool.h"
+#include "../include/arena.h"
+#include "../include/cover_cache.h"
+#include "../include/server.h"
+#include "../include/stego_meta.h"
+#include "../include/compress.h"
 
-int main(int argc, char const *argv[]) {
+static bool gl_serving = false; // Running the requests of --serve
+
+static int shamigo_serve(const char *socket_path, const char *kcache_path, size_t kcache_size, size_t cover_cache_size);
+
+// Amount of .bmp files in a directory, or -1 if it cannot be read
+static int count_bmp_files(const char *dir) {
+    stats_begin(STATS_SCAN);
+    DIR *dp = opendir(dir);
+    if (!dp) {
+        stats_end(STATS_SCAN);
+        perror("Could not open the directory");
+        return -1;
+    }
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dp))) {
+        if (sssh_is_bmp_entry(entry)) {
+            count++;
+        }
+    }
+    closedir(dp);
+    stats_end(STATS_SCAN);
+    return count;
+}
+
+static int shamigo_main(int argc, char *argv[]) {
     int distribute = 0;
     int recover = 0;
+    int extend = 0;
+    char *old_secret_file = NULL;
+    const char *dict_path = NULL;
+    int x = -1;
+    char *cover_file = NULL;
     char *secret_file = NULL;
+    // Repeated --secret packs several secrets into the same stego images
+    char *secret_files[STEGO_META_MAX_ENTRIES];
+    int secret_count = 0;
+    int entry = 0;
     char *dir = ".";
     int k = -1;
     int n = -1;
+    SSSOptionsT opts;
+    sss_options_init(&opts);
+    // A server opened the cache of its environment already
+    const char *kcache_path = gl_serving ? NULL : getenv("SHAMIGO_KCACHE");
+    size_t kcache_size = KSCACHE_DEFAULT_MAX_BYTES;
+    const char *serve_path = NULL;
+    size_t cover_cache_size = COVER_CACHE_DEFAULT_MAX_BYTES;
+    int stats = 0;
+    StatsFormatT stats_format = STATS_FORMAT_TABLE;
 
     static struct option long_options[] = {
         {"d",       no_argument,       0, 'd'},
         {"r",       no_argument,       0, 'r'},
+        {"extend",  no_argument,       0, 'E'},
+        {"x",       required_argument, 0, 'x'},
+        {"cover",   required_argument, 0, 'c'},
+        {"update",  required_argument, 0, 'U'},
         {"secret",  required_argument, 0, 's'},
+        {"entry",   required_argument, 0, 'e'},
         {"k",       required_argument, 0, 'k'},
         {"n",       required_argument, 0, 'n'},
         {"dir",     required_argument, 0, 'D'},
+        {"keystream", required_argument, 0, 'K'},
+        {"lsb",     required_argument, 0, 'L'},
+        {"packed",  no_argument,       0, 'B'},
+        {"scatter", no_argument,       0, 'X'},
+        {"compress", required_argument, 0, 'z'},
+        {"dict",    required_argument, 0, 'I'},
+        {"stripes", required_argument, 0, 'T'},
+        {"kcache",  required_argument, 0, 'C'},
+        {"kcache-size", required_argument, 0, 'Z'},
+        {"stats",   optional_argument, 0, 'S'},
+        {"pipeline", no_argument,      0, 'P'},
+        {"mem-budget", required_argument, 0, 'M'},
+        {"writer",  required_argument, 0, 'W'},
+        {"fsync",   no_argument,       0, 'F'},
+        {"huge-pages", no_argument,    0, 'H'},
+        {"serve",   required_argument, 0, 'V'},
+        {"cover-cache", required_argument, 0, 'Y'},
         {0, 0, 0, 0}
     };
 
     int opt;
     int option_index = 0;
+    optind = 0; // Requests of a server parse a new command line each time
 
-    while ((opt = getopt_long(argc, (char * const *)argv, "drs:k:n:D:", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, (char * const *)argv, "drEx:c:U:s:e:k:n:D:K:L:BXz:I:T:C:Z:S::PM:W:FHV:Y:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'd':
                 distribute = 1;
@@ -35,8 +111,28 @@ int main(int argc, char const *argv[]) {
             case 'r':
                 recover = 1;
                 break;
+            case 'E':
+                extend = 1;
+                break;
+            case 'x':
+                x = atoi(optarg);
+                break;
+            case 'c':
+                cover_file = optarg;
+                break;
+            case 'U':
+                old_secret_file = optarg;
+                break;
             case 's':
-                secret_file = optarg;
+                if (secret_count == STEGO_META_MAX_ENTRIES) {
+                    fprintf(stderr, "Error: at most %d secrets can be packed together\n", STEGO_META_MAX_ENTRIES);
+                    return 1;
+                }
+                secret_files[secret_count++] = optarg;
+                secret_file = secret_files[0];
+                break;
+            case 'e':
+                entry = atoi(optarg);
                 break;
             case 'k':
                 k = atoi(optarg);
@@ -47,69 +143,376 @@ int main(int argc, char const *argv[]) {
             case 'D':
                 dir = optarg;
                 break;
+            case 'K':
+                if (strcmp(optarg, "lcg") == 0) {
+                    opts.keystream = RNGPT_MODE_LCG48;
+                } else if (strcmp(optarg, "ctr") == 0) {
+                    opts.keystream = RNGPT_MODE_CTR;
+                } else {
+                    fprintf(stderr, "Error: Unknown keystream '%s' (expected lcg or ctr)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'L':
+                opts.lsb_bits = (uint8_t)atoi(optarg);
+                if (!stego_meta_lsb_bits_valid(opts.lsb_bits)) {
+                    fprintf(stderr, "Error: Unknown LSB mode '%s' (expected 1, 2 or 4)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'B':
+                opts.share_bits = STEGO_META_SHARE_PACKED;
+                break;
+            case 'X':
+                opts.scatter = true;
+                break;
+            case 'C':
+                kcache_path = optarg;
+                break;
+            case 'Z':
+                kcache_size = (size_t)atol(optarg) << 20;
+                break;
+            case 'z': {
+                CompressCodecT codec;
+                if (!compress_codec_parse(optarg, &codec)) {
+                    fprintf(stderr, "Error: Unknown compression '%s' (expected none, rle or lz)\n", optarg);
+                    return 1;
+                }
+                opts.compress = codec;
+                break;
+            }
+            case 'I':
+                dict_path = optarg;
+                break;
+            case 'T': {
+                int stripes = atoi(optarg);
+                if (stripes < 1 || stripes > STEGO_META_MAX_STRIPES) {
+                    fprintf(stderr, "Error: --stripes must be between 1 and %d\n", STEGO_META_MAX_STRIPES);
+                    return 1;
+                }
+                opts.stripes = (uint8_t)stripes;
+                break;
+            }
+            case 'P':
+                opts.pipeline = true;
+                break;
+            case 'M':
+                opts.mem_budget = (size_t)atol(optarg) << 20;
+                break;
+            case 'W': {
+                BMPWriterModeT writer;
+                if (!bmp_writer_mode_parse(optarg, &writer)) {
+                    fprintf(stderr, "Error: Unknown writer '%s' (expected auto, uring, threads or stdio)\n", optarg);
+                    return 1;
+                }
+                opts.writer = writer;
+                break;
+            }
+            case 'F':
+                opts.fsync = true;
+                break;
+            case 'H':
+                arena_set_default_flags(ARENA_HUGE_PAGES);
+                break;
+            case 'V':
+                serve_path = optarg;
+                break;
+            case 'Y':
+                cover_cache_size = (size_t)atol(optarg) << 20;
+                break;
+            case 'S':
+                stats = 1;
+                if (optarg == NULL || strcmp(optarg, "table") == 0) {
+                    stats_format = STATS_FORMAT_TABLE;
+                } else if (strcmp(optarg, "json") == 0) {
+                    stats_format = STATS_FORMAT_JSON;
+                } else {
+                    fprintf(stderr, "Error: Unknown stats format '%s' (expected table or json)\n", optarg);
+                    return 1;
+                }
+                break;
             default:
-                fprintf(stderr, "Usage: %s --d|--r --secret file --k num [--n num] [--dir directory]\n", argv[0]);
+                fprintf(stderr, "Usage: %s --d|--r --secret file --k num [--n num] [--dir directory] [--keystream lcg|ctr] [--lsb 1|2|4] [--packed] [--scatter] [--compress none|rle|lz [--dict file]] [--stripes num] [--entry num] [--kcache file [--kcache-size MiB]] [--stats[=table|json]] [--pipeline [--mem-budget MiB]] [--writer auto|uring|threads|stdio] [--fsync] [--huge-pages] [--serve socket [--cover-cache MiB]] [--client socket]\n"
+                                "       %s --extend --x num --cover file --k num [--n num] [--dir directory] [--writer auto|uring|threads|stdio] [--fsync]\n"
+                                "       %s --update old_file --secret file --k num [--dir directory] [--fsync]\n", argv[0], argv[0], argv[0]);
                 return 1;
         }
     }
 
+    if (serve_path) {
+        if (gl_serving) {
+            fprintf(stderr, "Error: --serve cannot be sent to a server\n");
+            return 1;
+        }
+        return shamigo_serve(serve_path, kcache_path, kcache_size, cover_cache_size);
+    }
+
     // Validation of mandatory parameters
-    if ((distribute + recover) != 1 || !secret_file || k <= 0) {
+    int update = old_secret_file != NULL;
+    if ((distribute + recover + extend + update) != 1 || (!extend && !secret_file) || k <= 0) {
         fprintf(stderr, "Error: Missing or incorrect mandatory parameters.\n");
         fprintf(stderr, "Use: %s -d|-r -secret archivo -k num [-n num] [-dir directory]\n", argv[0]);
         return 1;
     }
+    if (secret_count > 1 && !distribute) {
+        fprintf(stderr, "Error: several --secret files are only packed by --d; recover them one at a time with --entry.\n");
+        return 1;
+    }
+    if ((entry != 0 && !recover) || entry < 0) {
+        fprintf(stderr, "Error: --entry takes the 1-based place of a packed secret, and only with --r.\n");
+        return 1;
+    }
+    if (extend && (x <= 0 || !cover_file)) {
+        fprintf(stderr, "Error: --extend needs the x coordinate of the new share (--x) and its cover (--cover).\n");
+        return 1;
+    }
+
+    // "-" streams the secret through stdin (distribute) or stdout (recover)
+    bool secret_stdio = secret_file && strcmp(secret_file, "-") == 0;
+    for (int i = 1; i < secret_count; i++) {
+        secret_stdio = secret_stdio || strcmp(secret_files[i], "-") == 0;
+    }
+    if (secret_stdio && secret_count > 1) {
+        fprintf(stderr, "Error: --secret - streams a single secret, it cannot be packed with others\n");
+        return 1;
+    }
+    if (secret_stdio && gl_serving) {
+        fprintf(stderr, "Error: --secret - is not available through a server, the client's stdin and stdout do not reach it\n");
+        return 1;
+    }
 
-    if (distribute) {
+    if (stats) {
+        stats_enable();
+    }
+
+    // Same dictionary in distribution and recovery; it is checked against the stego metadata
+    CompressDictT *dict = NULL;
+    if (dict_path) {
+        dict = compress_dict_load(dict_path);
+        if (!dict) {
+            return 1;
+        }
+        compress_dict_set_default(dict);
+    }
+
+    int status = 0;
+    KeystreamCacheT *kcache = NULL;
+    KeystreamCacheT *server_kcache = kscache_get_default();
+    if (kcache_path && *kcache_path) {
+        kcache = kscache_open(kcache_path, kcache_size, KSCACHE_DEFAULT_PREFIX_LEN);
+        if (!kcache) {
+            fprintf(stderr, "Warning: keystream cache '%s' unavailable, generating keystreams\n", kcache_path);
+        }
+        kscache_set_default(kcache);
+    }
+
+    // Covers and stego images go back here once written, so later loads reuse their buffers.
+    // A server sets up its pool once, for every request.
+    BMPPoolT *pool = bmp_pool_get_default();
+    bool own_pool = pool == NULL;
+    if (own_pool) {
+        pool = bmp_pool_create(BMP_POOL_DEFAULT_IDLE);
+        bmp_pool_set_default(pool);
+    }
+
+    if (update) {
+        // Update the stego images in place, where the secret changed
+        BmpImage *image = secret_stdio ? bmp_pool_load_stream(pool, stdin) : bmp_pool_load(pool, secret_file);
+        BmpImage *old_image = bmp_pool_load(pool, old_secret_file);
+        if (!image || !old_image) {
+            fprintf(stderr, "Could not load secret image: %s\n", !image ? (secret_stdio ? "stdin" : secret_file) : old_secret_file);
+            status = 1;
+        } else if (!sss_update(old_image, image, k, dir, &opts)) {
+            fprintf(stderr, "Failure to update the stego images\n");
+            status = 1;
+        }
+        bmp_pool_release(pool, image);
+        bmp_pool_release(pool, old_image);
+    } else if (distribute && secret_count > 1) {
+        // Distribute several secrets into the same stego images
+        BmpImage *images[STEGO_META_MAX_ENTRIES];
+        int loaded = 0;
+        for (; loaded < secret_count; loaded++) {
+            images[loaded] = bmp_pool_load(pool, secret_files[loaded]);
+            if (!images[loaded]) {
+                fprintf(stderr, "Could not load secret image: %s\n", secret_files[loaded]);
+                status = 1;
+                break;
+            }
+        }
+
+        if (status == 0 && n == -1) {
+            n = count_bmp_files(dir);
+            status = n < 0;
+        }
+        if (status == 0 && !sss_distribute_many(images, secret_count, k, n, dir, "./stego_images", &opts)) {
+            status = 1;
+        }
+        for (int i = 0; i < loaded; i++) {
+            bmp_pool_release(pool, images[i]);
+        }
+    } else if (distribute) {
         // Distribute
-        BmpImage *image = bmp_load(secret_file);
+        BmpImage *image = secret_stdio ? bmp_pool_load_stream(pool, stdin) : bmp_pool_load(pool, secret_file);
         if (!image) {
-            fprintf(stderr, "Could not load secret image: %s", secret_file);
-            return 1;
+            fprintf(stderr, "Could not load secret image: %s\n", secret_stdio ? "stdin" : secret_file);
+            status = 1;
+            goto cleanup;
         }
 
-        // If n was not specified, search for all images in the directory
+        // If n was not specified, search for all images in the directory, a stripe of a share each
         if (n == -1) {
-            DIR *dp = opendir(dir);
-            if (!dp) {
-                perror("Could not open the directory");
-                return 1;
+            n = count_bmp_files(dir);
+            if (n < 0) {
+                bmp_pool_release(pool, image);
+                status = 1;
+                goto cleanup;
             }
-            n = 0;
-            struct dirent *entry;
-            while ((entry = readdir(dp))) {
-                if (strstr(entry->d_name, ".bmp")) {
-                    n++;
-                }
-            }
-            closedir(dp);
+            n /= opts.stripes;
         }
 
-        sss_distribute(image, k, n, dir, "./stego_images");
-        bmp_unload(image);
-    } else if (recover) {
-        // Recover
+        if (!sss_distribute(image, k, n, dir, "./stego_images", &opts)) {
+            status = 1;
+        }
+        bmp_pool_release(pool, image);
+    } else {
+        // Recover or extend, from every stego image in the directory unless n was specified:
+        // the ones past k check the others and stand in for corrupt ones
         if (n == -1) {
-            n = k;
+            n = count_bmp_files(dir);
+            if (n < 0) {
+                status = 1;
+                goto cleanup;
+            }
+            // Striped shadows take several stego images each
+            n = n < k ? k : n > SSS_MAX_N * STEGO_META_MAX_STRIPES ? SSS_MAX_N * STEGO_META_MAX_STRIPES : n;
         }
 
         BMPImageT **shadows = load_bmp_images(dir, n, NULL, NULL);
         if (!shadows) {
-            return 1;
+            status = 1;
+            goto cleanup;
         }
 
-        BMPImageT *recovered = sss_recover(shadows, k, secret_file);
-        if (recovered) {
-            bmp_save(secret_file, recovered);
-            bmp_unload(recovered);
+        if (recover) {
+            BMPImageT *recovered = entry > 0 ? sss_recover_entry(shadows, n, k, entry - 1) : sss_recover(shadows, n, k);
+            if (recovered) {
+                int saved = secret_stdio ? bmp_save_stream(stdout, recovered) : bmp_save(secret_file, recovered);
+                if (saved != 0) {
+                    fprintf(stderr, "Could not save the recovered secret: %s\n", secret_stdio ? "stdout" : secret_file);
+                    status = 1;
+                }
+                bmp_pool_release(pool, recovered);
+            } else {
+                fprintf(stderr, "Failure to recover the secret\n");
+                status = 1;
+            }
         } else {
-            fprintf(stderr, "Failure to recover the secret\n");
+            // Only the new stego image is written, next to the others
+            BMPImageT *cover = bmp_pool_load(pool, cover_file);
+            if (!cover) {
+                fprintf(stderr, "Could not load cover image: %s\n", cover_file);
+                status = 1;
+            } else {
+                if (!sss_extend(shadows, n, k, x, cover, dir, &opts)) {
+                    fprintf(stderr, "Failure to extend the share set\n");
+                    status = 1;
+                }
+                bmp_pool_release(pool, cover);
+            }
+        }
+        free_bmp_images(shadows, n);
+    }
+
+cleanup:
+    compress_dict_free(dict);
+    if (own_pool) {
+        bmp_pool_destroy(pool);
+    }
+
+    if (kcache) {
+        kscache_close(kcache);
+        kscache_set_default(server_kcache);
+    }
+    if (stats) {
+        stats_print(stderr, stats_format);
+    }
+    return status;
+}
+
+/**
+ * @brief Runs one request of a server. Process-wide settings a request may change are put back.
+ */
+static int shamigo_serve_request(int argc, char *argv[]) {
+    unsigned arena_flags = arena_get_default_flags();
+    int status = shamigo_main(argc, argv);
+    arena_set_default_flags(arena_flags);
+    stats_disable();
+    return status;
+}
+
+/**
+ * @brief Serves requests until stopped, keeping the pools and caches of the process warm.
+ */
+static int shamigo_serve(const char *socket_path, const char *kcache_path, size_t kcache_size, size_t cover_cache_size) {
+    KeystreamCacheT *kcache = NULL;
+    if (kcache_path && *kcache_path) {
+        kcache = kscache_open(kcache_path, kcache_size, KSCACHE_DEFAULT_PREFIX_LEN);
+        if (!kcache) {
+            fprintf(stderr, "Warning: keystream cache '%s' unavailable, generating keystreams\n", kcache_path);
         }
-        for (int i = 0; i < n; i++) {
-            bmp_unload(shadows[i]);
+        kscache_set_default(kcache);
+    }
+
+    BMPPoolT *pool = bmp_pool_create(BMP_POOL_DEFAULT_IDLE);
+    bmp_pool_set_default(pool);
+    CoverCacheT *covers = cover_cache_create(cover_cache_size);
+    cover_cache_set_default(covers);
+
+    gl_serving = true;
+    int status = server_run(socket_path, shamigo_serve_request);
+    gl_serving = false;
+
+    uint64_t hits, misses;
+    cover_cache_counts(covers, &hits, &misses);
+    fprintf(stderr, "Cover cache: %llu hits, %llu misses\n", (unsigned long long)hits, (unsigned long long)misses);
+
+    cover_cache_destroy(covers);
+    bmp_pool_destroy(pool);
+    kscache_close(kcache);
+    return status;
+}
+
+int main(int argc, char const *argv[]) {
+    // A client sends every other argument to the server, which runs them as its own command line
+    for (int i = 1; i < argc; i++) {
+        const char *client_path = NULL;
+        int skip = 0;
+        if (strcmp(argv[i], "--client") == 0 && i + 1 < argc) {
+            client_path = argv[i + 1];
+            skip = 2;
+        } else if (strncmp(argv[i], "--client=", 9) == 0) {
+            client_path = argv[i] + 9;
+            skip = 1;
+        }
+
+        if (client_path) {
+            char **args = calloc(argc, sizeof(char *));
+            if (!args) {
+                fprintf(stderr, "Out of memory\n");
+                return 1;
+            }
+            int count = 0;
+            for (int j = 1; j < argc; j++) {
+                if (j < i || j >= i + skip) {
+                    args[count++] = (char *)argv[j];
+                }
+            }
+            int status = server_client(client_path, count, args);
+            free(args);
+            return status;
         }
-        free(shadows);
     }
 
-    return 0;
+    return shamigo_main(argc, (char **)argv);
 }
@@ -1,4 +1,5 @@
 #include "../include/permutation_table.h"
+#include "../include/sss_kernels.h"
 
 static uint16_t gl_seed_gen = 0L;
 static int64_t gl_seed = 0L;
@@ -11,6 +12,18 @@ rngpt_set_seed(int64_t s)
     gl_seed = ((int64_t)s16 ^ 0x5DEECE66DL) & ((1LL << 48) - 1);
 }
 
+int64_t
+rngpt_get_state(void)
+{
+    return gl_seed;
+}
+
+void
+rngpt_set_state(int64_t state)
+{
+    gl_seed = state & ((1LL << 48) - 1);
+}
+
 uint8_t
 rngpt_next_char(void)
 {
@@ -18,6 +31,28 @@ rngpt_next_char(void)
     return (uint8_t)(gl_seed >> 40);
 }
 
+void
+rngpt_fill_bytes(uint8_t *table, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        table[i] = rngpt_next_char();
+    }
+}
+
+void
+rngpt_xor_stream(uint8_t *data, size_t size)
+{
+    // Small enough for the stack, large enough for the vector XOR kernel to pay off
+    uint8_t chunk[4096];
+    for (size_t done = 0; done < size; done += sizeof(chunk))
+    {
+        size_t len = size - done < sizeof(chunk) ? size - done : sizeof(chunk);
+        rngpt_fill_bytes(chunk, len);
+        rngpt_inplace_xor(data + done, chunk, len);
+    }
+}
+
 uint8_t *
 rngpt_get_byte_table_noalign(size_t size)
 {
@@ -29,60 +64,120 @@ rngpt_get_byte_table_noalign(size_t size)
         return NULL;
     }
 
-    for (int i = 0; i < size * sizeof(uint8_t); i++)
-    {
-        table[i] = rngpt_next_char();
-    }
+    rngpt_fill_bytes(table, size);
     return table;
 }
 
 uint8_t *
 rngpt_get_byte_table_4balign(BMPImageT *image)
 {
-    int scanline_size = bmp_align(image->width);
-    int image_size = scanline_size * image->height;
-    uint8_t *table = malloc(image_size * sizeof(uint8_t));
+    // Scanlines are contiguous, so the padded table is just one stream of stride * height bytes
+    return rngpt_get_byte_table_noalign((size_t)bmp_stride(image) * image->height);
+}
 
-    if (table == NULL)
+void
+rngpt_inplace_xor(uint8_t *table1, uint8_t *table2, size_t size)
+{
+    sss_kernels_active()->xor_bytes(table1, table2, size);
+}
+
+void
+rngpt_xor_bytes_scalar(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
     {
-        fprintf(stderr, "Failed to allocate memory for RNG table\n");
-        return NULL;
+        dst[i] ^= src[i];
+    }
+}
+
+void
+rngpt_inplace_xor_aligned(BMPImageT *image, uint8_t *table)
+{
+    // The table covers the padding too, so rows can be XORed back to back
+    rngpt_inplace_xor(image->pixels, table, (size_t)bmp_stride(image) * image->height);
+}
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+#define PHILOX_LANES 4
+
+void
+rngpt_ctr_blocks4(uint16_t seed, uint64_t counter, uint8_t *out)
+{
+    // Lanes are independent blocks, laid out so that every round is a plain 4-wide loop
+    uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES], c3[PHILOX_LANES];
+    for (int l = 0; l < PHILOX_LANES; l++)
+    {
+        uint64_t ctr = counter + l;
+        c0[l] = (uint32_t)ctr;
+        c1[l] = (uint32_t)(ctr >> 32);
+        c2[l] = 0;
+        c3[l] = 0;
     }
 
-    for (int y = 0; y < image->height; y++)
+    uint32_t k0 = seed ^ 0x5DEECE66u;
+    uint32_t k1 = 0xB;
+    for (int r = 0; r < PHILOX_ROUNDS; r++)
     {
-        for (int x = 0; x < scanline_size; x++)
+        for (int l = 0; l < PHILOX_LANES; l++)
         {
-            int index = y * scanline_size + x;
-            if (index < image_size)
-            {
-                table[index] = rngpt_next_char();
-            }
+            uint64_t p0 = (uint64_t)PHILOX_M0 * c0[l];
+            uint64_t p1 = (uint64_t)PHILOX_M1 * c2[l];
+            uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+            uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+            c1[l] = (uint32_t)p1;
+            c3[l] = (uint32_t)p0;
+            c0[l] = n0;
+            c2[l] = n2;
         }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
     }
-    
-    return table;
-}
 
-void
-rngpt_inplace_xor(uint8_t *table1, uint8_t *table2, size_t size)
-{
-    for (size_t i = 0; i < size; i++)
+    for (int l = 0; l < PHILOX_LANES; l++)
     {
-        table1[i] ^= table2[i];
+        uint32_t words[4] = {c0[l], c1[l], c2[l], c3[l]};
+        for (int w = 0; w < 4; w++)
+        {
+            uint8_t *o = out + l * RNGPT_CTR_BLOCK_SIZE + w * 4;
+            o[0] = words[w] & 0xFF;
+            o[1] = (words[w] >> 8) & 0xFF;
+            o[2] = (words[w] >> 16) & 0xFF;
+            o[3] = (words[w] >> 24) & 0xFF;
+        }
     }
 }
 
 void
-rngpt_inplace_xor_aligned(BMPImageT *image, uint8_t *table)
+rngpt_ctr_xor(uint8_t *buf, size_t size, uint16_t seed, uint64_t offset)
 {
-    int scanline_size = bmp_align(image->width);
-    int image_size = scanline_size * image->height;
-    for (int i = 0; i < image_size; i++)
+    uint8_t stream[PHILOX_LANES * RNGPT_CTR_BLOCK_SIZE];
+    const size_t chunk = sizeof(stream);
+
+    size_t i = 0;
+    while (i < size)
     {
-        int x = i % scanline_size;
-        int y = i / scanline_size;
-        int8_t *ptr = bmp_get_pixel_address(image, x, y);
-        *ptr ^= table[i];
+        // Align to a 4-block boundary of the keystream so any offset yields the same bytes
+        uint64_t pos = offset + i;
+        uint64_t base = pos - pos % chunk;
+        size_t skip = pos - base;
+        size_t len = chunk - skip;
+        if (len > size - i)
+            len = size - i;
+
+        rngpt_ctr_blocks4(seed, base / RNGPT_CTR_BLOCK_SIZE, stream);
+        for (size_t j = 0; j < len; j++)
+            buf[i + j] ^= stream[skip + j];
+        i += len;
     }
 }
+
+#undef PHILOX_M0
+#undef PHILOX_M1
+#undef PHILOX_W0
+#undef PHILOX_W1
+#undef PHILOX_ROUNDS
+#undef PHILOX_LANES
@@ -0,0 +1,81 @@
+#include "../include/scatter.h"
+
+static uint64_t scatter_splitmix(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t scatter_round(uint32_t half, uint32_t key)
+{
+    uint64_t mixed = (uint64_t)(half ^ key) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(mixed >> 32) ^ (uint32_t)mixed;
+}
+
+void scatter_init(ScatterT *scatter, size_t region_len, uint16_t seed)
+{
+    scatter->blocks = region_len / SCATTER_BLOCK;
+
+    // Smallest even-width domain holding every block, so that both halves are the same width
+    scatter->half_bits = 1;
+    while (scatter->half_bits < 32 && ((uint64_t)1 << (2 * scatter->half_bits)) < scatter->blocks)
+        scatter->half_bits++;
+
+    uint64_t state = seed;
+    for (int r = 0; r < SCATTER_ROUNDS; r++)
+        scatter->keys[r] = (uint32_t)scatter_splitmix(&state);
+}
+
+uint64_t scatter_block(const ScatterT *scatter, uint64_t block)
+{
+    unsigned bits = scatter->half_bits;
+    uint64_t mask = ((uint64_t)1 << bits) - 1;
+
+    // The domain is less than four times the region, so a few walks at most on average
+    do
+    {
+        uint64_t left = block >> bits, right = block & mask;
+        for (int r = 0; r < SCATTER_ROUNDS; r++)
+        {
+            uint64_t next = left ^ (scatter_round((uint32_t)right, scatter->keys[r]) & mask);
+            left = right;
+            right = next;
+        }
+        block = left << bits | right;
+    } while (block >= scatter->blocks);
+    return block;
+}
+
+void scatter_embed(const ScatterT *scatter, SSSEmbedKernelFnT embed, unsigned lsb_bits,
+                   uint8_t *region, const uint8_t *bytes, size_t offset, size_t len)
+{
+    size_t per_block = SCATTER_BLOCK * lsb_bits / 8;
+    while (len > 0)
+    {
+        size_t within = offset % per_block;
+        size_t run = per_block - within < len ? per_block - within : len;
+        uint64_t block = scatter_block(scatter, offset / per_block);
+        embed(region + block * SCATTER_BLOCK + within * (8 / lsb_bits), bytes, run);
+        bytes += run;
+        offset += run;
+        len -= run;
+    }
+}
+
+void scatter_extract(const ScatterT *scatter, SSSExtractKernelFnT extract, unsigned lsb_bits,
+                     const uint8_t *region, uint8_t *bytes, size_t offset, size_t len)
+{
+    size_t per_block = SCATTER_BLOCK * lsb_bits / 8;
+    while (len > 0)
+    {
+        size_t within = offset % per_block;
+        size_t run = per_block - within < len ? per_block - within : len;
+        uint64_t block = scatter_block(scatter, offset / per_block);
+        extract(region + block * SCATTER_BLOCK + within * (8 / lsb_bits), bytes, run);
+        bytes += run;
+        offset += run;
+        len -= run;
+    }
+}
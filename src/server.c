@@ -0,0 +1,379 @@
+#define _GNU_SOURCE // accept4
+#include "../include/server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_BACKLOG 16
+#define SERVER_CLIENT_TIMEOUT 10 // Seconds a client may take to send its request
+
+static volatile sig_atomic_t gl_server_stop = 0;
+
+static void server_on_signal(int sig)
+{
+    (void)sig;
+    gl_server_stop = 1;
+}
+
+static bool server_read_full(int fd, void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    while (len > 0)
+    {
+        ssize_t got = read(fd, p, len);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        p += got;
+        len -= got;
+    }
+    return true;
+}
+
+static bool server_write_full(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    while (len > 0)
+    {
+        ssize_t put = write(fd, p, len);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return false;
+        p += put;
+        len -= put;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends a frame whose payload is the concatenation of two buffers.
+ */
+static bool server_send_frame(int fd, const void *head, size_t head_len, const void *body, size_t body_len)
+{
+    uint32_t len = htonl((uint32_t)(head_len + body_len));
+    return server_write_full(fd, &len, sizeof(len)) && server_write_full(fd, head, head_len) &&
+           server_write_full(fd, body, body_len);
+}
+
+/**
+ * @brief Receives a frame.
+ * @param max The largest payload accepted.
+ * @param len Receives the payload length.
+ * @return The payload followed by a NUL byte, to be freed by the caller, or NULL on failure.
+ */
+static uint8_t *server_recv_frame(int fd, uint32_t max, uint32_t *len)
+{
+    uint32_t net_len;
+    if (!server_read_full(fd, &net_len, sizeof(net_len)))
+        return NULL;
+
+    *len = ntohl(net_len);
+    if (*len > max)
+        return NULL;
+
+    uint8_t *payload = malloc((size_t)*len + 1);
+    if (payload == NULL)
+        return NULL;
+    if (!server_read_full(fd, payload, *len))
+    {
+        free(payload);
+        return NULL;
+    }
+    payload[*len] = '\0';
+    return payload;
+}
+
+static bool server_fill_address(struct sockaddr_un *addr, const char *socket_path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return false;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return true;
+}
+
+static int server_listen(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    if (!server_fill_address(&addr, socket_path))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("Error creating the server socket");
+        return -1;
+    }
+
+    // A socket nobody answers on was left by a server that did not shut down cleanly
+    struct stat st;
+    if (lstat(socket_path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            fprintf(stderr, "'%s' exists and is not a socket\n", socket_path);
+            goto error;
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            fprintf(stderr, "A server is already listening on '%s'\n", socket_path);
+            goto error;
+        }
+        unlink(socket_path);
+        close(fd);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            perror("Error creating the server socket");
+            return -1;
+        }
+    }
+
+    // Requests read and write files as the server's user, so nobody else may connect
+    mode_t old_mask = umask(0077);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (bound != 0 || listen(fd, SERVER_BACKLOG) != 0)
+    {
+        perror("Error listening on the server socket");
+        goto error;
+    }
+    return fd;
+
+error:
+    close(fd);
+    return -1;
+}
+
+/**
+ * @brief Runs a request with stdout and stderr redirected to a temporary file.
+ * @param output Receives the captured output, to be freed by the caller, or NULL.
+ * @param output_len Receives the length of the captured output.
+ * @return The exit status of the request.
+ */
+static int server_run_captured(ServerHandlerFnT handler, int argc, char *argv[], const char *cwd,
+                               char **output, size_t *output_len)
+{
+    *output = NULL;
+    *output_len = 0;
+
+    FILE *capture = tmpfile();
+    int home = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    fflush(stdout);
+    fflush(stderr);
+    int saved_out = capture ? dup(STDOUT_FILENO) : -1;
+    int saved_err = capture ? dup(STDERR_FILENO) : -1;
+    bool captured = saved_out >= 0 && saved_err >= 0 && dup2(fileno(capture), STDOUT_FILENO) >= 0 &&
+                    dup2(fileno(capture), STDERR_FILENO) >= 0;
+
+    int status = 1;
+    if (home < 0 || chdir(cwd) != 0)
+        fprintf(stderr, "Error: Could not enter '%s': %s\n", cwd, strerror(errno));
+    else
+        status = handler(argc, argv);
+
+    if (home >= 0)
+    {
+        if (fchdir(home) != 0)
+            perror("Error returning to the server directory");
+        close(home);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    if (saved_out >= 0)
+    {
+        dup2(saved_out, STDOUT_FILENO);
+        close(saved_out);
+    }
+    if (saved_err >= 0)
+    {
+        dup2(saved_err, STDERR_FILENO);
+        close(saved_err);
+    }
+
+    if (captured)
+    {
+        off_t size = lseek(fileno(capture), 0, SEEK_END);
+        size_t len = size > 0 ? (size_t)size : 0;
+        if (len > SERVER_MAX_OUTPUT)
+            len = SERVER_MAX_OUTPUT;
+        *output = malloc(len > 0 ? len : 1);
+        if (*output != NULL)
+        {
+            ssize_t got = pread(fileno(capture), *output, len, 0);
+            *output_len = got > 0 ? (size_t)got : 0;
+        }
+    }
+    if (capture)
+        fclose(capture);
+    return status;
+}
+
+static void server_handle(int client, ServerHandlerFnT handler)
+{
+    struct timeval timeout = {SERVER_CLIENT_TIMEOUT, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    uint32_t len;
+    char *payload = (char *)server_recv_frame(client, SERVER_MAX_REQUEST, &len);
+    if (payload == NULL || len == 0 || payload[len - 1] != '\0')
+    {
+        free(payload);
+        return;
+    }
+
+    // The first string is the working directory, the rest are the arguments
+    int argc = 0;
+    for (uint32_t i = 0; i < len; i++)
+        argc += payload[i] == '\0';
+    char **argv = calloc(argc + 1, sizeof(char *));
+    if (argv == NULL)
+    {
+        free(payload);
+        return;
+    }
+    argv[0] = "shamigo";
+    char *cwd = payload;
+    char *arg = payload + strlen(payload) + 1;
+    for (int i = 1; i < argc; i++)
+    {
+        argv[i] = arg;
+        arg += strlen(arg) + 1;
+    }
+
+    char *output;
+    size_t output_len;
+    int status = server_run_captured(handler, argc, argv, cwd, &output, &output_len);
+    uint32_t net_status = htonl((uint32_t)status);
+    server_send_frame(client, &net_status, sizeof(net_status), output ? output : "", output_len);
+
+    free(output);
+    free(argv);
+    free(payload);
+}
+
+int server_run(const char *socket_path, ServerHandlerFnT handler)
+{
+    int fd = server_listen(socket_path);
+    if (fd < 0)
+        return 1;
+
+    // No SA_RESTART, so a signal interrupts accept and the loop notices the stop request
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = server_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "Serving on %s\n", socket_path);
+    int ret = 0;
+    while (!gl_server_stop)
+    {
+        int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("Error accepting a connection");
+            ret = 1;
+            break;
+        }
+        server_handle(client, handler);
+        close(client);
+    }
+
+    close(fd);
+    unlink(socket_path);
+    return ret;
+}
+
+int server_client(const char *socket_path, int argc, char *const argv[])
+{
+    struct sockaddr_un addr;
+    if (!server_fill_address(&addr, socket_path))
+        return 1;
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+    {
+        perror("Error getting the working directory");
+        return 1;
+    }
+
+    size_t len = strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++)
+        len += strlen(argv[i]) + 1;
+    if (len > SERVER_MAX_REQUEST)
+    {
+        fprintf(stderr, "Request too large for the server\n");
+        return 1;
+    }
+
+    char *request = malloc(len);
+    if (request == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the request\n");
+        return 1;
+    }
+    size_t pos = 0;
+    memcpy(request, cwd, strlen(cwd) + 1);
+    pos += strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++)
+    {
+        memcpy(request + pos, argv[i], strlen(argv[i]) + 1);
+        pos += strlen(argv[i]) + 1;
+    }
+
+    int status = 1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "Could not connect to the server at '%s': %s\n", socket_path, strerror(errno));
+        goto cleanup;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    uint32_t response_len;
+    uint8_t *response = NULL;
+    if (server_send_frame(fd, request, len, "", 0))
+        response = server_recv_frame(fd, sizeof(uint32_t) + SERVER_MAX_OUTPUT, &response_len);
+    if (response == NULL || response_len < sizeof(uint32_t))
+    {
+        fprintf(stderr, "The server closed the connection without answering\n");
+        free(response);
+        goto cleanup;
+    }
+
+    uint32_t net_status;
+    memcpy(&net_status, response, sizeof(net_status));
+    status = (int)ntohl(net_status);
+    fwrite(response + sizeof(net_status), 1, response_len - sizeof(net_status), stderr);
+    free(response);
+
+cleanup:
+    if (fd >= 0)
+        close(fd);
+    free(request);
+    return status;
+}
+
+#undef SERVER_BACKLOG
+#undef SERVER_CLIENT_TIMEOUT
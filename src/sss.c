@@ -1,43 +1,246 @@
 #include "../include/sss.h"
 #include "../include/sss_algos.h"
+#include "../include/sss_pipeline.h"
+#include "../include/bmp_writer.h"
+#include "../include/compress.h"
 
-static DistributeFnT get_distribute_function(uint32_t k)
+void sss_options_init(SSSOptionsT *opts)
 {
-    if (k == 8)
+    memset(opts, 0, sizeof(*opts));
+    opts->keystream = RNGPT_MODE_LCG48;
+    opts->lsb_bits = 1;
+    opts->share_bits = STEGO_META_SHARE_BYTE;
+    opts->scatter = false;
+    opts->compress = COMPRESS_NONE;
+    opts->stripes = 1;
+    opts->pipeline = false;
+    opts->mem_budget = SSS_PIPELINE_DEFAULT_BUDGET;
+    opts->writer = BMP_WRITER_AUTO;
+    opts->fsync = false;
+}
+
+static bool sss_options_are_default(const SSSOptionsT *opts)
+{
+    return opts->keystream == RNGPT_MODE_LCG48 && opts->lsb_bits == 1 &&
+           opts->share_bits == STEGO_META_SHARE_BYTE && !opts->scatter && opts->compress == COMPRESS_NONE &&
+           opts->stripes == 1;
+}
+
+static DistributeFnT get_distribute_function(uint32_t k, const SSSOptionsT *opts)
+{
+    if (k == 8 && sss_options_are_default(opts))
     {
         return sss_distribute_8;
     }
     return sss_distribute_generic;
 }
 
-static RecoverFnT get_recover_function(uint32_t k)
+/**
+ * @brief Whether most stego images carry a versioned header, so one damaged image does not
+ *        pick the scheme for the others.
+ */
+static bool sss_mostly_extended(BMPImageT **shadows, uint32_t count)
 {
-    if (k == 8)
+    uint32_t extended = 0;
+    for (uint32_t i = 0; i < count; i++)
+        extended += stego_meta_is_extended(shadows[i]);
+    return extended * 2 > count;
+}
+
+static RecoverFnT get_recover_function(BMPImageT **shadows, uint32_t count, uint32_t k)
+{
+    // Shadows carrying a versioned header always come from the generic scheme
+    if (k == 8 && !sss_mostly_extended(shadows, count))
     {
         return sss_recover_8;
     }
     return sss_recover_generic;
 }
 
-BMPImageT **sss_distribute(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir)
+static ExtendFnT get_extend_function(BMPImageT **shadows, uint32_t count, uint32_t k)
 {
-    if (k < 2 || k > 10)
+    if (k == 8 && !sss_mostly_extended(shadows, count))
     {
-        fprintf(stderr, "Invalid parameters: k must be between 2 and 10\n");
-        return NULL;
+        return sss_extend_8;
+    }
+    return sss_extend_generic;
+}
+
+/**
+ * @brief Checks the parameters shared by every distribution.
+ */
+static bool sss_distribute_params_valid(uint32_t k, uint32_t n, const SSSOptionsT *opts)
+{
+    if (opts->keystream >= RNGPT_MODE_COUNT)
+    {
+        fprintf(stderr, "Invalid parameters: unknown keystream mode %u\n", opts->keystream);
+        return false;
+    }
+
+    if (!stego_meta_lsb_bits_valid(opts->lsb_bits))
+    {
+        fprintf(stderr, "Invalid parameters: LSB mode must be 1, 2 or 4 bits, not %u\n", opts->lsb_bits);
+        return false;
+    }
+
+    if (!stego_meta_share_bits_valid(opts->share_bits))
+    {
+        fprintf(stderr, "Invalid parameters: shares must be stored in 8 or 9 bits, not %u\n", opts->share_bits);
+        return false;
+    }
+
+    if (opts->compress >= COMPRESS_CODEC_COUNT)
+    {
+        fprintf(stderr, "Invalid parameters: unknown compression codec %u\n", opts->compress);
+        return false;
+    }
+
+    if (opts->stripes == 0)
+    {
+        fprintf(stderr, "Invalid parameters: a shadow takes at least 1 stripe\n");
+        return false;
+    }
+
+    if (opts->stripes > 1 && opts->pipeline)
+    {
+        fprintf(stderr, "Invalid parameters: striped shadows are not distributed by the pipeline\n");
+        return false;
+    }
+
+    if (opts->writer >= BMP_WRITER_MODE_COUNT)
+    {
+        fprintf(stderr, "Invalid parameters: unknown writer %u\n", opts->writer);
+        return false;
+    }
+
+    if (k < SSS_MIN_K || k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", SSS_MIN_K, SSS_MAX_K);
+        return false;
     }
 
     if (n < 2 || n < k)
     {
-        fprintf(stderr, "Invalid parameters: n must be greater than 1, and k must be smaller than n");
+        fprintf(stderr, "Invalid parameters: n must be greater than 1, and k must be smaller than n\n");
+        return false;
+    }
+
+    // Shadows are evaluated at x = 1..n, which must stay distinct and non-zero mod 257
+    if (n > SSS_MAX_N)
+    {
+        fprintf(stderr, "Invalid parameters: n must be at most %d\n", SSS_MAX_N);
+        return false;
+    }
+    return true;
+}
+
+bool sss_distribute(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
+{
+    SSSOptionsT defaults;
+    if (opts == NULL)
+    {
+        sss_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    if (!sss_distribute_params_valid(k, n, opts))
+        return false;
+
+    return get_distribute_function(k, opts)(image, k, n, covers_dir, output_dir, opts);
+}
+
+bool sss_distribute_many(BMPImageT **images, uint32_t count, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
+{
+    SSSOptionsT defaults;
+    if (opts == NULL)
+    {
+        sss_options_init(&defaults);
+        opts = &defaults;
     }
 
-    get_distribute_function(k)(image, k, n, covers_dir, output_dir);
-    return NULL;
+    if (count == 1)
+        return sss_distribute(images[0], k, n, covers_dir, output_dir, opts);
+
+    if (count == 0 || count > STEGO_META_MAX_ENTRIES)
+    {
+        fprintf(stderr, "Invalid parameters: between 1 and %d secrets can be packed, not %u\n", STEGO_META_MAX_ENTRIES, count);
+        return false;
+    }
+
+    if (!sss_distribute_params_valid(k, n, opts))
+        return false;
+
+    if (opts->stripes > 1)
+    {
+        fprintf(stderr, "Invalid parameters: packed secrets cannot be split in stripes\n");
+        return false;
+    }
+
+    return sss_distribute_pack(images, count, k, n, covers_dir, output_dir, opts);
 }
 
-BMPImageT *sss_recover(BMPImageT **shadows, uint32_t k, const char * recovered_filename)
+BMPImageT *sss_recover(BMPImageT **shadows, uint32_t count, uint32_t k)
 {
-    BMPImageT *image = get_recover_function(k)(shadows, k, recovered_filename);
+    if (k < SSS_MIN_K || k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", SSS_MIN_K, SSS_MAX_K);
+        return NULL;
+    }
+    if (count < k)
+    {
+        fprintf(stderr, "Invalid parameters: %u stego images given, at least k = %u are needed\n", count, k);
+        return NULL;
+    }
+
+    BMPImageT *image = get_recover_function(shadows, count, k)(shadows, count, k);
     return image;
-}
\ No newline at end of file
+}
+
+BMPImageT *sss_recover_entry(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t index)
+{
+    if (k < SSS_MIN_K || k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", SSS_MIN_K, SSS_MAX_K);
+        return NULL;
+    }
+    if (count < k)
+    {
+        fprintf(stderr, "Invalid parameters: %u stego images given, at least k = %u are needed\n", count, k);
+        return NULL;
+    }
+
+    // The k = 8 layout holds a single secret
+    if (get_recover_function(shadows, count, k) == sss_recover_8)
+    {
+        if (index != 0)
+        {
+            fprintf(stderr, "Error: there is no secret %u, the stego images hold 1\n", index + 1);
+            return NULL;
+        }
+        return sss_recover_8(shadows, count, k);
+    }
+    return sss_recover_pack_entry(shadows, count, k, index);
+}
+
+bool sss_extend(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts)
+{
+    if (k < SSS_MIN_K || k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", SSS_MIN_K, SSS_MAX_K);
+        return false;
+    }
+    if (count < k)
+    {
+        fprintf(stderr, "Invalid parameters: %u stego images given, at least k = %u are needed\n", count, k);
+        return false;
+    }
+
+    // Same range as the x = 1..n of a distribution
+    if (x < 1 || x > SSS_MAX_N)
+    {
+        fprintf(stderr, "Invalid parameters: x must be between 1 and %d\n", SSS_MAX_N);
+        return false;
+    }
+
+    return get_extend_function(shadows, count, k)(shadows, count, k, (uint16_t)x, cover, output_dir, opts);
+}
@@ -1,10 +1,23 @@
 #include "../include/sss_algos.h"
+#include "../include/sss_kernels.h"
+#include "../include/sss_pipeline.h"
+#include "../include/bmp_writer.h"
+#include "../include/bmp_pool.h"
+#include "../include/stats.h"
+#include "../include/arena.h"
+#include "../include/bitpack.h"
+#include "../include/compress.h"
+#include "../include/sss_stripes.h"
 #include <assert.h>
+#include <unistd.h>
 
 #define PRIME_MODULUS 257
-#define MAX_K 10
-#define MIN_K 2
+#define MAX_K SSS_MAX_K
+#define MIN_K SSS_MIN_K
 #define MIN_N 2
+#define SSS_VERIFY_SAMPLES 64        // Sections sampled to locate a bad stego image in recovery
+#define SSS_VERIFY_MAX_SUBSETS 4096  // Subsets of k stego images tried before giving up
+#define SSS_META_CANDIDATES 8        // Different headers told apart when looking for the most common one
 
 bool hide_shadow_lsb_from_buffer(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed)
 {
@@ -54,30 +67,110 @@ bool hide_shadow_lsb_from_buffer(const uint8_t *shadow_data, size_t shadow_len,
     return true;
 }
 
-// Polynomial evaluation (mod 257)
-static inline uint16_t poly_eval(const uint8_t *coeffs, int r, uint16_t x)
+static uint64_t gl_overflow_fixups = 0;
+
+uint64_t sss_get_overflow_fixups(void)
+{
+    return __atomic_load_n(&gl_overflow_fixups, __ATOMIC_RELAXED);
+}
+
+// powers must be zeroed past column k, so vector kernels may run over whole blocks of a row
+static void sss_share_powers_fill(uint16_t *powers, int k, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        uint16_t *row = powers + (size_t)i * MAX_K;
+        row[0] = 1;
+        for (int j = 1; j < k; ++j)
+            row[j] = row[j - 1] * (i + 1) % PRIME_MODULUS;
+    }
+}
+
+uint16_t *sss_share_powers_create(int k, int n)
+{
+    uint16_t *powers = calloc((size_t)n * MAX_K, sizeof(uint16_t));
+    if (!powers)
+    {
+        fprintf(stderr, "Out of memory allocating share powers\n");
+        return NULL;
+    }
+
+    sss_share_powers_fill(powers, k, n);
+    return powers;
+}
+
+/*
+ * All n shares are computed as dot products against the power table, with the overflow
+ * check accumulated rather than branched on per share. When a share hits 256, which is
+ * rare, the first non-zero coefficient is decreased by one (as the scheme requires) and
+ * sss_share_fix_overflow applies the change as an incremental delta of -x^j to every share,
+ * looping until none hits 256, instead of evaluating the n polynomials again.
+ */
+void sss_share_section(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t overflow = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const uint16_t *row = powers + (size_t)i * MAX_K;
+        // k * 255 * 256 fits comfortably in 32 bits, reduce once at the end
+        uint32_t acc = 0;
+        for (int j = 0; j < k; ++j)
+            acc += (uint32_t)coeffs[j] * row[j];
+        fx[i] = acc % PRIME_MODULUS;
+        overflow |= fx[i] & 0x100;
+    }
+
+    if (overflow)
+        sss_share_fix_overflow(coeffs, k, n, powers, fx);
+}
+
+void sss_share_section_wide(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const uint16_t *row = powers + (size_t)i * MAX_K;
+        uint32_t acc = 0;
+        for (int j = 0; j < k; ++j)
+            acc += (uint32_t)coeffs[j] * row[j];
+        fx[i] = acc % PRIME_MODULUS;
+    }
+}
+
+void sss_share_fix_overflow(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
 {
-    uint16_t result = 0;
-    uint16_t power = 1;
-    for (int i = 0; i < r; ++i)
+    // Step 5: Retry if any fj(x) == 256. Rare (about n / 257 of the sections), and a
+    // coefficient can only be decreased a bounded number of times, so this always ends.
+    uint16_t overflow = 1;
+    while (overflow)
     {
-        result = (result + coeffs[i] * power) % PRIME_MODULUS;
-        power = (power * x) % PRIME_MODULUS;
+        int j = 0;
+        while (coeffs[j] == 0)
+            ++j;
+        coeffs[j]--;
+        __atomic_fetch_add(&gl_overflow_fixups, 1, __ATOMIC_RELAXED);
+
+        overflow = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            uint16_t v = fx[i] + PRIME_MODULUS - powers[(size_t)i * MAX_K + j];
+            v -= (v >= PRIME_MODULUS) ? PRIME_MODULUS : 0;
+            fx[i] = v;
+            overflow |= v & 0x100;
+        }
     }
-    return result;
 }
 
-bool sss_distribute_share_image(const BMPImageT *Q, BMPImageT **shadows, int k, int n, uint8_t **shadow_data)
+bool sss_distribute_share_image(const BMPImageT *Q, BMPImageT **shadows, int k, int n, uint8_t **shadow_data, ArenaT *arena)
 {
-    if (!Q || !Q->pixels || !shadows)
+    if (!Q || !Q->pixels || !shadow_data || !arena)
     {
-        fprintf(stderr, "Invalid input: Q or shadows is NULL\n");
+        fprintf(stderr, "Invalid input: Q, shadow_data or arena is NULL\n");
         return false;
     }
 
     if (k < MIN_K || k > MAX_K)
     {
-        fprintf(stderr, "Invalid parameters: k must be between 2 and 10\n");
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", MIN_K, MAX_K);
         return false;
     }
 
@@ -87,16 +180,18 @@ bool sss_distribute_share_image(const BMPImageT *Q, BMPImageT **shadows, int k,
         return false;
     }
 
-    uint32_t total_pixels = Q->width * Q->height;
-    uint8_t coeffs[MAX_K] = {0};
-    memset(coeffs, 0, sizeof(coeffs));
-    int sections = (total_pixels + k - 1) / k;
-    // int remaining = total_pixels % k;
+    size_t total_pixels = (size_t)Q->width * Q->height;
+    size_t sections = (total_pixels + k - 1) / k;
+
+    uint16_t *powers = arena_calloc(arena, (size_t)n * MAX_K, sizeof(uint16_t));
+    if (!powers)
+        return false;
+    sss_share_powers_fill(powers, k, n);
 
     // Allocate shadow_data once
     for (int i = 0; i < n; ++i)
     {
-        shadow_data[i] = calloc(sizeof(uint8_t), sections);
+        shadow_data[i] = arena_calloc(arena, sections, sizeof(uint8_t));
         if (!shadow_data[i])
         {
             fprintf(stderr, "Out of memory allocating shadow_data[%d]\n", i);
@@ -104,78 +199,32 @@ bool sss_distribute_share_image(const BMPImageT *Q, BMPImageT **shadows, int k,
         }
     }
 
-    for (int section = 0; section < sections; ++section)
-    {
-        // Step 3: Extract r coefficients from Q (r consecutive pixels)
-        for (int i = 0; i < k; ++i)
-        {
-            int index = section * k + i;
-            if (index >= total_pixels)
-            {
-                coeffs[i] = 0; // pad with 0s if overflow
-                continue;
-            }
-            int x = index % Q->width;
-            int y = index / Q->width;
-            coeffs[i] = *(uint8_t *)bmp_get_pixel_address(Q, x, y);
-        }
-
-        // Step 5: Retry if any fj(x) == 256
-        bool valid;
-        do
-        {
-            valid = true;
-            for (int i = 0; i < n; ++i)
-            {
-                uint16_t fx = poly_eval(coeffs, k, i + 1);
-                if (fx == 256)
-                {
-                    // TODO see if working
-                    // decrease first non-zero coeff
-                    for (int j = 0; j < k; ++j)
-                    {
-                        if (coeffs[j] != 0)
-                        {
-                            coeffs[j] = (coeffs[j] - 1) % 256;
-                            break;
-                        }
-                    }
-                    valid = false;
-                    break;
-                }
-            }
-        } while (!valid);
-
-        // For each section:
-        for (int i = 0; i < n; ++i)
-        {
-            uint16_t fx = poly_eval(coeffs, k, i + 1);
-            assert(fx <= 255);
-
-            int shadow_idx = section;
-            int x = shadow_idx % shadows[i]->width;
-            int y = shadow_idx / shadows[i]->width;
-            uint8_t *px = (uint8_t *)bmp_get_pixel_address(shadows[i], x, y);
-            *px = (uint8_t)fx;
+    BMPLinearIterT q_it;
+    bmp_linear_iter_init(&q_it, Q, 0);
+    sss_share_sections(&q_it, k, n, powers, shadow_data, 0, sections);
 
-            shadow_data[i][section] = (uint8_t)fx;
-        }
+    // Shadow images hold their shadow as the first pixels, in row order
+    for (int i = 0; shadows != NULL && i < n; ++i)
+    {
+        BMPLinearIterT shadow_it;
+        bmp_linear_iter_init(&shadow_it, shadows[i], 0);
+        bmp_linear_write(&shadow_it, shadow_data[i], sections);
     }
 
     return true;
 }
 
-bool sss_distribute_share_image_k(const BMPImageT *Q, BMPImageT **shadows, int k, int n, uint8_t **shadow_data)
+bool sss_distribute_share_image_k(const BMPImageT *Q, BMPImageT **shadows, int k, int n, unsigned share_bits, uint8_t **shadow_data, ArenaT *arena)
 {
-    if (!Q || !Q->pixels || !shadows)
+    if (!Q || !Q->pixels || !shadow_data || !arena)
     {
-        fprintf(stderr, "Invalid input: Q or shadows is NULL\n");
+        fprintf(stderr, "Invalid input: Q, shadow_data or arena is NULL\n");
         return false;
     }
 
     if (k < MIN_K || k > MAX_K)
     {
-        fprintf(stderr, "Invalid parameters: k must be between 2 and 10\n");
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", MIN_K, MAX_K);
         return false;
     }
 
@@ -185,16 +234,26 @@ bool sss_distribute_share_image_k(const BMPImageT *Q, BMPImageT **shadows, int k
         return false;
     }
 
-    uint32_t total_pixels = Q->width * Q->height;
-    uint8_t coeffs[MAX_K] = {0};
-    memset(coeffs, 0, sizeof(coeffs));
-    int sections = (total_pixels + k - 1) / k;
-    // int remaining = total_pixels % k;
+    if (!stego_meta_share_bits_valid(share_bits))
+    {
+        fprintf(stderr, "Invalid parameters: shares are 8 or 9 bits wide, not %u\n", share_bits);
+        return false;
+    }
+
+    size_t total_pixels = (size_t)Q->width * Q->height;
+    size_t sections = (total_pixels + k - 1) / k;
+    bool packed = share_bits == STEGO_META_SHARE_PACKED;
+    size_t shadow_len = packed ? bitpack_size(sections, share_bits) : sections;
+
+    uint16_t *powers = arena_calloc(arena, (size_t)n * MAX_K, sizeof(uint16_t));
+    if (!powers)
+        return false;
+    sss_share_powers_fill(powers, k, n);
 
     // Allocate shadow_data once
     for (int i = 0; i < n; ++i)
     {
-        shadow_data[i] = malloc(sections * sizeof(uint8_t));
+        shadow_data[i] = arena_alloc(arena, shadow_len);
         if (!shadow_data[i])
         {
             fprintf(stderr, "Out of memory allocating shadow_data[%d]\n", i);
@@ -202,284 +261,624 @@ bool sss_distribute_share_image_k(const BMPImageT *Q, BMPImageT **shadows, int k
         }
     }
 
-    for (int section = 0; section < sections; ++section)
+    BMPLinearIterT q_it;
+    bmp_linear_iter_init(&q_it, Q, 0);
+    if (packed)
+        sss_share_sections_packed(&q_it, k, n, powers, shadow_data, 0, sections);
+    else
+        sss_share_sections(&q_it, k, n, powers, shadow_data, 0, sections);
+
+    // Shadow images hold their shadow as the first pixels, in row order
+    for (int i = 0; shadows != NULL && i < n; ++i)
+    {
+        BMPLinearIterT shadow_it;
+        bmp_linear_iter_init(&shadow_it, shadows[i], 0);
+        bmp_linear_write(&shadow_it, shadow_data[i], shadow_len);
+    }
+
+    return true;
+}
+
+void sss_share_sections(BMPLinearIterT *it, int k, int n, const uint16_t *powers, uint8_t **shadow_data, size_t first, size_t count)
+{
+    uint8_t coeffs[MAX_K] = {0};
+    uint16_t fx_vals[256];
+    SSSShareKernelFnT share_section = sss_kernels_active()->share_section;
+
+    for (size_t section = first; section < first + count; ++section)
     {
         // Step 3: Extract r coefficients from Q (r consecutive pixels)
-        for (int i = 0; i < k; ++i)
-        {
-            int index = section * k + i;
-            coeffs[i] = (index < total_pixels)
-                            ? *(uint8_t *)bmp_get_pixel_address(Q, index % Q->width, index / Q->width)
-                            : 0; // pad with 0s if overflow
-        }
+        size_t got = bmp_linear_read(it, coeffs, k);
+        memset(coeffs + got, 0, k - got); // pad with 0s if overflow
 
-        // Step 5: Retry if any fj(x) == 256
-        bool valid;
-        do
-        {
-            valid = true;
-            for (int i = 0; i < n; ++i)
-            {
-                uint16_t fx = poly_eval(coeffs, k, i + 1);
-                if (fx == 256)
-                {
-                    // TODO see if working
-                    // decrease first non-zero coeff
-                    for (int j = 0; j < k; ++j)
-                    {
-                        if (coeffs[j] != 0)
-                        {
-                            coeffs[j] = (coeffs[j] - 1) % 256;
-                            break;
-                        }
-                    }
-                    valid = false;
-                    break;
-                }
-            }
-        } while (!valid);
+        share_section(coeffs, k, n, powers, fx_vals);
 
         // For each section:
         for (int i = 0; i < n; ++i)
         {
-            uint16_t fx = poly_eval(coeffs, k, i + 1);
+            uint16_t fx = fx_vals[i];
             assert(fx <= 255);
-
-            int shadow_idx = section;
-            int x = shadow_idx % shadows[i]->width;
-            int y = shadow_idx / shadows[i]->width;
-            uint8_t *px = (uint8_t *)bmp_get_pixel_address(shadows[i], x, y);
-            *px = (uint8_t)fx;
-
             shadow_data[i][section] = (uint8_t)fx;
         }
     }
+}
 
-    return true;
+void sss_share_sections_packed(BMPLinearIterT *it, int k, int n, const uint16_t *powers, uint8_t **shadow_data, size_t first, size_t count)
+{
+    uint8_t coeffs[MAX_K] = {0};
+    uint16_t fx_vals[256];
+    uint16_t group[256][8];
+    SSSShareWideKernelFnT share_wide = sss_kernels_active()->share_wide;
+
+    // Eight sections at a time, which is a whole number of bytes of every packed shadow
+    for (size_t base = first; base < first + count; base += 8)
+    {
+        size_t run = first + count - base < 8 ? first + count - base : 8;
+        for (size_t s = 0; s < run; ++s)
+        {
+            size_t got = bmp_linear_read(it, coeffs, k);
+            memset(coeffs + got, 0, k - got); // pad with 0s if overflow
+
+            share_wide(coeffs, k, n, powers, fx_vals);
+            for (int i = 0; i < n; ++i)
+                group[i][s] = fx_vals[i];
+        }
+
+        for (int i = 0; i < n; ++i)
+            bitpack_pack(shadow_data[i] + base / 8 * STEGO_META_SHARE_PACKED, group[i], run, STEGO_META_SHARE_PACKED);
+    }
 }
 
 /**
- * @brief Applies an in-place XOR operation between the image pixel data and a pseudo-random table.
+ * @brief Applies an in-place XOR operation between the image pixel data and a keystream.
  *
- * This function performs a bitwise XOR between each byte of the input BMP image's pixel data
- * and a randomly generated table of the same size. The result is stored back into the original
- * image's pixel buffer, effectively scrambling the image in-place for use in secret sharing.
+ * This function performs a bitwise XOR between each byte of the input BMP image's padded pixel
+ * data and the keystream of the given seed. The result is stored back into the original image's
+ * pixel buffer, effectively scrambling the image in-place for use in secret sharing. The keystream
+ * is XORed in chunks (or served from the default keystream cache), so no table is allocated and
+ * the function cannot fail.
  *
  * @param image Pointer to a BMPImageT structure containing the image to be processed.
  *              The image is modified in-place.
- * @param store If not NULL, this address will store the address where the random table was created.
- *              If NULL, the random table will be discarded after use.
- * @param seed The seed value used to generate the random table. This can be used for reproducibility.
- *
- * @return A pointer to the same BMPImageT structure, with the pixels XORed with the random table.
- *
- * @note The random table is generated with 4-byte alignment and must match the padded size of the image data.
- *       If a store pointer is provided, the caller is responsible for freeing the memory allocated for the random table.
+ * @param seed The seed value used to generate the keystream. This can be used for reproducibility.
+ * @param mode The keystream generator (RngptModeT).
  *
- * @warning This function will exit the program with an error message if memory allocation fails.
+ * @return A pointer to the same BMPImageT structure, with the pixels XORed with the keystream.
  */
-BMPImageT *sss_distribute_initial_xor_inplace(BMPImageT *image, uint8_t **store, uint16_t seed)
+BMPImageT *sss_distribute_initial_xor_inplace(BMPImageT *image, uint16_t seed, uint8_t mode)
 {
-    uint32_t scanline_size = bmp_align(image->width);
-    int image_size = scanline_size * image->height;
+    size_t image_size = (size_t)bmp_stride(image) * image->height;
+    KeystreamCacheT *cache = kscache_get_default();
+    if (cache != NULL && kscache_xor(cache, seed, mode, image->pixels, image_size))
+        return image;
+
+    if (mode == RNGPT_MODE_CTR)
+    {
+        rngpt_ctr_xor(image->pixels, image_size, seed, 0);
+        return image;
+    }
+
     rngpt_set_seed(seed);
-    uint8_t *randtable = rngpt_get_byte_table_noalign(image_size);
-    if (randtable == NULL || image == NULL)
+    rngpt_xor_stream(image->pixels, image_size);
+    return image;
+}
+
+/**
+ * @brief Saves the stego images as stego<x>.bmp, or stego<x>_<stripe>.bmp for striped shadows,
+ *        in one batch, then frees them.
+ * @param covers The n * stripes stego images, the stripes of each shadow next to each other.
+ * @return true if every image was saved, false otherwise.
+ */
+static bool sss_distribute_save_covers(BMPImageT **covers, uint32_t n, uint32_t stripes, const char *output_dir, const SSSOptionsT *opts)
+{
+    uint32_t count = n * stripes;
+    BMPWriterT *writer = bmp_writer_create(count, opts->writer, opts->fsync ? BMP_WRITER_FSYNC : 0);
+    if (writer == NULL)
     {
-        fprintf(stderr, "Out of memory: Failed to distribute image\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "Out of memory: Failed to allocate the stego image writer\n");
+        free_bmp_images(covers, count);
+        return false;
     }
-    if (store != NULL)
+
+    bool ok = true;
+    for (uint32_t i = 0; i < count && ok; i++)
     {
-        *store = randtable;
+        char output_path[512];
+        if (stripes > 1)
+            snprintf(output_path, sizeof(output_path), "%s/stego%u_%u.bmp", output_dir, i / stripes + 1, i % stripes + 1);
+        else
+            snprintf(output_path, sizeof(output_path), "%s/stego%u.bmp", output_dir, i + 1);
+        ok = bmp_writer_add(writer, output_path, covers[i]);
     }
+    ok = bmp_writer_flush(writer) && ok;
+    bmp_writer_destroy(writer);
+
+    free_bmp_images(covers, count);
+
+    if (!ok)
+        fprintf(stderr, "Failed to save the stego images in '%s'\n", output_dir);
+    return ok;
+}
 
-    rngpt_inplace_xor_aligned(image, randtable);
-    
-    if (store != NULL)
+bool sss_distribute_8(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
+{
+    uint16_t seed = rand() % 65536;
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(image, seed, RNGPT_MODE_LCG48);
+    stats_end(STATS_XOR);
+    if (opts->pipeline)
     {
-        *store = randtable;
+        SSSPipelineJobT job = {image, k, n, seed, NULL, covers_dir, output_dir, opts->mem_budget,
+                               opts->writer, opts->fsync ? BMP_WRITER_FSYNC : 0};
+        if (!sss_pipeline_distribute(&job))
+        {
+            fprintf(stderr, "Failed to distribute image\n");
+            return false;
+        }
+        return true;
     }
-    else
+
+    // Shadow buffers and share tables live until the stego images are saved, then go in one shot
+    ArenaT arena;
+    arena_init(&arena, 0);
+    bool ok = false;
+    uint8_t *shadow_data[256] = {0};
+    uint64_t fixups = sss_get_overflow_fixups();
+    stats_begin(STATS_SHARE);
+    bool shared = sss_distribute_share_image(image, NULL, k, n, shadow_data, &arena);
+    stats_end(STATS_SHARE);
+    if (!shared)
     {
-        free(randtable);
+        fprintf(stderr, "Failed to distribute image\n");
+        goto cleanup;
+    }
+    stats_add_sections(STATS_SHARE, ((size_t)image->width * image->height + k - 1) / k);
+    stats_add_retries(STATS_SHARE, sss_get_overflow_fixups() - fixups);
+
+    size_t bytes_needed = ((size_t)image->width * image->height + k - 1) / k * 8;
+    BMPImageT **covers = load_bmp_covers(covers_dir, n, bytes_needed);
+    if (!covers)
+    {
+        fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
+        goto cleanup;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        size_t size = ((size_t)image->width * image->height + k - 1) / k;
+        stats_begin(STATS_EMBED);
+        bool hidden = lsb_encoder_lsb1_into_cover(shadow_data[i], size, covers[i], seed);
+        stats_end(STATS_EMBED);
+        stats_add_bytes_written(STATS_EMBED, size);
+        if (!hidden)
+        {
+            fprintf(stderr, "Failed to hide shadow %d in cover image\n", i);
+            free_bmp_images(covers, n);
+            goto cleanup;
+        }
+
+        // Guardar la imagen stego
+        stego_meta_set_reserved(covers[i], seed, i + 1, false);
+    }
+    ok = sss_distribute_save_covers(covers, n, 1, output_dir, opts);
+
+cleanup:
+    arena_release(&arena);
+    return ok;
+}
+
+/**
+ * @brief Compresses the pixels of a secret into a one-row image, which is shared in its place.
+ * @param meta The header of the distribution, which records the codec, the compressed length
+ *             and the dictionary. Left uncompressed when compression does not shrink the secret.
+ * @return The one-row image, the secret itself if it is left uncompressed, or NULL on failure.
+ */
+static BMPImageT *sss_compress_secret(BMPImageT *image, CompressCodecT codec, StegoMetaT *meta)
+{
+    const CompressDictT *dict = codec == COMPRESS_LZ ? compress_dict_get_default() : NULL;
+    size_t len = (size_t)image->width * image->height;
+    uint8_t *pixels = malloc(len);
+    uint8_t *packed = malloc(len);
+    BMPImageT *payload = NULL;
+    if (pixels == NULL || packed == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the compression buffers\n");
+        goto cleanup;
+    }
+
+    BMPLinearIterT it;
+    bmp_linear_iter_init(&it, image, 0);
+    bmp_linear_read(&it, pixels, len);
+
+    // Only a smaller stream is worth it; the compressor gives up once it reaches the raw size
+    size_t packed_len = compress_encode(codec, pixels, len, packed, len - 1, dict);
+    if (packed_len == 0 || packed_len > INT32_MAX)
+    {
+        fprintf(stderr, "Warning: the secret does not compress, distributing it as is\n");
+        payload = image;
+        goto cleanup;
+    }
+
+    payload = bmp_create((int32_t)packed_len, 1, 8, NULL, 256);
+    if (payload == NULL)
+        goto cleanup;
+    memcpy(payload->pixels, packed, packed_len);
+    meta->compress = codec;
+    meta->payload_len = (uint32_t)packed_len;
+    meta->dict_crc = dict != NULL ? dict->crc : 0;
+
+cleanup:
+    free(pixels);
+    free(packed);
+    return payload;
+}
+
+/**
+ * @brief Decompresses the recovered one-row image of a compressed secret into the secret, or
+ *        copies it when meta->compress is none (a packed secret, see sss_distribute_pack).
+ * @param palette_source Stego image whose palette the secret gets, as with uncompressed secrets.
+ * @return The secret, or NULL if the payload is corrupt or memory is short.
+ */
+static BMPImageT *sss_decompress_secret(const BMPImageT *payload, const StegoMetaT *meta, const BMPImageT *palette_source)
+{
+    size_t len = (size_t)meta->s_width * meta->s_height;
+    uint8_t *pixels = malloc(len);
+    BMPImageT *image = NULL;
+    if (pixels == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the decompression buffer\n");
+        return NULL;
+    }
+
+    if (meta->compress == COMPRESS_NONE)
+    {
+        memcpy(pixels, payload->pixels, len);
+    }
+    else if (!compress_decode(meta->compress, payload->pixels, meta->payload_len, pixels, len, compress_dict_get_default()))
+    {
+        fprintf(stderr, "Error: the recovered secret does not decompress\n");
+        goto cleanup;
     }
 
+    image = bmp_pool_create_image(bmp_pool_get_default(), meta->s_width, meta->s_height,
+                                  palette_source->palette, palette_source->colors_used);
+    if (image == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the recovered image\n");
+        goto cleanup;
+    }
+    BMPLinearIterT it;
+    bmp_linear_iter_init(&it, image, 0);
+    bmp_linear_write(&it, pixels, len);
+
+cleanup:
+    free(pixels);
     return image;
 }
 
 /**
- * @brief Allocates and initializes shadow image buffers for secret image sharing.
- *
- * @param image Pointer to the source BMPImageT structure to copy attributes from (e.g., width, height, bpp, palette).
- * @param k The threshold number of shares required to reconstruct the image (unused here but typically part of the context).
- * @param n The total number of shadow images to generate.
- *
- * @return A dynamically allocated array of BMPImageT* pointers. Each shadow image contains its own pixel buffer.
- *
- * @note The caller is responsible for freeing both the array of pointers and the memory associated with each individual BMPImageT,
- *       including their pixel buffers.
- *
- * @warning This function exits the program with an error message if any memory allocation fails.
+ * @brief Checks that the dictionary a secret was compressed with is the default one.
  */
-BMPImageT **sss_distribute_generate_shadows_buffers(BMPImageT *image, uint32_t k, uint32_t n)
+static bool sss_check_dict(const StegoMetaT *meta)
 {
-    BMPImageT **shadows = calloc(n, sizeof(BMPImageT *)); // calloc in case of partial failure
-    if (shadows == NULL)
+    if (meta->compress == COMPRESS_NONE || meta->dict_crc == 0)
+        return true;
+
+    const CompressDictT *dict = compress_dict_get_default();
+    if (dict == NULL || dict->crc != meta->dict_crc)
     {
-        fprintf(stderr, "Out of memory: Failed to allocate shadows holder\n");
-        goto error_oom;
+        fprintf(stderr, "Error: the secret was compressed with a dictionary (CRC32C %08x); give the same one with --dict\n",
+                meta->dict_crc);
+        return false;
     }
+    return true;
+}
 
-    for (uint32_t i = 0; i < n; i++)
+/**
+ * @brief Splits each shadow in meta->stripes stripes and embeds them in n * stripes covers, in
+ *        parallel, then saves them.
+ */
+static bool sss_distribute_stripes(uint8_t **shadow_data, uint32_t n, const StegoMetaT *meta, uint16_t seed,
+                                   const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
+{
+    uint32_t stripes = meta->stripes;
+    uint32_t count = n * stripes;
+    if (stego_meta_stripe_len(meta, stripes - 1) == 0)
     {
-        shadows[i] = calloc(1, sizeof(BMPImageT));
-        if (shadows[i] == NULL)
-        {
-            fprintf(stderr, "Out of memory: Failed to allocate shadow image\n");
-            goto error_oom;
-        }
+        fprintf(stderr, "Error: shadows of %zu bytes cannot be split in %u stripes\n", stego_meta_shadow_len(meta), stripes);
+        return false;
+    }
 
-        // uncomment when palette copies are implemented
-        // shadows[i]->palette = calloc((1 << image->bpp), sizeof(BMPColorT));
-        size_t row_size = (image->width * image->bpp + 7) / 8;
-        size_t padded_row_size = (row_size + 3) & ~3; // Align to 4 bytes
-        shadows[i]->pixels = calloc(padded_row_size * image->height, 1);
+    // The first stripe is the longest, so any cover that holds it holds the others
+    BMPImageT **covers = load_bmp_covers(covers_dir, count, stego_meta_cover_bytes(meta, stego_meta_stripe_len(meta, 0)));
+    if (!covers)
+    {
+        fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
+        return false;
     }
 
-    return shadows;
+    SSSStripeT *jobs = calloc(count, sizeof(SSSStripeT));
+    if (jobs == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the stripes\n");
+        free_bmp_images(covers, count);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        SSSStripeT *job = &jobs[i];
+        job->cover = covers[i];
+        job->meta = *meta;
+        job->meta.stripe = (uint8_t)(i % stripes);
+        job->meta.stripe_len = (uint32_t)stego_meta_stripe_len(meta, job->meta.stripe);
+        job->data = shadow_data[i / stripes] + stego_meta_stripe_offset(meta, job->meta.stripe);
+        job->seed = seed;
+        job->x = (uint16_t)(i / stripes + 1);
+    }
 
-error_oom:
-    for (uint32_t i = 0; i < n; i++)
+    bool hidden = sss_stripes_embed(jobs, count);
+    for (uint32_t i = 0; i < count && !hidden; i++)
     {
-        if (shadows[i])
+        if (!jobs[i].ok)
         {
-            free(shadows[i]);
+            fprintf(stderr, "Failed to hide stripe %u of shadow %u in cover image\n", i % stripes, i / stripes);
+            break;
         }
     }
-    free(shadows);
-
-    exit(EXIT_FAILURE);
+    free(jobs);
+    if (!hidden)
+    {
+        free_bmp_images(covers, count);
+        return false;
+    }
+    return sss_distribute_save_covers(covers, n, stripes, output_dir, opts);
 }
 
-BMPImageT **sss_distribute_8(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir)
+bool sss_distribute_generic(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
 {
     uint16_t seed = rand() % 65536;
-    sss_distribute_initial_xor_inplace(image, NULL, seed);
-    BMPImageT **shadows = sss_distribute_generate_shadows_buffers(image, k, n);
-    for (int i = 0; i < n; i++)
+    StegoMetaT meta;
+    stego_meta_init(&meta, image->width, image->height, k);
+    meta.keystream = opts->keystream;
+    meta.lsb_bits = opts->lsb_bits;
+    // An adjusted section would corrupt a compressed stream, so --compress always shares exactly,
+    // whether or not the secret ends up compressed
+    meta.share_bits = opts->compress != COMPRESS_NONE ? STEGO_META_SHARE_PACKED : opts->share_bits;
+    meta.layout = opts->scatter ? STEGO_META_LAYOUT_SCATTER : STEGO_META_LAYOUT_SEQUENTIAL;
+    meta.stripes = opts->stripes;
+
+    // A compressed secret is shared as a one-row image of its compressed pixels
+    BMPImageT *payload = image;
+    if (opts->compress != COMPRESS_NONE)
+    {
+        stats_begin(STATS_COMPRESS);
+        payload = sss_compress_secret(image, opts->compress, &meta);
+        stats_end(STATS_COMPRESS);
+        if (payload == NULL)
+            return false;
+        stats_add_bytes_read(STATS_COMPRESS, (size_t)image->width * image->height);
+        stats_add_bytes_written(STATS_COMPRESS, stego_meta_payload_len(&meta));
+    }
+
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(payload, seed, opts->keystream);
+    stats_end(STATS_XOR);
+
+    // Shadow buffers and share tables live until the stego images are saved, then go in one shot
+    ArenaT arena;
+    arena_init(&arena, 0);
+    bool ok = false;
+    if (opts->pipeline)
     {
-        shadows[i]->bpp = image->bpp;
-        shadows[i]->width = image->width;
-        shadows[i]->height = image->height;
-        shadows[i]->palette = bmp_copy_palette(image); 
+        SSSPipelineJobT job = {payload, k, n, seed, &meta, covers_dir, output_dir, opts->mem_budget,
+                               opts->writer, opts->fsync ? BMP_WRITER_FSYNC : 0};
+        ok = sss_pipeline_distribute(&job);
+        if (!ok)
+            fprintf(stderr, "Failed to distribute image\n");
+        goto cleanup;
     }
+
     uint8_t *shadow_data[256] = {0};
-    if (sss_distribute_share_image(image, shadows, k, n, shadow_data) == false)
+    uint64_t fixups = sss_get_overflow_fixups();
+    stats_begin(STATS_SHARE);
+    bool shared = sss_distribute_share_image_k(payload, NULL, k, n, meta.share_bits, shadow_data, &arena);
+    stats_end(STATS_SHARE);
+    if (!shared)
     {
         fprintf(stderr, "Failed to distribute image\n");
-        exit(EXIT_FAILURE);
+        goto cleanup;
     }
+    stats_add_sections(STATS_SHARE, (stego_meta_payload_len(&meta) + k - 1) / k);
+    stats_add_retries(STATS_SHARE, sss_get_overflow_fixups() - fixups);
 
-    int bytes_needed = (image->width * image->height + k - 1) / k * 8;
-    BMPImageT **covers = load_bmp_covers(covers_dir, n, bytes_needed);
-    for (int i = 0; i < n; i++)
+    if (meta.stripes > 1)
     {
-        int size = (shadows[i]->width * shadows[i]->height + k - 1) / k;
-        if (!covers) {
-            fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
-            exit(EXIT_FAILURE);
-        }
+        ok = sss_distribute_stripes(shadow_data, n, &meta, seed, covers_dir, output_dir, opts);
+        goto cleanup;
+    }
 
-        bool ok = lsb_encoder_lsb1_into_cover(shadow_data[i], size, covers[i], seed);
-        if (!ok)
+    size_t shadow_len = stego_meta_shadow_len(&meta);
+    BMPImageT **covers = load_bmp_covers(covers_dir, n, stego_meta_cover_bytes(&meta, shadow_len));
+    if (!covers)
+    {
+        fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
+        goto cleanup;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        stats_begin(STATS_EMBED);
+        bool hidden = lsb_encoder_lsb1_into_cover_extended(shadow_data[i], shadow_len, covers[i], seed, &meta);
+        stats_end(STATS_EMBED);
+        stats_add_bytes_written(STATS_EMBED, shadow_len + stego_meta_size(&meta));
+        if (!hidden)
         {
             fprintf(stderr, "Failed to hide shadow %d in cover image\n", i);
-            exit(EXIT_FAILURE);
+            free_bmp_images(covers, n);
+            goto cleanup;
         }
 
         // Guardar la imagen stego
-        uint16_t x = i + 1;
-        covers[i]->reserved[0] = seed & 0xFF;
-        covers[i]->reserved[1] = (seed >> 8) & 0xFF;
-        covers[i]->reserved[2] = x & 0xFF;
-        covers[i]->reserved[3] = (x >> 8) & 0xFF;
-
-        char output_path[512];
-        snprintf(output_path, sizeof(output_path), "%s/stego%d.bmp", output_dir, i + 1);
-        bmp_save(output_path, covers[i]);
-        bmp_unload(covers[i]);
+        stego_meta_set_reserved(covers[i], seed, i + 1, true);
     }
-    free(covers);
+    ok = sss_distribute_save_covers(covers, n, 1, output_dir, opts);
 
-    for (int i = 0; i < n; i++)
-    {
-        free(shadow_data[i]);
-        bmp_unload(shadows[i]);
-    }
-    free(shadows);
+cleanup:
+    arena_release(&arena);
+    if (payload != image)
+        bmp_unload(payload);
+    return ok;
+}
 
-    return NULL;
+/**
+ * @brief Range of the shadow data holding the shares of one packed secret.
+ */
+static void sss_entry_shadow_range(const StegoMetaT *meta, const StegoEntryT *entry, uint32_t k, size_t *offset, size_t *len)
+{
+    *offset = stego_meta_shadow_bytes(meta, entry->offset / k);
+    *len = stego_meta_shadow_bytes(meta, (entry->payload_len + k - 1) / k);
 }
 
-BMPImageT **sss_distribute_generic(BMPImageT *image, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir)
+bool sss_distribute_pack(BMPImageT **images, uint32_t count, uint32_t k, uint32_t n, const char *covers_dir, const char *output_dir, const SSSOptionsT *opts)
 {
     uint16_t seed = rand() % 65536;
-    sss_distribute_initial_xor_inplace(image, NULL, seed);
-    BMPImageT **shadows = sss_distribute_generate_shadows_buffers(image, k, n);
-    for (int i = 0; i < n; i++)
+    StegoMetaT meta;
+    stego_meta_init(&meta, 0, 0, k);
+    meta.keystream = opts->keystream;
+    meta.lsb_bits = opts->lsb_bits;
+    meta.share_bits = opts->compress != COMPRESS_NONE ? STEGO_META_SHARE_PACKED : opts->share_bits;
+    meta.layout = opts->scatter ? STEGO_META_LAYOUT_SCATTER : STEGO_META_LAYOUT_SEQUENTIAL;
+    meta.entries = (uint8_t)count;
+
+    // Secret bytes, shadows and the directory live until the stego images are saved
+    ArenaT arena;
+    arena_init(&arena, 0);
+    bool ok = false;
+    BMPImageT *payload = NULL;
+    StegoEntryT *entries = arena_calloc(&arena, count, sizeof(StegoEntryT));
+    uint8_t **bytes = arena_calloc(&arena, count, sizeof(uint8_t *));
+    if (entries == NULL || bytes == NULL)
+        goto cleanup;
+
+    // Each secret starts on a group of 8 sections, so its shares start on a byte of the shadow data
+    const CompressDictT *dict = opts->compress == COMPRESS_LZ ? compress_dict_get_default() : NULL;
+    size_t align = 8 * (size_t)k;
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        StegoEntryT *entry = &entries[i];
+        size_t len = (size_t)images[i]->width * images[i]->height;
+        bytes[i] = arena_alloc(&arena, len);
+        if (bytes[i] == NULL)
+            goto cleanup;
+        BMPLinearIterT it;
+        bmp_linear_iter_init(&it, images[i], 0);
+        bmp_linear_read(&it, bytes[i], len);
+        entry->s_width = images[i]->width;
+        entry->s_height = images[i]->height;
+        entry->payload_len = (uint32_t)len;
+
+        // Each secret is compressed on its own, and kept as is if it does not shrink
+        if (opts->compress != COMPRESS_NONE)
+        {
+            uint8_t *packed = arena_alloc(&arena, len);
+            if (packed == NULL)
+                goto cleanup;
+            stats_begin(STATS_COMPRESS);
+            size_t packed_len = compress_encode(opts->compress, bytes[i], len, packed, len - 1, dict);
+            stats_end(STATS_COMPRESS);
+            stats_add_bytes_read(STATS_COMPRESS, len);
+            stats_add_bytes_written(STATS_COMPRESS, packed_len > 0 ? packed_len : len);
+            if (packed_len > 0)
+            {
+                bytes[i] = packed;
+                entry->payload_len = (uint32_t)packed_len;
+                entry->compress = opts->compress;
+                entry->dict_crc = dict != NULL ? dict->crc : 0;
+            }
+        }
+
+        entry->offset = (uint32_t)total;
+        total += (entry->payload_len + align - 1) / align * align;
+        if (total > INT32_MAX)
+        {
+            fprintf(stderr, "Error: the secrets take more than %d bytes once packed\n", INT32_MAX);
+            goto cleanup;
+        }
+    }
+    meta.payload_len = (uint32_t)total;
+
+    payload = bmp_create((int32_t)total, 1, 8, NULL, 256);
+    if (payload == NULL)
+        goto cleanup;
+
+    // A keystream per secret, so that each one is unscrambled without the others. The padding
+    // between secrets stays zero.
+    stats_begin(STATS_XOR);
+    for (uint32_t i = 0; i < count; i++)
     {
-        shadows[i]->bpp = image->bpp;
-        shadows[i]->width = image->width;
-        shadows[i]->height = image->height;
-        shadows[i]->palette = bmp_copy_palette(image);
+        uint8_t *start = (uint8_t *)payload->pixels + entries[i].offset;
+        memcpy(start, bytes[i], entries[i].payload_len);
+        BMPImageT view = {.width = (int32_t)entries[i].payload_len, .height = 1, .bpp = 8, .pixels = start};
+        sss_distribute_initial_xor_inplace(&view, (uint16_t)(seed + i), meta.keystream);
     }
+    stats_end(STATS_XOR);
+
     uint8_t *shadow_data[256] = {0};
-    if (sss_distribute_share_image_k(image, shadows, k, n, shadow_data) == false)
+    uint64_t fixups = sss_get_overflow_fixups();
+    stats_begin(STATS_SHARE);
+    bool shared = sss_distribute_share_image_k(payload, NULL, k, n, meta.share_bits, shadow_data, &arena);
+    stats_end(STATS_SHARE);
+    if (!shared)
     {
         fprintf(stderr, "Failed to distribute image\n");
-        exit(EXIT_FAILURE);
+        goto cleanup;
+    }
+    stats_add_sections(STATS_SHARE, total / k);
+    stats_add_retries(STATS_SHARE, sss_get_overflow_fixups() - fixups);
+
+    size_t shadow_len = stego_meta_shadow_len(&meta);
+    BMPImageT **covers = load_bmp_covers(covers_dir, n, stego_meta_cover_bytes(&meta, shadow_len));
+    if (!covers)
+    {
+        fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
+        goto cleanup;
     }
 
-    BMPImageT **covers = load_bmp_covers(covers_dir, n, (image->width * image->height + k - 1) / k * 8);
+    const SSSKernelsT *kernels = sss_kernels_active();
     for (int i = 0; i < n; i++)
     {
-        int size = (shadows[i]->width * shadows[i]->height + k - 1) / k;
-       // BMPImageT **covers = load_bmp_covers(covers_dir, n, size*8);
-        if (!covers) {
-            fprintf(stderr, "Failed to load enough cover images from '%s'\n", covers_dir);
-            exit(EXIT_FAILURE);
+        stats_begin(STATS_EMBED);
+        bool hidden = lsb_encoder_lsb1_into_cover_extended(shadow_data[i], shadow_len, covers[i], seed, &meta);
+        if (hidden)
+        {
+            // The directory records each secret's CRC32C in this shadow, checked on its own
+            for (uint32_t e = 0; e < count; e++)
+            {
+                size_t offset, len;
+                sss_entry_shadow_range(&meta, &entries[e], k, &offset, &len);
+                entries[e].shadow_crc = kernels->crc32c(0, shadow_data[i] + offset, len);
+            }
+            lsb_encoder_lsb1_embed_entries(covers[i], &meta, entries);
         }
-
-        bool ok = lsb_encoder_lsb1_into_cover_extended(shadow_data[i], size, covers[i], seed, k, image->width, image->height);
-        if (!ok)
+        stats_end(STATS_EMBED);
+        stats_add_bytes_written(STATS_EMBED, shadow_len + stego_meta_size(&meta) + stego_meta_dir_size(&meta));
+        if (!hidden)
         {
             fprintf(stderr, "Failed to hide shadow %d in cover image\n", i);
-            exit(EXIT_FAILURE);
+            free_bmp_images(covers, n);
+            goto cleanup;
         }
-
-        // Guardar la imagen stego
-        uint16_t x = i + 1;
-        covers[i]->reserved[0] = seed & 0xFF;
-        covers[i]->reserved[1] = (seed >> 8) & 0xFF;
-        covers[i]->reserved[2] = x & 0xFF;
-        covers[i]->reserved[3] = (x >> 8) & 0xFF;
-
-        char output_path[512];
-        snprintf(output_path, sizeof(output_path), "%s/stego%d.bmp", output_dir, i + 1);
-        bmp_save(output_path, covers[i]);
-        bmp_unload(covers[i]);
-    }
-    free(covers);
-
-    for (int i = 0; i < n; i++)
-    {
-        free(shadow_data[i]);
-        bmp_unload(shadows[i]);
+        stego_meta_set_reserved(covers[i], seed, i + 1, true);
     }
-    free(shadows);
-
-    return NULL;
+    ok = sss_distribute_save_covers(covers, n, 1, output_dir, opts);
+
+cleanup:
+    if (entries == NULL || bytes == NULL)
+        fprintf(stderr, "Out of memory: Failed to allocate the packed secrets\n");
+    arena_release(&arena);
+    bmp_unload(payload);
+    return ok;
 }
 
 // Modular inverse with extended Euclidean algorithm
@@ -506,8 +905,9 @@ uint16_t modinv(int a, int p)
 
 void lagrange_reconstruct_coeffs(const uint8_t *y, const uint16_t *x, int k, uint8_t *out_coeffs)
 {
-    uint8_t ywork[MAX_K];
-    uint8_t y_next[MAX_K]; // Temporary buffer
+    // Intermediate values range over [0, 256], so they do not fit in a byte
+    uint16_t ywork[MAX_K];
+    uint16_t y_next[MAX_K]; // Temporary buffer
 
     for (int i = 0; i < k; ++i)
         ywork[i] = y[i]; // copy original y
@@ -541,297 +941,1193 @@ void lagrange_reconstruct_coeffs(const uint8_t *y, const uint16_t *x, int k, uin
             y_next[i] = (num * modinv(x[i], PRIME_MODULUS)) % PRIME_MODULUS;
         }
 
-        memcpy(ywork, y_next, sizeof(uint8_t) * k);
+        memcpy(ywork, y_next, sizeof(uint16_t) * k);
     }
 }
 
-void lagrange_solve_coeffs(const uint8_t *y, const uint16_t *x, int k, uint8_t *out_coeffs)
+uint8_t lagrange_reconstruct_pixel(uint8_t *y, uint16_t *x, int k)
 {
-    uint16_t **A = malloc(k * sizeof(uint16_t *));
-    for (int i = 0; i < k; ++i)
+    int sum = 0;
+
+    for (int i = 0; i < k; i++)
     {
-        A[i] = malloc((k + 1) * sizeof(uint16_t)); // last column for y
-        uint16_t xi = 1;
-        for (int j = 0; j < k; ++j)
+        int numerator = 1;
+        int denominator = 1;
+
+        for (int j = 0; j < k; j++)
         {
-            A[i][j] = xi;
-            xi = (xi * x[i]) % PRIME_MODULUS;
+            if (j == i)
+                continue;
+
+            int xj = x[j];
+            int xi = x[i];
+
+            numerator = (numerator * (PRIME_MODULUS - xj)) % PRIME_MODULUS; // -xj mod 257
+            int diff = (xi - xj + PRIME_MODULUS) % PRIME_MODULUS;
+            denominator = (denominator * diff) % PRIME_MODULUS;
         }
-        A[i][k] = y[i]; // append y as RHS
+
+        int li = (numerator * modinv(denominator, PRIME_MODULUS)) % PRIME_MODULUS;
+        sum = (sum + li * y[i]) % PRIME_MODULUS;
     }
 
-    // Gaussian Elimination mod PRIME_MODULUS
-    for (int col = 0; col < k; ++col)
+    return (uint8_t)sum;
+}
+
+bool sss_interp_prepare(SSSInterpT *interp, const uint16_t *x, int k)
+{
+    if (k < MIN_K || k > MAX_K)
+        return false;
+
+    // Coefficients of P(z) = (z - x_0)(z - x_1)...(z - x_{k-1}), lowest degree first
+    uint16_t master[MAX_K + 1] = {1};
+    for (int j = 0; j < k; ++j)
+    {
+        uint16_t xj = x[j] % PRIME_MODULUS;
+        for (int t = j + 1; t > 0; --t)
+            master[t] = (master[t - 1] + (PRIME_MODULUS - xj) * master[t]) % PRIME_MODULUS;
+        master[0] = (PRIME_MODULUS - xj) * master[0] % PRIME_MODULUS;
+    }
+
+    // Weights past column k stay zero, so vector kernels may run over whole blocks of a row
+    memset(interp, 0, sizeof(*interp));
+    interp->k = k;
+    for (int i = 0; i < k; ++i)
     {
-        // Find pivot
-        int pivot = -1;
-        for (int row = col; row < k; ++row)
+        uint16_t xi = x[i] % PRIME_MODULUS;
+        interp->x[i] = x[i];
+
+        // Synthetic division: q(z) = P(z) / (z - x_i) is the numerator of the i-th Lagrange basis
+        uint16_t q[MAX_K];
+        q[k - 1] = master[k];
+        for (int t = k - 1; t > 0; --t)
+            q[t - 1] = (master[t] + xi * q[t]) % PRIME_MODULUS;
+
+        // Its denominator is q(x_i) = prod_{j != i} (x_i - x_j)
+        uint16_t denom = 0;
+        for (int t = k - 1; t >= 0; --t)
+            denom = (denom * xi + q[t]) % PRIME_MODULUS;
+        if (denom == 0)
         {
-            if (A[row][col] != 0)
+            fprintf(stderr, "Repeated shadow x coordinate: %u\n", x[i]);
+            return false;
+        }
+
+        uint16_t inv = modinv(denom, PRIME_MODULUS);
+        for (int c = 0; c < k; ++c)
+            interp->w[c][i] = (uint32_t)q[c] * inv % PRIME_MODULUS;
+    }
+
+    return true;
+}
+
+void sss_interp_coeffs(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    for (int c = 0; c < k; ++c)
+    {
+        // k * 256 * 256 fits comfortably in 32 bits, reduce once at the end
+        uint32_t acc = 0;
+        for (int i = 0; i < k; ++i)
+            acc += (uint32_t)interp->w[c][i] * y[i];
+        out_coeffs[c] = acc % PRIME_MODULUS;
+    }
+}
+
+void sss_interp_coeffs_wide(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    for (int c = 0; c < k; ++c)
+    {
+        uint32_t acc = 0;
+        for (int i = 0; i < k; ++i)
+            acc += (uint32_t)interp->w[c][i] * y[i];
+        out_coeffs[c] = acc % PRIME_MODULUS;
+    }
+}
+
+/**
+ * @brief Value of one section of an extracted shadow, byte or packed 9-bit.
+ */
+static inline uint16_t sss_shadow_value(const uint8_t *shadow, size_t section, unsigned share_bits)
+{
+    if (share_bits != STEGO_META_SHARE_PACKED)
+        return shadow[section];
+
+    // A 9-bit value always straddles two bytes of the most significant bit first stream
+    size_t bit = section * STEGO_META_SHARE_PACKED;
+    uint16_t pair = (uint16_t)(shadow[bit / 8] << 8 | shadow[bit / 8 + 1]);
+    return (pair >> (7 - bit % 8)) & 0x1FF;
+}
+
+/**
+ * @brief Lagrange basis of the prepared x coordinates evaluated at another x.
+ *
+ * The share at x of the polynomial through the prepared shares is then the dot product of
+ * the row with their values, mod 257, so checking another shadow needs no interpolation.
+ */
+static void sss_interp_eval_row(const SSSInterpT *interp, uint16_t x, uint16_t *row)
+{
+    int k = interp->k;
+    uint32_t xe = x % PRIME_MODULUS;
+    for (int i = 0; i < k; ++i)
+    {
+        // Horner over the coefficients of the i-th basis polynomial
+        uint32_t acc = 0;
+        for (int c = k - 1; c >= 0; --c)
+            acc = (acc * xe + interp->w[c][i]) % PRIME_MODULUS;
+        row[i] = acc;
+    }
+}
+
+/**
+ * @brief Whether a candidate agrees on every sampled section with the shares of a subset.
+ * @param samples Sampled values, SSS_VERIFY_SAMPLES per candidate.
+ */
+static bool sss_sample_agrees(const SSSInterpT *interp, const int *subset, const uint16_t *samples, size_t sample_count,
+                              int candidate, uint16_t x)
+{
+    int k = interp->k;
+    uint16_t row[MAX_K];
+    sss_interp_eval_row(interp, x, row);
+
+    for (size_t s = 0; s < sample_count; ++s)
+    {
+        uint32_t acc = 0;
+        for (int i = 0; i < k; ++i)
+            acc += (uint32_t)row[i] * samples[subset[i] * SSS_VERIFY_SAMPLES + s];
+        if (acc % PRIME_MODULUS != samples[candidate * SSS_VERIFY_SAMPLES + s])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Whether a candidate agrees on every section with the shares of a subset.
+ *
+ * One dot product of the evaluation row with the subset's shares per section, so checking an
+ * extra shadow costs about as much as interpolating one coefficient of the image.
+ */
+static bool sss_shadow_agrees(const SSSInterpT *interp, const uint8_t **shadows, const int *subset, size_t sections,
+                              unsigned share_bits, int candidate, uint16_t x)
+{
+    int k = interp->k;
+    uint16_t row[MAX_K];
+    sss_interp_eval_row(interp, x, row);
+
+    for (size_t s = 0; s < sections; ++s)
+    {
+        uint32_t acc = 0;
+        for (int i = 0; i < k; ++i)
+            acc += (uint32_t)row[i] * sss_shadow_value(shadows[subset[i]], s, share_bits);
+        if (acc % PRIME_MODULUS != sss_shadow_value(shadows[candidate], s, share_bits))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Picks k shadows that agree with each other among more candidates.
+ *
+ * The first k candidates are checked first: their basis evaluated at the x of every other
+ * candidate predicts its values, which are compared on every section. If any of them
+ * disagrees, k-subsets are tried in order on a sample of sections, which is only used to find
+ * the bad shadows quickly: the first subset that another candidate confirms on the sample is
+ * then checked against that candidate on every section too. A subset holding a corrupt shadow
+ * predicts values that no other shadow has, while a clean one predicts every clean shadow, so
+ * one bad shadow among k + 2 candidates or more is located without interpolating the image
+ * more than once.
+ *
+ * @param shadows Extracted shadows of the candidates.
+ * @param x Their x coordinates, all different.
+ * @param count The amount of candidates, at least k.
+ * @param interp Filled in with the weights of the chosen subset.
+ * @param chosen Output array of the k chosen candidates, in increasing order.
+ * @return false if the candidates disagree and no subset is confirmed by another one.
+ */
+static bool sss_select_shadows(ArenaT *arena, const uint8_t **shadows, const uint16_t *x, int count, int k,
+                               size_t sections, unsigned share_bits, SSSInterpT *interp, int *chosen)
+{
+    for (int i = 0; i < k; ++i)
+        chosen[i] = i;
+    if (!sss_interp_prepare(interp, x, k))
+        return false;
+    if (count == k)
+        return true;
+
+    bool agree = true;
+    for (int c = k; c < count && agree; ++c)
+        agree = sss_shadow_agrees(interp, shadows, chosen, sections, share_bits, c, x[c]);
+    if (agree)
+        return true;
+
+    size_t sample_count = sections < SSS_VERIFY_SAMPLES ? sections : SSS_VERIFY_SAMPLES;
+    uint16_t *samples = arena_alloc(arena, (size_t)count * SSS_VERIFY_SAMPLES * sizeof(uint16_t));
+    if (samples == NULL)
+        return false;
+    for (int c = 0; c < count; ++c)
+        for (size_t s = 0; s < sample_count; ++s)
+            samples[c * SSS_VERIFY_SAMPLES + s] = sss_shadow_value(shadows[c], s * sections / sample_count, share_bits);
+
+    // From the first subset on, one other candidate agreeing on every section confirms a subset
+    uint16_t subset_x[MAX_K];
+    for (long tries = 0; tries < SSS_VERIFY_MAX_SUBSETS; ++tries)
+    {
+        for (int i = 0; i < k; ++i)
+            subset_x[i] = x[chosen[i]];
+        if (!sss_interp_prepare(interp, subset_x, k))
+            return false;
+
+        bool confirmed = false;
+        for (int c = 0, next = 0; c < count && !confirmed; ++c)
+        {
+            if (next < k && chosen[next] == c)
             {
-                pivot = row;
-                break;
+                next++;
+                continue;
             }
+            confirmed = sss_sample_agrees(interp, chosen, samples, sample_count, c, x[c]) &&
+                        sss_shadow_agrees(interp, shadows, chosen, sections, share_bits, c, x[c]);
         }
-
-        if (pivot == -1)
+        if (confirmed)
         {
-            fprintf(stderr, "Singular matrix: pivot not found\n");
-            exit(EXIT_FAILURE);
+            for (int c = 0, next = 0; c < count; ++c)
+            {
+                if (next < k && chosen[next] == c)
+                    next++;
+                else if (!sss_shadow_agrees(interp, shadows, chosen, sections, share_bits, c, x[c]))
+                    fprintf(stderr, "Warning: the stego image with x = %u disagrees with the others, leaving it out\n", x[c]);
+            }
+            return true;
         }
 
-        // Swap rows if needed
-        if (pivot != col)
+        // Next subset in lexicographic order
+        int i = k - 1;
+        while (i >= 0 && chosen[i] == count - k + i)
+            i--;
+        if (i < 0)
+            break;
+        chosen[i]++;
+        for (int j = i + 1; j < k; ++j)
+            chosen[j] = chosen[j - 1] + 1;
+    }
+
+    fprintf(stderr, "Error: the stego images disagree with each other and no %d of them can be confirmed by another\n", k);
+    return false;
+}
+
+/**
+ * @brief Leaves out repeated x coordinates, picks k agreeing shadows and moves them first.
+ * @param shadows Extracted shadows of the usable candidates, reordered in place.
+ * @param x Their x coordinates, reordered along.
+ * @param count The amount of usable candidates.
+ * @param interp Filled in with the weights of the k shadows now first.
+ */
+static bool sss_choose_shadows(ArenaT *arena, uint8_t **shadows, uint16_t *x, int count, int k,
+                               size_t sections, unsigned share_bits, SSSInterpT *interp)
+{
+    // The same share twice, such as a copy of a stego image, adds nothing to check against
+    int unique = 0;
+    for (int c = 0; c < count; ++c)
+    {
+        bool repeated = false;
+        for (int u = 0; u < unique && !repeated; ++u)
+            repeated = x[u] == x[c];
+        if (repeated)
         {
-            uint16_t *tmp = A[col];
-            A[col] = A[pivot];
-            A[pivot] = tmp;
+            fprintf(stderr, "Warning: more than one stego image with x = %u, using the first one\n", x[c]);
+            continue;
         }
+        shadows[unique] = shadows[c];
+        x[unique++] = x[c];
+    }
+    if (unique < k)
+    {
+        fprintf(stderr, "Error: %d usable stego images, at least k = %d are needed\n", unique, k);
+        return false;
+    }
+
+    int chosen[MAX_K];
+    if (!sss_select_shadows(arena, (const uint8_t **)shadows, x, unique, k, sections, share_bits, interp, chosen))
+        return false;
 
-        // Normalize pivot row
-        uint16_t inv = modinv(A[col][col], PRIME_MODULUS);
-        for (int j = col; j <= k; ++j)
-            A[col][j] = ((uint32_t)A[col][j] * inv) % PRIME_MODULUS;
+    // chosen is increasing, so moving each one down never overwrites one still to move
+    for (int i = 0; i < k; ++i)
+    {
+        shadows[i] = shadows[chosen[i]];
+        x[i] = x[chosen[i]];
+    }
+    return true;
+}
 
-        // Eliminate below
-        for (int row = col + 1; row < k; ++row)
+/**
+ * @brief Extracts the shadows of k = 8 layout stego images, which carry no header.
+ * @return The amount of shadows extracted, or -1 if out of memory.
+ */
+static int sss_extract_legacy(ArenaT *arena, BMPImageT **shadows, uint32_t count, size_t shadow_len,
+                              uint8_t **shadow_array, uint16_t *x_array)
+{
+    stats_begin(STATS_EXTRACT);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        shadow_array[i] = arena_calloc(arena, shadow_len, sizeof(uint8_t));
+        if (shadow_array[i] == NULL)
         {
-            uint16_t factor = A[row][col];
-            for (int j = col; j <= k; ++j)
-            {
-                A[row][j] = (PRIME_MODULUS + A[row][j] - factor * A[col][j] % PRIME_MODULUS) % PRIME_MODULUS;
-            }
+            stats_end(STATS_EXTRACT);
+            return -1;
         }
+        lsb_decoder_lsb1_extract_to_buffer(shadow_array[i], shadow_len, shadows[i]);
+        x_array[i] = stego_meta_get_x(shadows[i]);
     }
-    memset(out_coeffs, 0, k);
+    stats_end(STATS_EXTRACT);
+    stats_add_bytes_read(STATS_EXTRACT, (uint64_t)shadow_len * count);
+    return count;
+}
 
-    // Back-substitution
-    for (int i = k - 1; i >= 0; --i)
+/**
+ * @brief Reads the header most stego images of a generic distribution parse and agree on,
+ *        among those with the given k, so one damaged image does not decide it.
+ */
+static bool sss_read_generic_meta(BMPImageT **shadows, uint32_t count, uint32_t k, StegoMetaT *meta)
+{
+    StegoMetaT candidates[SSS_META_CANDIDATES];
+    uint32_t votes[SSS_META_CANDIDATES];
+    int distinct = 0;
+    uint32_t other_k = 0;
+    for (uint32_t i = 0; i < count; i++)
     {
-        uint16_t sum = A[i][k];
-        for (int j = i + 1; j < k; ++j)
+        StegoMetaT shadow_meta;
+        if (!lsb_decoder_lsb1_read_meta(shadows[i], &shadow_meta))
+            continue;
+        if (shadow_meta.version != 0 && shadow_meta.k != k)
         {
-            sum = (PRIME_MODULUS + sum - A[i][j] * out_coeffs[j] % PRIME_MODULUS) % PRIME_MODULUS;
+            other_k = other_k != 0 ? other_k : shadow_meta.k;
+            continue;
         }
-        out_coeffs[i] = sum;
+
+        int c = 0;
+        while (c < distinct && !stego_meta_compatible(&candidates[c], &shadow_meta))
+            c++;
+        if (c < distinct)
+        {
+            votes[c]++;
+        }
+        else if (distinct < SSS_META_CANDIDATES)
+        {
+            candidates[distinct] = shadow_meta;
+            votes[distinct++] = 1;
+        }
+    }
+
+    if (distinct == 0)
+    {
+        if (other_k != 0)
+            fprintf(stderr, "Error: shadows were distributed with k = %u, not %u\n", other_k, k);
+        else
+            fprintf(stderr, "Error: shadows are not valid\n");
+        return false;
+    }
+
+    // Ties go to the header seen first
+    int best = 0;
+    for (int c = 1; c < distinct; c++)
+    {
+        if (votes[c] > votes[best])
+            best = c;
     }
+    *meta = candidates[best];
+    return true;
+}
+
+/**
+ * @brief Stego image of the chosen shadow with the given x whose header matches the
+ *        distribution, for what the shadow data does not carry, such as the palette.
+ * @param meta Header of the distribution, or NULL for the k = 8 layout.
+ */
+static BMPImageT *sss_chosen_image(BMPImageT **shadows, uint32_t count, uint16_t x, const StegoMetaT *meta)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        StegoMetaT shadow_meta;
+        if (stego_meta_get_x(shadows[i]) != x)
+            continue;
+        if (meta == NULL || (lsb_decoder_lsb1_read_meta(shadows[i], &shadow_meta) && stego_meta_compatible(&shadow_meta, meta)))
+            return shadows[i];
+    }
+    // Not reached: chosen shadows were extracted from these images
+    return shadows[0];
+}
+
+/**
+ * @brief Seed most of the k chosen stego images hold.
+ * @param x The x coordinates of the chosen shadows.
+ * @param meta Header of the distribution, or NULL for the k = 8 layout.
+ */
+static uint16_t sss_chosen_seed(BMPImageT **shadows, uint32_t count, const uint16_t *x, int k, const StegoMetaT *meta)
+{
+    uint16_t seeds[MAX_K];
+    for (int i = 0; i < k; ++i)
+        seeds[i] = stego_meta_get_seed(sss_chosen_image(shadows, count, x[i], meta));
 
+    int best = 0, best_votes = 0;
     for (int i = 0; i < k; ++i)
-        free(A[i]);
-    free(A);
+    {
+        int votes = 0;
+        for (int j = 0; j < k; ++j)
+            votes += seeds[j] == seeds[i];
+        if (votes > best_votes)
+        {
+            best = i;
+            best_votes = votes;
+        }
+    }
+    return seeds[best];
 }
 
-uint8_t lagrange_reconstruct_pixel(uint8_t *y, uint16_t *x, int k)
+/**
+ * @brief Extracts the stripes of every stego image in parallel and joins them into shadows.
+ *
+ * Stego images are grouped by x. A shadow is only usable once all of its stripes were found
+ * and passed their CRC32C; those of another distribution and repeated stripes are left out.
+ * @return The amount of usable shadows, moved first in shadow_array and x_array, or -1 if out
+ *         of memory.
+ */
+static int sss_extract_stripes(ArenaT *arena, BMPImageT **shadows, uint32_t count, const StegoMetaT *meta,
+                               size_t shadow_len, uint8_t **shadow_array, uint16_t *x_array)
 {
-    int sum = 0;
+    uint32_t stripes = meta->stripes;
+    SSSStripeT *jobs = arena_calloc(arena, count, sizeof(SSSStripeT));
+    uint32_t *job_share = arena_alloc(arena, count * sizeof(uint32_t));
+    uint8_t *found = arena_calloc(arena, (size_t)count * stripes, sizeof(uint8_t)); // Per share and stripe
+    if (jobs == NULL || job_share == NULL || found == NULL)
+        return -1;
+
+    // Headers first, which are short: they tell which shadow and which part of it each image holds
+    uint32_t shares = 0, job_count = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint16_t x = stego_meta_get_x(shadows[i]);
+        SSSStripeT *job = &jobs[job_count];
+        if (!lsb_decoder_lsb1_read_meta(shadows[i], &job->meta) || !stego_meta_compatible(&job->meta, meta))
+        {
+            fprintf(stderr, "Warning: the stego image with x = %u does not belong to the same distribution, leaving it out\n", x);
+            continue;
+        }
 
-    for (int i = 0; i < k; i++)
+        uint32_t share = 0;
+        while (share < shares && x_array[share] != x)
+            share++;
+        if (share == shares)
+        {
+            shadow_array[share] = arena_alloc(arena, shadow_len);
+            if (shadow_array[share] == NULL)
+                return -1;
+            x_array[shares++] = x;
+        }
+        if (found[(size_t)share * stripes + job->meta.stripe])
+        {
+            fprintf(stderr, "Warning: more than one stego image with x = %u and stripe %u, using the first one\n",
+                    x, job->meta.stripe + 1);
+            continue;
+        }
+        found[(size_t)share * stripes + job->meta.stripe] = 1;
+
+        job->cover = shadows[i];
+        job->data = shadow_array[share] + stego_meta_stripe_offset(meta, job->meta.stripe);
+        job_share[job_count++] = share;
+    }
+
+    sss_stripes_extract(jobs, job_count);
+    for (uint32_t j = 0; j < job_count; j++)
     {
-        int numerator = 1;
-        int denominator = 1;
+        if (!jobs[j].ok)
+            found[(size_t)job_share[j] * stripes + jobs[j].meta.stripe] = 0;
+    }
 
-        for (int j = 0; j < k; j++)
+    int usable = 0;
+    for (uint32_t share = 0; share < shares; share++)
+    {
+        uint32_t stripe = 0;
+        while (stripe < stripes && found[(size_t)share * stripes + stripe])
+            stripe++;
+        if (stripe < stripes)
         {
-            if (j == i)
-                continue;
+            fprintf(stderr, "Warning: stripe %u of the shadow with x = %u is missing or corrupt, leaving it out\n",
+                    stripe + 1, x_array[share]);
+            continue;
+        }
+        shadow_array[usable] = shadow_array[share];
+        x_array[usable++] = x_array[share];
+    }
+    return usable;
+}
 
-            int xj = x[j];
-            int xi = x[i];
+/**
+ * @brief Extracts the shadows of generic stego images, leaving out those that belong to
+ *        another distribution or fail their CRC32C, so that others may stand in for them.
+ * @param meta Header of the distribution, the one most stego images agree on.
+ * @return The amount of usable shadows, moved first in shadow_array and x_array, or -1 if out
+ *         of memory.
+ */
+static int sss_extract_generic(ArenaT *arena, BMPImageT **shadows, uint32_t count, const StegoMetaT *meta,
+                               size_t shadow_len, uint8_t **shadow_array, uint16_t *x_array)
+{
+    if (meta->stripes > 1)
+        return sss_extract_stripes(arena, shadows, count, meta, shadow_len, shadow_array, x_array);
 
-            numerator = (numerator * (PRIME_MODULUS - xj)) % PRIME_MODULUS; // -xj mod 257
-            int diff = (xi - xj + PRIME_MODULUS) % PRIME_MODULUS;
-            denominator = (denominator * diff) % PRIME_MODULUS;
+    int usable = 0;
+    stats_begin(STATS_EXTRACT);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Every image carries its own header, with the CRC32C of its own shadow data
+        uint16_t x = stego_meta_get_x(shadows[i]);
+        StegoMetaT shadow_meta;
+        if (!lsb_decoder_lsb1_read_meta(shadows[i], &shadow_meta) || !stego_meta_compatible(&shadow_meta, meta))
+        {
+            fprintf(stderr, "Warning: the stego image with x = %u does not belong to the same distribution, leaving it out\n", x);
+            continue;
         }
 
-        int li = (numerator * modinv(denominator, PRIME_MODULUS)) % PRIME_MODULUS;
-        sum = (sum + li * y[i]) % PRIME_MODULUS;
+        uint8_t *shadow = arena_calloc(arena, shadow_len, sizeof(uint8_t));
+        if (shadow == NULL)
+        {
+            stats_end(STATS_EXTRACT);
+            return -1;
+        }
+        if (!lsb_decoder_lsb1_extract_to_buffer_extended(shadow, shadow_len, shadows[i], &shadow_meta))
+        {
+            fprintf(stderr, "Warning: the stego image with x = %u is corrupt, leaving it out\n", x);
+            continue;
+        }
+        shadow_array[usable] = shadow;
+        x_array[usable++] = x;
     }
-
-    return (uint8_t)sum;
+    stats_end(STATS_EXTRACT);
+    stats_add_bytes_read(STATS_EXTRACT, ((uint64_t)shadow_len + stego_meta_size(meta)) * count);
+    return usable;
 }
 
-BMPImageT *sss_recover_8(BMPImageT **shadows, uint32_t k, const char *recovered_filename)
+BMPImageT *sss_recover_8(BMPImageT **shadows, uint32_t count, uint32_t k)
 {
     if (k < MIN_K || k > MAX_K)
     {
-        fprintf(stderr, "Invalid parameters: k must be between 2 and 10\n");
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", MIN_K, MAX_K);
         return NULL;
     }
 
-    uint16_t seed = shadows[0]->reserved[0] | (shadows[0]->reserved[1] << 8);
-    // bool flag = true, set = false,
-    bool error = false;
-    // int i = 0;
-
-    if (error)
+    // Extracted shadows are only needed until the image is interpolated, and go in one shot
+    ArenaT arena;
+    arena_init(&arena, 0);
+    BMPImageT *recovered_image = NULL;
+    uint8_t **shadow_array = arena_alloc(&arena, count * sizeof(uint8_t *));
+    uint16_t *x_array = arena_alloc(&arena, count * sizeof(uint16_t));
+    if (shadow_array == NULL || x_array == NULL)
+        goto cleanup;
+
+    // Legacy images carry no CRC, so stego images past the first k are what catches corruption
+    size_t shadow_len = ((size_t)shadows[0]->width * shadows[0]->height + k - 1) / k;
+    int usable = sss_extract_legacy(&arena, shadows, count, shadow_len, shadow_array, x_array);
+    if (usable < 0)
+        goto cleanup;
+
+    SSSInterpT interp;
+    if (!sss_choose_shadows(&arena, shadow_array, x_array, usable, k, shadow_len, STEGO_META_SHARE_BYTE, &interp))
     {
         fprintf(stderr, "Error: shadows are not valid\n");
-        return NULL;
+        goto cleanup;
     }
 
-    uint8_t **shadow_array = malloc(k * sizeof(uint8_t *));
-    uint16_t *x_array = malloc(k * sizeof(uint16_t));
-    int shadow_len = (shadows[0]->width * shadows[0]->height + k - 1) / k;
-    for (int i = 0; i < k; i++)
+    // The seed and palette come from the chosen stego images, not from whichever was read first
+    uint16_t seed = sss_chosen_seed(shadows, count, x_array, k, NULL);
+    const BMPImageT *reference = sss_chosen_image(shadows, count, x_array[0], NULL);
+    recovered_image = bmp_pool_create_image(bmp_pool_get_default(), shadows[0]->width, shadows[0]->height,
+                                            reference->palette, reference->colors_used);
+    if (recovered_image == NULL)
     {
-        shadow_array[i] = calloc(shadow_len, sizeof(uint8_t));
-        lsb_decoder_lsb1_extract_to_buffer(shadow_array[i], shadow_len, shadows[i]);
-        x_array[i] = shadows[i]->reserved[2] | (shadows[i]->reserved[3] << 8);
-    }
-
-    // modularize
-    BMPImageT *recovered_image = malloc(sizeof(BMPImageT));
-    recovered_image->palette = bmp_copy_palette(shadows[0]);
-    recovered_image->width = shadows[0]->width;
-    recovered_image->height = shadows[0]->height;
-    recovered_image->bpp = shadows[0]->bpp;
-    recovered_image->colors_used = shadows[0]->colors_used;
-    recovered_image->reserved = malloc(4);
-    recovered_image->reserved[0] = 0;
-    recovered_image->reserved[1] = 0;
-    recovered_image->reserved[2] = 0;
-    recovered_image->reserved[3] = 0;
-    // int image_size = recovered_image->width * recovered_image->height;
-
-    int width_bytes = recovered_image->width * recovered_image->bpp / 8;
-    int padded_row_bytes = (width_bytes % 4 == 0) ? width_bytes : (width_bytes + (4 - (width_bytes % 4)));
-    int padded_image_size = padded_row_bytes * recovered_image->height;
-    recovered_image->pixels = calloc(padded_image_size, sizeof(uint8_t));
-
-    for (int section = 0; section < shadow_len; ++section)
+        fprintf(stderr, "Out of memory: Failed to allocate the recovered image\n");
+        goto cleanup;
+    }
+
+    stats_begin(STATS_INTERP);
+    SSSInterpKernelFnT interp_coeffs = sss_kernels_active()->interp_coeffs;
+    BMPLinearIterT out_it;
+    bmp_linear_iter_init(&out_it, recovered_image, 0);
+    for (size_t section = 0; section < shadow_len; ++section)
     {
         uint8_t y_vals[MAX_K];
         for (int j = 0; j < k; ++j)
             y_vals[j] = shadow_array[j][section];
 
         uint8_t recovered_coeffs[MAX_K];
-        lagrange_solve_coeffs(y_vals, x_array, k, recovered_coeffs);
+        interp_coeffs(&interp, y_vals, recovered_coeffs);
 
-        for (int i = 0; i < k; ++i)
+        // The last section may hold padding past the end of the image, which is dropped
+        bmp_linear_write(&out_it, recovered_coeffs, k);
+    }
+    stats_end(STATS_INTERP);
+    stats_add_sections(STATS_INTERP, shadow_len);
+
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(recovered_image, seed, RNGPT_MODE_LCG48);
+    stats_end(STATS_XOR);
+
+cleanup:
+    arena_release(&arena);
+    return recovered_image;
+}
+
+/**
+ * @brief Interpolates every section of byte shadows into the recovered image.
+ */
+static void sss_recover_sections(const SSSInterpT *interp, const uint8_t **shadows, size_t sections, BMPLinearIterT *out_it)
+{
+    int k = interp->k;
+    SSSInterpKernelFnT interp_coeffs = sss_kernels_active()->interp_coeffs;
+    for (size_t section = 0; section < sections; ++section)
+    {
+        uint8_t y_vals[MAX_K];
+        for (int j = 0; j < k; ++j)
+            y_vals[j] = shadows[j][section];
+
+        uint8_t recovered_coeffs[MAX_K];
+        interp_coeffs(interp, y_vals, recovered_coeffs);
+
+        // The last section may hold padding past the end of the image, which is dropped
+        bmp_linear_write(out_it, recovered_coeffs, k);
+    }
+}
+
+/**
+ * @brief Interpolates every section of packed 9-bit shadows, 8 sections at a time.
+ */
+static void sss_recover_sections_packed(const SSSInterpT *interp, const uint8_t **shadows, size_t sections, BMPLinearIterT *out_it)
+{
+    int k = interp->k;
+    uint16_t group[MAX_K][8];
+    SSSInterpWideKernelFnT interp_wide = sss_kernels_active()->interp_wide;
+
+    for (size_t base = 0; base < sections; base += 8)
+    {
+        size_t run = sections - base < 8 ? sections - base : 8;
+        for (int j = 0; j < k; ++j)
+            bitpack_unpack(group[j], shadows[j] + base / 8 * STEGO_META_SHARE_PACKED, run, STEGO_META_SHARE_PACKED);
+
+        for (size_t s = 0; s < run; ++s)
         {
-            int pixel_index = section * k + i;
-            if (pixel_index >= recovered_image->width * recovered_image->height)
-                break;
-            // uint8_t *ptr = recovered_image->pixels;
-            // ptr[pixel_index] = recovered_coeffs[i];
-            uint8_t *px = bmp_get_pixel_address(recovered_image, pixel_index % recovered_image->width, pixel_index / recovered_image->width);
-            *px = recovered_coeffs[i];
+            uint16_t y_vals[MAX_K];
+            for (int j = 0; j < k; ++j)
+                y_vals[j] = group[j][s];
+
+            uint8_t recovered_coeffs[MAX_K];
+            interp_wide(interp, y_vals, recovered_coeffs);
+            bmp_linear_write(out_it, recovered_coeffs, k);
         }
     }
+}
 
-    rngpt_set_seed(seed);
-    int scanline_size = bmp_align(recovered_image->width);
-    int image_size = scanline_size * recovered_image->height;
-    uint8_t *rng_table = rngpt_get_byte_table_4balign(recovered_image);
-    if (!rng_table)
+BMPImageT *sss_recover_generic(BMPImageT **shadows, uint32_t count, uint32_t k)
+{
+    if (k < MIN_K || k > MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", MIN_K, MAX_K);
+        return NULL;
+    }
+
+    StegoMetaT meta;
+    if (!sss_read_generic_meta(shadows, count, k, &meta) || !sss_check_dict(&meta))
+        return NULL;
+    if (meta.entries > 1)
     {
-        fprintf(stderr, "Failed to generate RNG table\n");
+        fprintf(stderr, "Error: the stego images hold %u packed secrets, pick one with --entry\n", meta.entries);
         return NULL;
     }
 
-    rngpt_inplace_xor(recovered_image->pixels, rng_table, image_size);
-    free(rng_table);
+    // Extracted shadows are only needed until the image is interpolated, and go in one shot
+    ArenaT arena;
+    arena_init(&arena, 0);
+    BMPImageT *recovered_image = NULL;
+    uint8_t **shadow_array = arena_alloc(&arena, count * sizeof(uint8_t *));
+    uint16_t *x_array = arena_alloc(&arena, count * sizeof(uint16_t));
+    if (shadow_array == NULL || x_array == NULL)
+        goto cleanup;
+
+    size_t sections = (stego_meta_payload_len(&meta) + k - 1) / k;
+    size_t shadow_len = stego_meta_shadow_bytes(&meta, sections);
+    int usable = sss_extract_generic(&arena, shadows, count, &meta, shadow_len, shadow_array, x_array);
+    if (usable < 0)
+        goto cleanup;
+
+    SSSInterpT interp;
+    if (!sss_choose_shadows(&arena, shadow_array, x_array, usable, k, sections, meta.share_bits, &interp))
+    {
+        fprintf(stderr, "Error: shadows are not valid\n");
+        goto cleanup;
+    }
+
+    uint16_t seed = sss_chosen_seed(shadows, count, x_array, k, &meta);
+    const BMPImageT *reference = sss_chosen_image(shadows, count, x_array[0], &meta);
 
-    bmp_save(recovered_filename, recovered_image);
-    for (int i = 0; i < k; i++)
+    // A compressed secret comes back as the one-row image it was shared as
+    if (meta.compress != COMPRESS_NONE)
+        recovered_image = bmp_create((int32_t)meta.payload_len, 1, 8, NULL, 256);
+    else
+        recovered_image = bmp_pool_create_image(bmp_pool_get_default(), meta.s_width, meta.s_height,
+                                                reference->palette, reference->colors_used);
+    if (recovered_image == NULL)
     {
-        free(shadow_array[i]);
+        fprintf(stderr, "Out of memory: Failed to allocate the recovered image\n");
+        goto cleanup;
     }
-    free(shadow_array);
-    free(x_array); // Unload the first shadow to free palette and other resources
+
+    stats_begin(STATS_INTERP);
+    BMPLinearIterT out_it;
+    bmp_linear_iter_init(&out_it, recovered_image, 0);
+    if (meta.share_bits == STEGO_META_SHARE_PACKED)
+        sss_recover_sections_packed(&interp, (const uint8_t **)shadow_array, sections, &out_it);
+    else
+        sss_recover_sections(&interp, (const uint8_t **)shadow_array, sections, &out_it);
+    stats_end(STATS_INTERP);
+    stats_add_sections(STATS_INTERP, sections);
+
+    // XOR is its own inverse, so undoing the scramble is the same pass as applying it
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(recovered_image, seed, meta.keystream);
+    stats_end(STATS_XOR);
+
+    if (meta.compress != COMPRESS_NONE)
+    {
+        BMPImageT *payload = recovered_image;
+        stats_begin(STATS_COMPRESS);
+        recovered_image = sss_decompress_secret(payload, &meta, reference);
+        stats_end(STATS_COMPRESS);
+        stats_add_bytes_read(STATS_COMPRESS, meta.payload_len);
+        stats_add_bytes_written(STATS_COMPRESS, (size_t)meta.s_width * meta.s_height);
+        bmp_unload(payload);
+    }
+
+cleanup:
+    arena_release(&arena);
     return recovered_image;
 }
 
-BMPImageT *sss_recover_generic(BMPImageT **shadows, uint32_t k, const char *recovered_filename)
+/**
+ * @brief Reads the directory entry of one packed secret that most stego images of the pack
+ *        agree on. The CRC32C, which is specific to each image, is not compared.
+ * @param entries Scratch space for the directory of one image.
+ */
+static bool sss_read_pack_entry(BMPImageT **shadows, uint32_t count, const StegoMetaT *meta, uint32_t index,
+                                StegoEntryT *entries, StegoEntryT *entry)
+{
+    StegoEntryT candidates[SSS_META_CANDIDATES];
+    uint32_t votes[SSS_META_CANDIDATES];
+    int distinct = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        StegoMetaT shadow_meta;
+        if (!lsb_decoder_lsb1_read_meta(shadows[i], &shadow_meta) || !stego_meta_compatible(&shadow_meta, meta) ||
+            !lsb_decoder_lsb1_read_entries(shadows[i], &shadow_meta, entries))
+            continue;
+
+        const StegoEntryT *e = &entries[index];
+        int c = 0;
+        while (c < distinct && (candidates[c].s_width != e->s_width || candidates[c].s_height != e->s_height ||
+                                candidates[c].compress != e->compress || candidates[c].dict_crc != e->dict_crc ||
+                                candidates[c].offset != e->offset || candidates[c].payload_len != e->payload_len))
+            c++;
+        if (c < distinct)
+        {
+            votes[c]++;
+        }
+        else if (distinct < SSS_META_CANDIDATES)
+        {
+            candidates[distinct] = *e;
+            votes[distinct++] = 1;
+        }
+    }
+    if (distinct == 0)
+        return false;
+
+    int best = 0;
+    for (int c = 1; c < distinct; c++)
+    {
+        if (votes[c] > votes[best])
+            best = c;
+    }
+    *entry = candidates[best];
+    return true;
+}
+
+/**
+ * @brief Extracts the shares of one packed secret from each stego image, leaving out those of
+ *        another pack and those whose range fails the CRC32C in their directory. The rest of
+ *        the shadow data is not read.
+ * @param meta Header of the pack, the one most stego images agree on.
+ * @param entry The secret's entry the one most directories agree on.
+ * @return The amount of usable shadows, moved first in shadow_array and x_array, or -1 if out
+ *         of memory.
+ */
+static int sss_extract_entry(ArenaT *arena, BMPImageT **shadows, uint32_t count, const StegoMetaT *meta,
+                             uint32_t index, const StegoEntryT *entry, uint8_t **shadow_array, uint16_t *x_array)
+{
+    uint32_t k = meta->k;
+    size_t offset, len;
+    sss_entry_shadow_range(meta, entry, k, &offset, &len);
+    size_t cover_bytes = stego_meta_cover_bytes(meta, stego_meta_shadow_len(meta));
+    StegoEntryT *entries = arena_alloc(arena, meta->entries * sizeof(StegoEntryT));
+    if (entries == NULL)
+        return -1;
+
+    int usable = 0;
+    stats_begin(STATS_EXTRACT);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint16_t x = stego_meta_get_x(shadows[i]);
+        StegoMetaT shadow_meta;
+        if (!lsb_decoder_lsb1_read_meta(shadows[i], &shadow_meta) || !stego_meta_compatible(&shadow_meta, meta) ||
+            (size_t)bmp_stride(shadows[i]) * shadows[i]->height < cover_bytes ||
+            !lsb_decoder_lsb1_read_entries(shadows[i], &shadow_meta, entries) ||
+            entries[index].offset != entry->offset || entries[index].payload_len != entry->payload_len)
+        {
+            fprintf(stderr, "Warning: the stego image with x = %u does not belong to the same distribution, leaving it out\n", x);
+            continue;
+        }
+
+        uint8_t *shadow = arena_alloc(arena, len);
+        if (shadow == NULL)
+        {
+            stats_end(STATS_EXTRACT);
+            return -1;
+        }
+        // The range starts on a byte, so its CRC32C starts from 0 like the one in the directory
+        uint32_t crc = lsb_decoder_extract_shadow_range(shadows[i], &shadow_meta, stego_meta_get_seed(shadows[i]),
+                                                        shadow, offset, len, 0);
+        if (crc != entries[index].shadow_crc)
+        {
+            fprintf(stderr, "Warning: the stego image with x = %u is corrupt, leaving it out\n", x);
+            continue;
+        }
+        shadow_array[usable] = shadow;
+        x_array[usable++] = x;
+    }
+    stats_end(STATS_EXTRACT);
+    stats_add_bytes_read(STATS_EXTRACT, ((uint64_t)len + stego_meta_size(meta) + stego_meta_dir_size(meta)) * count);
+    return usable;
+}
+
+BMPImageT *sss_recover_pack_entry(BMPImageT **shadows, uint32_t count, uint32_t k, uint32_t index)
 {
     if (k < MIN_K || k > MAX_K)
     {
-        fprintf(stderr, "Invalid parameters: k must be between 2 and 10\n");
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", MIN_K, MAX_K);
         return NULL;
     }
 
-    uint16_t seed = shadows[0]->reserved[0] | (shadows[0]->reserved[1] << 8);
-    // bool flag = true, set = false,
-    bool error = false;
-    // int i = 0;
+    StegoMetaT meta;
+    if (!sss_read_generic_meta(shadows, count, k, &meta))
+        return NULL;
+    if (meta.version == 0 || index >= meta.entries)
+    {
+        fprintf(stderr, "Error: there is no secret %u, the stego images hold %u\n", index + 1,
+                meta.version == 0 ? 1 : meta.entries);
+        return NULL;
+    }
+    if (meta.entries == 1)
+        return sss_recover_generic(shadows, count, k);
+
+    ArenaT arena;
+    arena_init(&arena, 0);
+    BMPImageT *recovered_image = NULL;
+    BMPImageT *payload = NULL;
+    StegoEntryT *entries = arena_alloc(&arena, meta.entries * sizeof(StegoEntryT));
+    uint8_t **shadow_array = arena_alloc(&arena, count * sizeof(uint8_t *));
+    uint16_t *x_array = arena_alloc(&arena, count * sizeof(uint16_t));
+    if (entries == NULL || shadow_array == NULL || x_array == NULL)
+        goto cleanup;
+    StegoEntryT common_entry;
+    if (!sss_read_pack_entry(shadows, count, &meta, index, entries, &common_entry))
+    {
+        fprintf(stderr, "Error: shadows are not valid\n");
+        goto cleanup;
+    }
 
-    if (error)
+    // From here on the secret is recovered like a lone one, with the fields of its entry
+    const StegoEntryT *entry = &common_entry;
+    StegoMetaT secret_meta = meta;
+    secret_meta.s_width = entry->s_width;
+    secret_meta.s_height = entry->s_height;
+    secret_meta.compress = entry->compress;
+    secret_meta.payload_len = entry->payload_len;
+    secret_meta.dict_crc = entry->dict_crc;
+    secret_meta.entries = 1;
+    if ((uint64_t)entry->offset + entry->payload_len > meta.payload_len || !sss_check_dict(&secret_meta))
+        goto cleanup;
+
+    size_t sections = (entry->payload_len + k - 1) / k;
+    int usable = sss_extract_entry(&arena, shadows, count, &meta, index, entry, shadow_array, x_array);
+    if (usable < 0)
+        goto cleanup;
+
+    SSSInterpT interp;
+    if (!sss_choose_shadows(&arena, shadow_array, x_array, usable, k, sections, meta.share_bits, &interp))
     {
         fprintf(stderr, "Error: shadows are not valid\n");
-        return NULL;
+        goto cleanup;
     }
+    uint16_t seed = sss_chosen_seed(shadows, count, x_array, k, &meta);
+    const BMPImageT *reference = sss_chosen_image(shadows, count, x_array[0], &meta);
 
-    uint8_t **shadow_array = malloc(k * sizeof(uint8_t *));
-    uint16_t *x_array = malloc(k * sizeof(uint16_t));
-    LSBDecodeResult tmp = lsb_decoder_lsb1_get_dimensions(shadows[0]);
-    int shadow_len = (tmp.s_width * tmp.s_height + k - 1) / k;
-    for (int i = 0; i < k; i++)
+    // The sections past the end of the secret are padding, and dropped by the iterator
+    payload = bmp_create((int32_t)entry->payload_len, 1, 8, NULL, 256);
+    if (payload == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the recovered image\n");
+        goto cleanup;
+    }
+
+    stats_begin(STATS_INTERP);
+    BMPLinearIterT out_it;
+    bmp_linear_iter_init(&out_it, payload, 0);
+    if (meta.share_bits == STEGO_META_SHARE_PACKED)
+        sss_recover_sections_packed(&interp, (const uint8_t **)shadow_array, sections, &out_it);
+    else
+        sss_recover_sections(&interp, (const uint8_t **)shadow_array, sections, &out_it);
+    stats_end(STATS_INTERP);
+    stats_add_sections(STATS_INTERP, sections);
+
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(payload, (uint16_t)(seed + index), meta.keystream);
+    stats_end(STATS_XOR);
+
+    stats_begin(STATS_COMPRESS);
+    recovered_image = sss_decompress_secret(payload, &secret_meta, reference);
+    stats_end(STATS_COMPRESS);
+    stats_add_bytes_read(STATS_COMPRESS, entry->payload_len);
+    stats_add_bytes_written(STATS_COMPRESS, (size_t)entry->s_width * entry->s_height);
+
+cleanup:
+    if (entries == NULL || shadow_array == NULL || x_array == NULL)
+        fprintf(stderr, "Out of memory: Failed to allocate the shadows\n");
+    arena_release(&arena);
+    bmp_unload(payload);
+    return recovered_image;
+}
+/**
+ * @brief Computes the share at a new x from k agreeing shadows and hides it in a cover.
+ *
+ * The share of each section is the evaluation row of the prepared weights at x dotted with
+ * the k shares, so no coefficient is recovered. Shares are computed a block of sections at a
+ * time and each block is embedded as soon as it is ready; only the new stego image is written.
+ *
+ * @param interp Weights of the k shadows, first in shadows.
+ * @param meta Header of the distribution, or NULL for the k = 8 layout.
+ */
+static bool sss_extend_shadows(const SSSInterpT *interp, const uint8_t **shadows, size_t sections, uint16_t x,
+                               uint16_t seed, const StegoMetaT *meta, BMPImageT *cover, const char *output_dir,
+                               const SSSOptionsT *opts)
+{
+    int k = interp->k;
+    unsigned share_bits = meta != NULL ? meta->share_bits : STEGO_META_SHARE_BYTE;
+    bool packed = share_bits == STEGO_META_SHARE_PACKED;
+    size_t shadow_len = meta != NULL ? stego_meta_shadow_bytes(meta, sections) : sections;
+    size_t cover_bytes = meta != NULL ? stego_meta_cover_bytes(meta, shadow_len) : shadow_len * 8;
+    if (!sssh_can_hide_bits(cover, cover_bytes))
+    {
+        fprintf(stderr, "Cover image too small to hide shadow data\n");
+        return false;
+    }
+
+    char output_path[512];
+    snprintf(output_path, sizeof(output_path), "%s/stego%u.bmp", output_dir, x);
+    if (access(output_path, F_OK) == 0)
     {
-        shadow_array[i] = calloc(shadow_len, sizeof(uint16_t));
-        lsb_decoder_lsb1_extract_to_buffer_extended(shadow_array[i], shadow_len, shadows[i], k);
-        x_array[i] = shadows[i]->reserved[2] | (shadows[i]->reserved[3] << 8);
+        fprintf(stderr, "Error: '%s' already exists\n", output_path);
+        return false;
     }
 
-    // modularize
-    BMPImageT *recovered_image = malloc(sizeof(BMPImageT));
-    recovered_image->palette = bmp_copy_palette(shadows[0]);
-    recovered_image->width = tmp.s_width;
-    recovered_image->height = tmp.s_height;
-    recovered_image->bpp = shadows[0]->bpp;
-    recovered_image->colors_used = shadows[0]->colors_used;
-    recovered_image->reserved = malloc(4);
-    recovered_image->reserved[0] = 0;
-    recovered_image->reserved[1] = 0;
-    recovered_image->reserved[2] = 0;
-    recovered_image->reserved[3] = 0;
-    // int image_size = recovered_image->width * recovered_image->height;
+    uint16_t row[MAX_K];
+    sss_interp_eval_row(interp, x, row);
 
-    int width_bytes = recovered_image->width * recovered_image->bpp / 8;
-    int padded_row_bytes = (width_bytes % 4 == 0) ? width_bytes : (width_bytes + (4 - (width_bytes % 4)));
-    int padded_image_size = padded_row_bytes * recovered_image->height;
-    recovered_image->pixels = calloc(padded_image_size, sizeof(uint8_t));
+    uint8_t *block = malloc(packed ? bitpack_size(SSS_PIPELINE_BLOCK_SECTIONS, STEGO_META_SHARE_PACKED) : SSS_PIPELINE_BLOCK_SECTIONS);
+    uint16_t *wide = packed ? malloc(SSS_PIPELINE_BLOCK_SECTIONS * sizeof(uint16_t)) : NULL;
+    if (block == NULL || (packed && wide == NULL))
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the new shadow\n");
+        free(block);
+        free(wide);
+        return false;
+    }
 
-    for (int section = 0; section < shadow_len; ++section)
+    // Existing shares were fixed up to fit a byte, but nothing can fix one up at a new x
+    size_t clipped = 0;
+    uint32_t crc = 0;
+    SSSEmbedKernelFnT embed = sss_kernels_active()->lsb1_embed;
+    for (size_t first = 0; first < sections; first += SSS_PIPELINE_BLOCK_SECTIONS)
     {
-        uint8_t y_vals[MAX_K];
-        for (int j = 0; j < k; ++j)
-            y_vals[j] = shadow_array[j][section];
+        size_t run = sections - first < SSS_PIPELINE_BLOCK_SECTIONS ? sections - first : SSS_PIPELINE_BLOCK_SECTIONS;
+        stats_begin(STATS_SHARE);
+        for (size_t s = 0; s < run; ++s)
+        {
+            uint32_t acc = 0;
+            for (int i = 0; i < k; ++i)
+                acc += (uint32_t)row[i] * sss_shadow_value(shadows[i], first + s, share_bits);
+            uint16_t share = acc % PRIME_MODULUS;
+            if (packed)
+                wide[s] = share;
+            else if (share == PRIME_MODULUS - 1)
+            {
+                block[s] = PRIME_MODULUS - 2;
+                clipped++;
+            }
+            else
+                block[s] = share;
+        }
+        if (packed)
+            bitpack_pack(block, wide, run, STEGO_META_SHARE_PACKED);
+        stats_end(STATS_SHARE);
+
+        // Blocks are a multiple of 8 sections, so packed shares start on a byte boundary
+        size_t offset = packed ? first / 8 * STEGO_META_SHARE_PACKED : first;
+        size_t bytes = packed ? bitpack_size(run, STEGO_META_SHARE_PACKED) : run;
+        stats_begin(STATS_EMBED);
+        if (meta != NULL)
+            crc = lsb_encoder_embed_shadow_range(cover, meta, seed, block, offset, bytes, crc);
+        else
+            embed((uint8_t *)cover->pixels + offset * 8, block, bytes);
+        stats_end(STATS_EMBED);
+    }
+    free(block);
+    free(wide);
+    stats_add_sections(STATS_SHARE, sections);
+
+    if (clipped > 0)
+        fprintf(stderr, "Warning: %zu sections of the share at x = %u are 256 and were stored as 255; "
+                        "recovering with it alters those sections (distribute with --packed to avoid this)\n",
+                clipped, x);
+
+    // The header records the CRC32C of the whole shadow data, so it goes in last
+    size_t header_len = 0;
+    if (meta != NULL)
+    {
+        StegoMetaT tagged = *meta;
+        tagged.shadow_crc = crc;
+        uint8_t header[STEGO_META_MAX_SIZE];
+        header_len = stego_meta_serialize(&tagged, header);
+        stats_begin(STATS_EMBED);
+        lsb_encoder_lsb1_embed_bytes(cover->pixels, header, header_len);
+        stats_end(STATS_EMBED);
+    }
+    stats_add_bytes_written(STATS_EMBED, shadow_len + header_len);
+    stego_meta_set_reserved(cover, seed, x, meta != NULL);
 
-        uint8_t recovered_coeffs[MAX_K];
-        //lagrange_reconstruct_coeffs(y_vals, x_array, k, recovered_coeffs);
-        lagrange_solve_coeffs(y_vals, x_array, k, recovered_coeffs);
+    BMPWriterT *writer = bmp_writer_create(1, opts->writer, opts->fsync ? BMP_WRITER_FSYNC : 0);
+    if (writer == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the stego image writer\n");
+        return false;
+    }
+    bool ok = bmp_writer_add(writer, output_path, cover) && bmp_writer_flush(writer);
+    bmp_writer_destroy(writer);
+    if (!ok)
+        fprintf(stderr, "Failed to save stego image '%s'\n", output_path);
+    return ok;
+}
 
-        for (int i = 0; i < k; ++i)
+/**
+ * @brief Whether x is free among the stego images loaded, checked before any extraction.
+ */
+static bool sss_extend_x_free(BMPImageT **shadows, uint32_t count, uint16_t x)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (stego_meta_get_x(shadows[i]) == x)
         {
-            int pixel_index = section * k + i;
-            if (pixel_index >= recovered_image->width * recovered_image->height)
-                break;
-            uint8_t *px = bmp_get_pixel_address(recovered_image, pixel_index % recovered_image->width, pixel_index / recovered_image->width);
-            *px = recovered_coeffs[i];
+            fprintf(stderr, "Error: a stego image with x = %u exists already\n", x);
+            return false;
         }
     }
+    return true;
+}
 
-    rngpt_set_seed(seed);
-    int scanline_size = bmp_align(recovered_image->width);
-    int image_size = scanline_size * recovered_image->height;
-    uint8_t *rng_table = rngpt_get_byte_table_noalign(image_size);
-    if (!rng_table)
+bool sss_extend_8(BMPImageT **shadows, uint32_t count, uint32_t k, uint16_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts)
+{
+    if (!sss_extend_x_free(shadows, count, x))
+        return false;
+
+    // Without a header, the secret is as large as the stego images; the cover must be too
+    if (cover->width != shadows[0]->width || cover->height != shadows[0]->height)
     {
-        fprintf(stderr, "Failed to generate RNG table\n");
-        return NULL;
+        fprintf(stderr, "Error: the cover must be %dx%d, like the stego images of the k = 8 layout\n",
+                shadows[0]->width, shadows[0]->height);
+        return false;
     }
 
-    rngpt_inplace_xor_aligned(recovered_image, rng_table);
+    ArenaT arena;
+    arena_init(&arena, 0);
+    bool ok = false;
+    uint8_t **shadow_array = arena_alloc(&arena, count * sizeof(uint8_t *));
+    uint16_t *x_array = arena_alloc(&arena, count * sizeof(uint16_t));
+    if (shadow_array == NULL || x_array == NULL)
+        goto cleanup;
+
+    size_t shadow_len = ((size_t)shadows[0]->width * shadows[0]->height + k - 1) / k;
+    int usable = sss_extract_legacy(&arena, shadows, count, shadow_len, shadow_array, x_array);
+    if (usable < 0)
+        goto cleanup;
+
+    SSSInterpT interp;
+    if (!sss_choose_shadows(&arena, shadow_array, x_array, usable, k, shadow_len, STEGO_META_SHARE_BYTE, &interp))
+        goto cleanup;
+
+    ok = sss_extend_shadows(&interp, (const uint8_t **)shadow_array, shadow_len, x,
+                            sss_chosen_seed(shadows, count, x_array, k, NULL), NULL, cover, output_dir, opts);
+
+cleanup:
+    arena_release(&arena);
+    return ok;
+}
 
-    bmp_save(recovered_filename, recovered_image);
+bool sss_extend_generic(BMPImageT **shadows, uint32_t count, uint32_t k, uint16_t x, BMPImageT *cover, const char *output_dir, const SSSOptionsT *opts)
+{
+    if (!sss_extend_x_free(shadows, count, x))
+        return false;
 
-    for (int i = 0; i < k; i++)
+    StegoMetaT meta;
+    if (!sss_read_generic_meta(shadows, count, k, &meta))
+        return false;
+    if (meta.entries > 1)
     {
-        free(shadow_array[i]);
+        fprintf(stderr, "Error: the stego images hold %u packed secrets, which cannot be extended\n", meta.entries);
+        return false;
+    }
+    if (meta.stripes > 1)
+    {
+        fprintf(stderr, "Error: the shadows are split in %u stripes, which cannot be extended\n", meta.stripes);
+        return false;
     }
-    free(shadow_array);
-    free(x_array); // Unload the first shadow to free palette and other resources
-    free(rng_table);
 
-    return recovered_image;
-}
\ No newline at end of file
+    ArenaT arena;
+    arena_init(&arena, 0);
+    bool ok = false;
+    uint8_t **shadow_array = arena_alloc(&arena, count * sizeof(uint8_t *));
+    uint16_t *x_array = arena_alloc(&arena, count * sizeof(uint16_t));
+    if (shadow_array == NULL || x_array == NULL)
+        goto cleanup;
+
+    size_t sections = (stego_meta_payload_len(&meta) + k - 1) / k;
+    size_t shadow_len = stego_meta_shadow_bytes(&meta, sections);
+    int usable = sss_extract_generic(&arena, shadows, count, &meta, shadow_len, shadow_array, x_array);
+    if (usable < 0)
+        goto cleanup;
+
+    SSSInterpT interp;
+    if (!sss_choose_shadows(&arena, shadow_array, x_array, usable, k, sections, meta.share_bits, &interp))
+        goto cleanup;
+
+    // The new image gets the header of the others, so it joins them in any later recovery
+    ok = sss_extend_shadows(&interp, (const uint8_t **)shadow_array, sections, x,
+                            sss_chosen_seed(shadows, count, x_array, k, &meta), &meta, cover, output_dir, opts);
+
+cleanup:
+    arena_release(&arena);
+    return ok;
+}
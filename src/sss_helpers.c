@@ -1,5 +1,13 @@
 #include "../include/sss_helpers.h"
+#include "../include/stats.h"
+#include "../include/bmp_pool.h"
+#include "../include/cover_cache.h"
+#include "../include/bitpack.h"
+#include "../include/lsb_encoder.h"
+#include "../include/lsb_decoder.h"
+#include "../include/sss_kernels.h"
 #define METADATA_SIZE 32 // 2 bytes for width and 2 bytes for height * 8 bits per byte
+#define PACKET_CHUNK 64  // Packets packed or unpacked at a time, a multiple of 8
 
 static int ends_with_bmp(const char *filename)
 {
@@ -7,6 +15,11 @@ static int ends_with_bmp(const char *filename)
     return dot && strcmp(dot, ".bmp") == 0;
 }
 
+bool sssh_is_bmp_entry(const struct dirent *entry)
+{
+    return entry->d_type == DT_REG && ends_with_bmp(entry->d_name);
+}
+
 bool sssh_can_hide_bits(const BMPImageT *cover, size_t bits_needed)
 {
     if (!cover || !cover->pixels)
@@ -19,11 +32,91 @@ bool sssh_can_hide_bits(const BMPImageT *cover, size_t bits_needed)
     return cover_capacity >= bits_needed;
 }
 
-BMPImageT **load_bmp_images(
+bool sssh_8bit_lsb_into_cover(const uint8_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed)
+{
+    return lsb_encoder_lsb1_into_cover(shadow_data, shadow_len, cover, seed);
+}
+
+bool sssh_lsb1_into_cover_k(const uint16_t *shadow_data, size_t shadow_len, BMPImageT *cover, uint16_t seed, int k, int16_t s_width, int16_t s_height)
+{
+    (void)seed;
+    if (!shadow_data || !cover || !cover->pixels)
+        return false;
+    if (k < 1 || k > BITPACK_MAX_BITS)
+    {
+        fprintf(stderr, "Invalid parameters: packets must be 1 to %d bits wide, not %d\n", BITPACK_MAX_BITS, k);
+        return false;
+    }
+    if (!sssh_can_hide_bits(cover, METADATA_SIZE + bitpack_size(shadow_len, k) * 8))
+    {
+        fprintf(stderr, "Cover image too small to hide shadow data\n");
+        return false;
+    }
+
+    SSSEmbedKernelFnT embed = sss_kernels_active()->lsb1_embed;
+    uint8_t dimensions[4] = {(uint16_t)s_width >> 8, (uint16_t)s_width & 0xFF,
+                             (uint16_t)s_height >> 8, (uint16_t)s_height & 0xFF};
+    embed(cover->pixels, dimensions, sizeof(dimensions));
+
+    // Chunks start on a multiple of 8 packets, so each one packs to whole bytes of the stream
+    uint8_t packed[PACKET_CHUNK * BITPACK_MAX_BITS / 8];
+    uint8_t *cover_data = (uint8_t *)cover->pixels + METADATA_SIZE;
+    for (size_t first = 0; first < shadow_len; first += PACKET_CHUNK)
+    {
+        size_t count = shadow_len - first < PACKET_CHUNK ? shadow_len - first : PACKET_CHUNK;
+        size_t packed_len = bitpack_size(count, k);
+        bitpack_pack(packed, shadow_data + first, count, k);
+        embed(cover_data, packed, packed_len);
+        cover_data += packed_len * 8;
+    }
+    return true;
+}
+
+bool extract_shadow_lsb_to_buffer(uint8_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover)
+{
+    return lsb_decoder_lsb1_extract_to_buffer(out_shadow_data, shadow_len, cover);
+}
+
+LSBDecodeResultT sssh_extract_kshadow_dimensions(const BMPImageT *cover)
+{
+    if (!sssh_can_hide_bits(cover, METADATA_SIZE))
+        return (LSBDecodeResultT){.result = false, .s_width = 0, .s_height = 0};
+
+    LSBDecodeResult dims = lsb_decoder_lsb1_get_dimensions(cover);
+    return (LSBDecodeResultT){.result = dims.result, .s_width = (int16_t)dims.s_width, .s_height = (int16_t)dims.s_height};
+}
+
+LSBDecodeResultT sssh_extract_lsb1_kshadow(uint16_t *out_shadow_data, size_t shadow_len, const BMPImageT *cover, int k)
+{
+    LSBDecodeResultT failed = {.result = false, .s_width = 0, .s_height = 0};
+    if (!out_shadow_data || k < 1 || k > BITPACK_MAX_BITS)
+        return failed;
+    if (!sssh_can_hide_bits(cover, METADATA_SIZE + bitpack_size(shadow_len, k) * 8))
+    {
+        fprintf(stderr, "Cover image too small to hold the shadow data\n");
+        return failed;
+    }
+
+    SSSExtractKernelFnT extract = sss_kernels_active()->lsb1_extract;
+    uint8_t packed[PACKET_CHUNK * BITPACK_MAX_BITS / 8];
+    const uint8_t *cover_data = (uint8_t *)cover->pixels + METADATA_SIZE;
+    for (size_t first = 0; first < shadow_len; first += PACKET_CHUNK)
+    {
+        size_t count = shadow_len - first < PACKET_CHUNK ? shadow_len - first : PACKET_CHUNK;
+        size_t packed_len = bitpack_size(count, k);
+        extract(cover_data, packed, packed_len);
+        bitpack_unpack(out_shadow_data + first, packed, count, k);
+        cover_data += packed_len * 8;
+    }
+    return sssh_extract_kshadow_dimensions(cover);
+}
+
+static BMPImageT **load_bmp_images_from_dir(
     const char *dir_path,
     uint32_t max_images,
     BMPFilterFunc filter,
-    void *context)
+    void *context,
+    CoverCacheT *cache)
 {
     DIR *dir = opendir(dir_path);
     if (!dir)
@@ -45,12 +138,12 @@ BMPImageT **load_bmp_images(
 
     while ((entry = readdir(dir)) != NULL && count < max_images)
     {
-        if (entry->d_type == DT_REG && ends_with_bmp(entry->d_name))
+        if (sssh_is_bmp_entry(entry))
         {
             char full_path[512];
             snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
 
-            BMPImageT *bmp = bmp_load(full_path);
+            BMPImageT *bmp = cover_cache_load(cache, full_path);
             if (!bmp)
             {
                 fprintf(stderr, "Failed to load BMP image '%s'\n", full_path);
@@ -59,7 +152,7 @@ BMPImageT **load_bmp_images(
 
             if (filter && !filter(bmp, full_path, context))
             {
-                bmp_unload(bmp);
+                bmp_pool_release(bmp_pool_get_default(), bmp);
                 continue;
             }
 
@@ -72,17 +165,25 @@ BMPImageT **load_bmp_images(
     if (count < max_images)
     {
         fprintf(stderr, "Only %d suitable .bmp files found in '%s' (need %d)\n", count, dir_path, max_images);
-        for (uint32_t i = 0; i < count; i++)
-        {
-            bmp_unload(images[i]);
-        }
-        free(images);
+        free_bmp_images(images, count);
         return NULL;
     }
 
     return images;
 }
 
+BMPImageT **load_bmp_images(
+    const char *dir_path,
+    uint32_t max_images,
+    BMPFilterFunc filter,
+    void *context)
+{
+    stats_begin(STATS_SCAN);
+    BMPImageT **images = load_bmp_images_from_dir(dir_path, max_images, filter, context, NULL);
+    stats_end(STATS_SCAN);
+    return images;
+}
+
 bool can_hide_bits_filter(const BMPImageT *bmp, const char *path, void *ctx)
 {
     size_t bits_needed = *((size_t *)ctx);
@@ -96,25 +197,27 @@ bool can_hide_bits_filter(const BMPImageT *bmp, const char *path, void *ctx)
 
 BMPImageT **load_bmp_covers(const char *covers_dir, uint32_t n, size_t bits_needed)
 {
-    return load_bmp_images(covers_dir, n, can_hide_bits_filter, &bits_needed);
+    // Only covers go through the cover cache: stego images are rewritten by every distribution
+    stats_begin(STATS_SCAN);
+    BMPImageT **covers = load_bmp_images_from_dir(covers_dir, n, can_hide_bits_filter, &bits_needed, cover_cache_get_default());
+    stats_end(STATS_SCAN);
+    return covers;
 }
 
-void free_bmp_covers(BMPImageT **images, uint32_t k)
+void free_bmp_images(BMPImageT **images, uint32_t n)
 {
     if (!images)
         return;
 
-    for (uint32_t i = 0; i < k; i++)
+    for (uint32_t i = 0; i < n; i++)
     {
-        if (images[i])
-        {
-            bmp_unload(images[i]);
-        }
+        bmp_pool_release(bmp_pool_get_default(), images[i]);
     }
     free(images);
 }
 
 #undef METADATA_SIZE
+#undef PACKET_CHUNK
 
 // cover
 // shadow_data
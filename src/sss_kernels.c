@@ -0,0 +1,90 @@
+#include "../include/sss_kernels.h"
+
+static const SSSKernelsT gl_sss_kernels_scalar = {
+    "scalar",
+    CPU_LEVEL_SCALAR,
+    sss_share_section,
+    sss_interp_coeffs,
+    rngpt_xor_bytes_scalar,
+    lsb_encoder_lsb1_embed_bytes,
+    lsb_decoder_lsb1_extract_bytes,
+    lsb_encoder_lsb2_embed_bytes,
+    lsb_decoder_lsb2_extract_bytes,
+    lsb_encoder_lsb4_embed_bytes,
+    lsb_decoder_lsb4_extract_bytes,
+    sss_share_section_wide,
+    sss_interp_coeffs_wide,
+    crc32c_update,
+};
+
+// In increasing level order
+static const SSSKernelsT *gl_sss_kernels[] = {
+    &gl_sss_kernels_scalar,
+#ifdef SSS_KERNELS_X86
+    &sss_kernels_sse42,
+    &sss_kernels_avx2,
+    &sss_kernels_avx512,
+#endif
+};
+
+static const SSSKernelsT *gl_sss_kernels_active = NULL;
+
+size_t sss_kernels_count(void)
+{
+    return sizeof(gl_sss_kernels) / sizeof(gl_sss_kernels[0]);
+}
+
+const SSSKernelsT *sss_kernels_at(size_t index)
+{
+    if (index >= sss_kernels_count())
+        return NULL;
+    return gl_sss_kernels[index];
+}
+
+const SSSKernelsT *sss_kernels_active(void)
+{
+    const SSSKernelsT *active = __atomic_load_n(&gl_sss_kernels_active, __ATOMIC_ACQUIRE);
+    if (active != NULL)
+        return active;
+
+    CpuLevelT level = cpu_level();
+    active = gl_sss_kernels[0];
+    for (size_t i = 1; i < sss_kernels_count(); i++)
+    {
+        if (gl_sss_kernels[i]->level <= level)
+            active = gl_sss_kernels[i];
+    }
+
+    __atomic_store_n(&gl_sss_kernels_active, active, __ATOMIC_RELEASE);
+    return active;
+}
+
+SSSEmbedKernelFnT sss_kernels_embed(const SSSKernelsT *kernels, unsigned lsb_bits)
+{
+    switch (lsb_bits)
+    {
+    case 1:
+        return kernels->lsb1_embed;
+    case 2:
+        return kernels->lsb2_embed;
+    case 4:
+        return kernels->lsb4_embed;
+    default:
+        return NULL;
+    }
+}
+
+SSSExtractKernelFnT sss_kernels_extract(const SSSKernelsT *kernels, unsigned lsb_bits)
+{
+    switch (lsb_bits)
+    {
+    case 1:
+        return kernels->lsb1_extract;
+    case 2:
+        return kernels->lsb2_extract;
+    case 4:
+        return kernels->lsb4_extract;
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,769 @@
+#include "../include/sss_kernels.h"
+
+#ifdef SSS_KERNELS_X86
+#include <immintrin.h>
+
+/*
+ * Vector versions of the hot kernels, one set per instruction set level. Each function carries
+ * its own target attribute, so this file builds with the generic flags of the rest of the tree
+ * and the code for a level only runs once sss_kernels_active() has checked the CPU for it.
+ *
+ * Share evaluation and interpolation are both a set of dot products mod 257 between rows of a
+ * SSS_MAX_K wide uint16_t table (powers or weights) and a vector of at most k bytes. Rows are
+ * processed 8 (or 4) at a time with 16-bit multiply-adds, and the 32-bit sums are reduced in
+ * vector registers using 256 = -1 (mod 257): x = 256 * hi + lo is congruent to lo - hi.
+ */
+
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+#define KERNEL_ROW_STRIDE SSS_MAX_K
+
+// Per cover byte of a group of 8, the payload bit it carries (MSB first)
+#define LSB_BIT_SELECT 0x0102040810204080LL
+
+/*
+ * LSB2 and LSB4 go through nibbles. Spreading zero-extends each byte to 16 bits and moves its
+ * low half to the high byte, so b becomes the byte pair (b >> 4, b & 0x0F); doing it again on
+ * the nibbles gives the bit pairs. Gathering multiplies each cover byte pair by (16, 1) or
+ * (4, 1) with maddubs, which undoes one spread step, then narrows the 16-bit results.
+ */
+#define LSB_JOIN_NIBBLES 0x0110 // Bytes (16, 1): hi * 16 + lo
+#define LSB_JOIN_PAIRS 0x0104   // Bytes (4, 1): hi * 4 + lo
+
+/* ---------------------------------------------------------------------------------------- */
+/* SSE4.2                                                                                    */
+/* ---------------------------------------------------------------------------------------- */
+
+TARGET_SSE42 static inline __m128i mod257_sse42(__m128i x)
+{
+    // x < 2^23: two folds leave [0, 383], a conditional subtraction leaves [0, 256]
+    const __m128i low = _mm_set1_epi32(0xFF);
+    x = _mm_sub_epi32(_mm_and_si128(x, low), _mm_srai_epi32(x, 8));
+    x = _mm_sub_epi32(_mm_and_si128(x, low), _mm_srai_epi32(x, 8));
+    return _mm_min_epu32(x, _mm_sub_epi32(x, _mm_set1_epi32(257)));
+}
+
+// out[r] = sum_j rows[r][j] * v[j] mod 257 for r < nrows; v holds SSS_MAX_K entries, zero past k
+TARGET_SSE42 static bool dot_rows_mod257_sse42(const uint16_t *rows, int nrows, const uint16_t *v, int k, uint16_t *out)
+{
+    int blocks = (k + 7) / 8;
+    __m128i vv[SSS_MAX_K / 8];
+    // v is SSS_MAX_K long and zero past k, so every block can be loaded
+    for (int b = 0; b < SSS_MAX_K / 8; b++)
+        vv[b] = _mm_loadu_si128((const __m128i *)(v + 8 * b));
+
+    __m128i any256 = _mm_setzero_si128();
+    for (int r = 0; r < nrows; r += 4)
+    {
+        __m128i acc[4];
+        for (int t = 0; t < 4; t++)
+        {
+            acc[t] = _mm_setzero_si128();
+            if (r + t >= nrows)
+                continue;
+            const uint16_t *row = rows + (size_t)(r + t) * KERNEL_ROW_STRIDE;
+            for (int b = 0; b < blocks; b++)
+                acc[t] = _mm_add_epi32(acc[t], _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(row + 8 * b)), vv[b]));
+        }
+
+        __m128i sum = _mm_hadd_epi32(_mm_hadd_epi32(acc[0], acc[1]), _mm_hadd_epi32(acc[2], acc[3]));
+        sum = mod257_sse42(sum);
+        any256 = _mm_or_si128(any256, _mm_cmpeq_epi32(sum, _mm_set1_epi32(256)));
+
+        uint16_t packed[8];
+        _mm_storeu_si128((__m128i *)packed, _mm_packus_epi32(sum, sum));
+        int count = nrows - r < 4 ? nrows - r : 4;
+        memcpy(out + r, packed, count * sizeof(uint16_t));
+    }
+    return _mm_movemask_epi8(any256) != 0;
+}
+
+TARGET_SSE42 static void share_section_sse42(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    if (dot_rows_mod257_sse42(powers, n, cw, k, fx))
+        sss_share_fix_overflow(coeffs, k, n, powers, fx);
+}
+
+TARGET_SSE42 static void interp_coeffs_sse42(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    for (int i = 0; i < k; i++)
+        yw[i] = y[i];
+
+    dot_rows_mod257_sse42(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_SSE42 static void share_wide_sse42(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    dot_rows_mod257_sse42(powers, n, cw, k, fx);
+}
+
+TARGET_SSE42 static void interp_wide_sse42(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    memcpy(yw, y, k * sizeof(uint16_t));
+
+    dot_rows_mod257_sse42(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_SSE42 static void xor_bytes_sse42(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+    rngpt_xor_bytes_scalar(dst + i, src + i, size - i);
+}
+
+TARGET_SSE42 static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *data, size_t len)
+{
+    // One dependent crc32 per 8 bytes; the AVX2 and AVX-512 sets share this kernel
+    uint64_t acc = ~crc;
+    for (; len >= 8; len -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        acc = _mm_crc32_u64(acc, word);
+    }
+    uint32_t acc32 = (uint32_t)acc;
+    for (; len > 0; len--, data++)
+        acc32 = _mm_crc32_u8(acc32, *data);
+    return ~acc32;
+}
+
+TARGET_SSE42 static void lsb1_embed_sse42(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    // Two payload bytes per 16 cover bytes
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+    const __m128i select = _mm_set1_epi64x(LSB_BIT_SELECT);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i keep = _mm_set1_epi8((char)0xFE);
+
+    size_t i = 0;
+    for (; i + 2 <= len; i += 2)
+    {
+        uint16_t pair;
+        memcpy(&pair, bytes + i, sizeof(pair));
+        __m128i bits = _mm_shuffle_epi8(_mm_set1_epi16((short)pair), spread);
+        bits = _mm_min_epu8(_mm_and_si128(bits, select), one);
+
+        __m128i *dst = (__m128i *)(cover_data + i * 8);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst), keep), bits));
+    }
+    lsb_encoder_lsb1_embed_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+TARGET_SSE42 static void lsb1_extract_sse42(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    // Reversing each group of 8 puts its first cover byte on the highest bit of the movemask
+    const __m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+    size_t i = 0;
+    for (; i + 2 <= len; i += 2)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(cover_data + i * 8)), reverse);
+        uint16_t pair = (uint16_t)_mm_movemask_epi8(_mm_slli_epi16(v, 7));
+        memcpy(bytes + i, &pair, sizeof(pair));
+    }
+    lsb_decoder_lsb1_extract_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+// Spreads the low 8 bytes of v into 16: byte b becomes (b >> shift, b & low)
+TARGET_SSE42 static inline __m128i lsb_spread_sse42(__m128i v, int shift, short low)
+{
+    __m128i w = _mm_cvtepu8_epi16(v);
+    return _mm_or_si128(_mm_srli_epi16(w, shift), _mm_slli_epi16(_mm_and_si128(w, _mm_set1_epi16(low)), 8));
+}
+
+// Joins each byte pair of v with maddubs weights, leaving the 8 results in the low half
+TARGET_SSE42 static inline __m128i lsb_gather_sse42(__m128i v, short weights)
+{
+    __m128i w = _mm_maddubs_epi16(v, _mm_set1_epi16(weights));
+    return _mm_packus_epi16(w, w);
+}
+
+TARGET_SSE42 static void lsb2_embed_sse42(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m128i keep = _mm_set1_epi8((char)0xFC);
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        uint32_t quad;
+        memcpy(&quad, bytes + i, sizeof(quad));
+        __m128i nibbles = lsb_spread_sse42(_mm_cvtsi32_si128((int)quad), 4, 0x0F);
+        __m128i pairs = lsb_spread_sse42(nibbles, 2, 0x03);
+
+        __m128i *dst = (__m128i *)(cover_data + i * 4);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst), keep), pairs));
+    }
+    lsb_encoder_lsb2_embed_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_SSE42 static void lsb2_extract_sse42(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m128i low = _mm_set1_epi8(0x03);
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(cover_data + i * 4)), low);
+        __m128i nibbles = lsb_gather_sse42(v, LSB_JOIN_PAIRS);
+        uint32_t quad = (uint32_t)_mm_cvtsi128_si32(lsb_gather_sse42(nibbles, LSB_JOIN_NIBBLES));
+        memcpy(bytes + i, &quad, sizeof(quad));
+    }
+    lsb_decoder_lsb2_extract_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_SSE42 static void lsb4_embed_sse42(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m128i keep = _mm_set1_epi8((char)0xF0);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m128i nibbles = lsb_spread_sse42(_mm_loadl_epi64((const __m128i *)(bytes + i)), 4, 0x0F);
+
+        __m128i *dst = (__m128i *)(cover_data + i * 2);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst), keep), nibbles));
+    }
+    lsb_encoder_lsb4_embed_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+TARGET_SSE42 static void lsb4_extract_sse42(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m128i low = _mm_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(cover_data + i * 2)), low);
+        _mm_storel_epi64((__m128i *)(bytes + i), lsb_gather_sse42(v, LSB_JOIN_NIBBLES));
+    }
+    lsb_decoder_lsb4_extract_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+const SSSKernelsT sss_kernels_sse42 = {
+    "sse4.2",
+    CPU_LEVEL_SSE42,
+    share_section_sse42,
+    interp_coeffs_sse42,
+    xor_bytes_sse42,
+    lsb1_embed_sse42,
+    lsb1_extract_sse42,
+    lsb2_embed_sse42,
+    lsb2_extract_sse42,
+    lsb4_embed_sse42,
+    lsb4_extract_sse42,
+    share_wide_sse42,
+    interp_wide_sse42,
+    crc32c_sse42,
+};
+
+/* ---------------------------------------------------------------------------------------- */
+/* AVX2                                                                                      */
+/* ---------------------------------------------------------------------------------------- */
+
+TARGET_AVX2 static inline __m256i mod257_avx2(__m256i x)
+{
+    const __m256i low = _mm256_set1_epi32(0xFF);
+    x = _mm256_sub_epi32(_mm256_and_si256(x, low), _mm256_srai_epi32(x, 8));
+    x = _mm256_sub_epi32(_mm256_and_si256(x, low), _mm256_srai_epi32(x, 8));
+    return _mm256_min_epu32(x, _mm256_sub_epi32(x, _mm256_set1_epi32(257)));
+}
+
+// Sums each of 8 vectors of 8 partial sums into one lane: result[t] = sum(acc[t])
+TARGET_AVX2 static inline __m256i hsum8_avx2(const __m256i *acc)
+{
+    __m256i s0123 = _mm256_hadd_epi32(_mm256_hadd_epi32(acc[0], acc[1]), _mm256_hadd_epi32(acc[2], acc[3]));
+    __m256i s4567 = _mm256_hadd_epi32(_mm256_hadd_epi32(acc[4], acc[5]), _mm256_hadd_epi32(acc[6], acc[7]));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(s0123, s4567, 0x20),
+                            _mm256_permute2x128_si256(s0123, s4567, 0x31));
+}
+
+// Reduces 8 row sums mod 257 and stores the first count of them
+TARGET_AVX2 static inline __m256i store8_mod257_avx2(__m256i sum, uint16_t *out, int count)
+{
+    sum = mod257_avx2(sum);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    if (count == 8)
+    {
+        _mm_storeu_si128((__m128i *)out, packed);
+    }
+    else
+    {
+        uint16_t tmp[8];
+        _mm_storeu_si128((__m128i *)tmp, packed);
+        memcpy(out, tmp, count * sizeof(uint16_t));
+    }
+    return _mm256_cmpeq_epi32(sum, _mm256_set1_epi32(256));
+}
+
+TARGET_AVX2 static bool dot_rows_mod257_avx2(const uint16_t *rows, int nrows, const uint16_t *v, int k, uint16_t *out)
+{
+    int blocks = (k + 15) / 16;
+    __m256i vv[SSS_MAX_K / 16];
+    // v is SSS_MAX_K long and zero past k, so every block can be loaded
+    for (int b = 0; b < SSS_MAX_K / 16; b++)
+        vv[b] = _mm256_loadu_si256((const __m256i *)(v + 16 * b));
+
+    __m256i any256 = _mm256_setzero_si256();
+    for (int r = 0; r < nrows; r += 8)
+    {
+        __m256i acc[8];
+        for (int t = 0; t < 8; t++)
+        {
+            acc[t] = _mm256_setzero_si256();
+            if (r + t >= nrows)
+                continue;
+            const uint16_t *row = rows + (size_t)(r + t) * KERNEL_ROW_STRIDE;
+            for (int b = 0; b < blocks; b++)
+                acc[t] = _mm256_add_epi32(acc[t], _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(row + 16 * b)), vv[b]));
+        }
+
+        int count = nrows - r < 8 ? nrows - r : 8;
+        any256 = _mm256_or_si256(any256, store8_mod257_avx2(hsum8_avx2(acc), out + r, count));
+    }
+    return _mm256_movemask_epi8(any256) != 0;
+}
+
+TARGET_AVX2 static void share_section_avx2(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    if (dot_rows_mod257_avx2(powers, n, cw, k, fx))
+        sss_share_fix_overflow(coeffs, k, n, powers, fx);
+}
+
+TARGET_AVX2 static void interp_coeffs_avx2(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    for (int i = 0; i < k; i++)
+        yw[i] = y[i];
+
+    dot_rows_mod257_avx2(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_AVX2 static void share_wide_avx2(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    dot_rows_mod257_avx2(powers, n, cw, k, fx);
+}
+
+TARGET_AVX2 static void interp_wide_avx2(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    memcpy(yw, y, k * sizeof(uint16_t));
+
+    dot_rows_mod257_avx2(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_AVX2 static void xor_bytes_avx2(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, b));
+    }
+    rngpt_xor_bytes_scalar(dst + i, src + i, size - i);
+}
+
+TARGET_AVX2 static void lsb1_embed_avx2(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    // Four payload bytes per 32 cover bytes; shuffles stay within 128-bit lanes
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x(LSB_BIT_SELECT);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i keep = _mm256_set1_epi8((char)0xFE);
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        uint32_t quad;
+        memcpy(&quad, bytes + i, sizeof(quad));
+        __m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32((int)quad), spread);
+        bits = _mm256_min_epu8(_mm256_and_si256(bits, select), one);
+
+        __m256i *dst = (__m256i *)(cover_data + i * 8);
+        _mm256_storeu_si256(dst, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst), keep), bits));
+    }
+    lsb_encoder_lsb1_embed_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+TARGET_AVX2 static void lsb1_extract_avx2(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(cover_data + i * 8)), reverse);
+        uint32_t quad = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(v, 7));
+        memcpy(bytes + i, &quad, sizeof(quad));
+    }
+    lsb_decoder_lsb1_extract_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+// Spreads the 16 bytes of v into 32: byte b becomes (b >> shift, b & low)
+TARGET_AVX2 static inline __m256i lsb_spread_avx2(__m128i v, int shift, short low)
+{
+    __m256i w = _mm256_cvtepu8_epi16(v);
+    return _mm256_or_si256(_mm256_srli_epi16(w, shift),
+                           _mm256_slli_epi16(_mm256_and_si256(w, _mm256_set1_epi16(low)), 8));
+}
+
+// Joins each byte pair of v with maddubs weights into 16 bytes, in order
+TARGET_AVX2 static inline __m128i lsb_gather_avx2(__m256i v, short weights)
+{
+    __m256i w = _mm256_maddubs_epi16(v, _mm256_set1_epi16(weights));
+    return _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+}
+
+TARGET_AVX2 static void lsb2_embed_avx2(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m256i keep = _mm256_set1_epi8((char)0xFC);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m128i nibbles = lsb_spread_sse42(_mm_loadl_epi64((const __m128i *)(bytes + i)), 4, 0x0F);
+        __m256i pairs = lsb_spread_avx2(nibbles, 2, 0x03);
+
+        __m256i *dst = (__m256i *)(cover_data + i * 4);
+        _mm256_storeu_si256(dst, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst), keep), pairs));
+    }
+    lsb_encoder_lsb2_embed_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_AVX2 static void lsb2_extract_avx2(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m256i low = _mm256_set1_epi8(0x03);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(cover_data + i * 4)), low);
+        __m128i nibbles = lsb_gather_avx2(v, LSB_JOIN_PAIRS);
+        _mm_storel_epi64((__m128i *)(bytes + i), lsb_gather_sse42(nibbles, LSB_JOIN_NIBBLES));
+    }
+    lsb_decoder_lsb2_extract_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_AVX2 static void lsb4_embed_avx2(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m256i keep = _mm256_set1_epi8((char)0xF0);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m256i nibbles = lsb_spread_avx2(_mm_loadu_si128((const __m128i *)(bytes + i)), 4, 0x0F);
+
+        __m256i *dst = (__m256i *)(cover_data + i * 2);
+        _mm256_storeu_si256(dst, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(dst), keep), nibbles));
+    }
+    lsb_encoder_lsb4_embed_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+TARGET_AVX2 static void lsb4_extract_avx2(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m256i low = _mm256_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(cover_data + i * 2)), low);
+        _mm_storeu_si128((__m128i *)(bytes + i), lsb_gather_avx2(v, LSB_JOIN_NIBBLES));
+    }
+    lsb_decoder_lsb4_extract_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+const SSSKernelsT sss_kernels_avx2 = {
+    "avx2",
+    CPU_LEVEL_AVX2,
+    share_section_avx2,
+    interp_coeffs_avx2,
+    xor_bytes_avx2,
+    lsb1_embed_avx2,
+    lsb1_extract_avx2,
+    lsb2_embed_avx2,
+    lsb2_extract_avx2,
+    lsb4_embed_avx2,
+    lsb4_extract_avx2,
+    share_wide_avx2,
+    interp_wide_avx2,
+    crc32c_sse42,
+};
+
+/* ---------------------------------------------------------------------------------------- */
+/* AVX-512 (F + BW)                                                                          */
+/* ---------------------------------------------------------------------------------------- */
+
+TARGET_AVX512 static bool dot_rows_mod257_avx512(const uint16_t *rows, int nrows, const uint16_t *v, int k, uint16_t *out)
+{
+    int blocks = (k + 31) / 32;
+    __m512i vv[SSS_MAX_K / 32];
+    // v is SSS_MAX_K long and zero past k, so every block can be loaded
+    for (int b = 0; b < SSS_MAX_K / 32; b++)
+        vv[b] = _mm512_loadu_si512((const void *)(v + 32 * b));
+
+    __m256i any256 = _mm256_setzero_si256();
+    for (int r = 0; r < nrows; r += 8)
+    {
+        __m256i acc[8];
+        for (int t = 0; t < 8; t++)
+        {
+            acc[t] = _mm256_setzero_si256();
+            if (r + t >= nrows)
+                continue;
+            const uint16_t *row = rows + (size_t)(r + t) * KERNEL_ROW_STRIDE;
+            __m512i wide = _mm512_setzero_si512();
+            for (int b = 0; b < blocks; b++)
+                wide = _mm512_add_epi32(wide, _mm512_madd_epi16(_mm512_loadu_si512((const void *)(row + 32 * b)), vv[b]));
+            acc[t] = _mm256_add_epi32(_mm512_castsi512_si256(wide), _mm512_extracti64x4_epi64(wide, 1));
+        }
+
+        int count = nrows - r < 8 ? nrows - r : 8;
+        any256 = _mm256_or_si256(any256, store8_mod257_avx2(hsum8_avx2(acc), out + r, count));
+    }
+    return _mm256_movemask_epi8(any256) != 0;
+}
+
+TARGET_AVX512 static void share_section_avx512(uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    if (dot_rows_mod257_avx512(powers, n, cw, k, fx))
+        sss_share_fix_overflow(coeffs, k, n, powers, fx);
+}
+
+TARGET_AVX512 static void interp_coeffs_avx512(const SSSInterpT *interp, const uint8_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    for (int i = 0; i < k; i++)
+        yw[i] = y[i];
+
+    dot_rows_mod257_avx512(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_AVX512 static void share_wide_avx512(const uint8_t *coeffs, int k, int n, const uint16_t *powers, uint16_t *fx)
+{
+    uint16_t cw[SSS_MAX_K] = {0};
+    for (int j = 0; j < k; j++)
+        cw[j] = coeffs[j];
+
+    dot_rows_mod257_avx512(powers, n, cw, k, fx);
+}
+
+TARGET_AVX512 static void interp_wide_avx512(const SSSInterpT *interp, const uint16_t *y, uint8_t *out_coeffs)
+{
+    int k = interp->k;
+    uint16_t yw[SSS_MAX_K] = {0};
+    uint16_t out[SSS_MAX_K];
+    memcpy(yw, y, k * sizeof(uint16_t));
+
+    dot_rows_mod257_avx512(&interp->w[0][0], k, yw, k, out);
+    for (int c = 0; c < k; c++)
+        out_coeffs[c] = (uint8_t)out[c];
+}
+
+TARGET_AVX512 static void xor_bytes_avx512(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m512i a = _mm512_loadu_si512((const void *)(dst + i));
+        __m512i b = _mm512_loadu_si512((const void *)(src + i));
+        _mm512_storeu_si512((void *)(dst + i), _mm512_xor_si512(a, b));
+    }
+    if (i < size)
+    {
+        // Masked loads and stores take the tail without touching bytes past size
+        __mmask64 tail = (1ULL << (size - i)) - 1;
+        __m512i a = _mm512_maskz_loadu_epi8(tail, dst + i);
+        __m512i b = _mm512_maskz_loadu_epi8(tail, src + i);
+        _mm512_mask_storeu_epi8(dst + i, tail, _mm512_xor_si512(a, b));
+    }
+}
+
+TARGET_AVX512 static void lsb1_embed_avx512(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    // Eight payload bytes per 64 cover bytes; lane l spreads payload bytes 2l and 2l + 1
+    const __m512i spread = _mm512_set_epi64(0x0707070707070707LL, 0x0606060606060606LL,
+                                            0x0505050505050505LL, 0x0404040404040404LL,
+                                            0x0303030303030303LL, 0x0202020202020202LL,
+                                            0x0101010101010101LL, 0x0000000000000000LL);
+    const __m512i select = _mm512_set1_epi64(LSB_BIT_SELECT);
+    const __m512i one = _mm512_set1_epi8(1);
+    const __m512i keep = _mm512_set1_epi8((char)0xFE);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t octet;
+        memcpy(&octet, bytes + i, sizeof(octet));
+        __mmask64 set = _mm512_test_epi8_mask(_mm512_shuffle_epi8(_mm512_set1_epi64((long long)octet), spread), select);
+
+        void *dst = cover_data + i * 8;
+        __m512i cover = _mm512_and_si512(_mm512_loadu_si512(dst), keep);
+        _mm512_storeu_si512(dst, _mm512_mask_blend_epi8(set, cover, _mm512_or_si512(cover, one)));
+    }
+    lsb_encoder_lsb1_embed_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+TARGET_AVX512 static void lsb1_extract_avx512(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m512i order = _mm512_set_epi64(0x08090A0B0C0D0E0FLL, 0x0001020304050607LL,
+                                           0x08090A0B0C0D0E0FLL, 0x0001020304050607LL,
+                                           0x08090A0B0C0D0E0FLL, 0x0001020304050607LL,
+                                           0x08090A0B0C0D0E0FLL, 0x0001020304050607LL);
+    const __m512i one = _mm512_set1_epi8(1);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m512i v = _mm512_shuffle_epi8(_mm512_loadu_si512((const void *)(cover_data + i * 8)), order);
+        uint64_t octet = _mm512_test_epi8_mask(v, one);
+        memcpy(bytes + i, &octet, sizeof(octet));
+    }
+    lsb_decoder_lsb1_extract_bytes(cover_data + i * 8, bytes + i, len - i);
+}
+
+// Spreads the 32 bytes of v into 64: byte b becomes (b >> shift, b & low)
+TARGET_AVX512 static inline __m512i lsb_spread_avx512(__m256i v, int shift, short low)
+{
+    __m512i w = _mm512_cvtepu8_epi16(v);
+    return _mm512_or_si512(_mm512_srli_epi16(w, shift),
+                           _mm512_slli_epi16(_mm512_and_si512(w, _mm512_set1_epi16(low)), 8));
+}
+
+TARGET_AVX512 static void lsb2_embed_avx512(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m512i keep = _mm512_set1_epi8((char)0xFC);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m256i nibbles = lsb_spread_avx2(_mm_loadu_si128((const __m128i *)(bytes + i)), 4, 0x0F);
+        __m512i pairs = lsb_spread_avx512(nibbles, 2, 0x03);
+
+        void *dst = cover_data + i * 4;
+        _mm512_storeu_si512(dst, _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512(dst), keep), pairs));
+    }
+    lsb_encoder_lsb2_embed_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_AVX512 static void lsb2_extract_avx512(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m512i low = _mm512_set1_epi8(0x03);
+    const __m512i pairs = _mm512_set1_epi16(LSB_JOIN_PAIRS);
+    const __m512i nibbles = _mm512_set1_epi32(0x00010010); // Words (16, 1)
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m512i v = _mm512_and_si512(_mm512_loadu_si512((const void *)(cover_data + i * 4)), low);
+        __m512i w = _mm512_madd_epi16(_mm512_maddubs_epi16(v, pairs), nibbles);
+        _mm_storeu_si128((__m128i *)(bytes + i), _mm512_cvtepi32_epi8(w));
+    }
+    lsb_decoder_lsb2_extract_bytes(cover_data + i * 4, bytes + i, len - i);
+}
+
+TARGET_AVX512 static void lsb4_embed_avx512(uint8_t *cover_data, const uint8_t *bytes, size_t len)
+{
+    const __m512i keep = _mm512_set1_epi8((char)0xF0);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m512i nibbles = lsb_spread_avx512(_mm256_loadu_si256((const __m256i *)(bytes + i)), 4, 0x0F);
+
+        void *dst = cover_data + i * 2;
+        _mm512_storeu_si512(dst, _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512(dst), keep), nibbles));
+    }
+    lsb_encoder_lsb4_embed_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+TARGET_AVX512 static void lsb4_extract_avx512(const uint8_t *cover_data, uint8_t *bytes, size_t len)
+{
+    const __m512i low = _mm512_set1_epi8(0x0F);
+    const __m512i nibbles = _mm512_set1_epi16(LSB_JOIN_NIBBLES);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m512i v = _mm512_and_si512(_mm512_loadu_si512((const void *)(cover_data + i * 2)), low);
+        _mm256_storeu_si256((__m256i *)(bytes + i), _mm512_cvtepi16_epi8(_mm512_maddubs_epi16(v, nibbles)));
+    }
+    lsb_decoder_lsb4_extract_bytes(cover_data + i * 2, bytes + i, len - i);
+}
+
+const SSSKernelsT sss_kernels_avx512 = {
+    "avx512",
+    CPU_LEVEL_AVX512,
+    share_section_avx512,
+    interp_coeffs_avx512,
+    xor_bytes_avx512,
+    lsb1_embed_avx512,
+    lsb1_extract_avx512,
+    lsb2_embed_avx512,
+    lsb2_extract_avx512,
+    lsb4_embed_avx512,
+    lsb4_extract_avx512,
+    share_wide_avx512,
+    interp_wide_avx512,
+    crc32c_sse42,
+};
+
+#undef TARGET_SSE42
+#undef TARGET_AVX2
+#undef TARGET_AVX512
+#undef KERNEL_ROW_STRIDE
+#undef LSB_BIT_SELECT
+#undef LSB_JOIN_NIBBLES
+#undef LSB_JOIN_PAIRS
+
+#endif
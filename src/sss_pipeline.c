@@ -0,0 +1,378 @@
+#include "../include/sss_pipeline.h"
+#include "../include/sss_algos.h"
+#include "../include/bmp_writer.h"
+#include "../include/bmp_pool.h"
+#include "../include/cover_cache.h"
+#include "../include/sss_kernels.h"
+#include "../include/stats.h"
+#include <pthread.h>
+
+typedef struct {
+    const SSSPipelineJobT *job;
+    ArenaT arena;                // Holds the shadow buffers for the whole run
+    uint8_t *shadow_data[256];
+    size_t sections;
+    size_t shadow_len;
+    size_t bits_needed;
+    DIR *dir;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cover_ready;  // A cover was queued, the reader finished or the run failed
+    pthread_cond_t cover_done;   // A cover was written, releasing its share of the budget
+    pthread_cond_t shares_ready; // More sections were shared or the run failed
+
+    BMPImageT *queue[256];       // Covers in the order they were loaded, which is the x order
+    uint32_t queued;             // Covers loaded by the reader
+    uint32_t taken;              // Covers taken by the writer
+    size_t held_bytes;           // Pixel bytes of the covers loaded and not written yet
+    size_t sections_done;        // Sections of every shadow shared so far
+    bool reader_done;
+    bool failed;
+} SSSPipelineT;
+
+static size_t sss_pipeline_cover_bytes(const BMPImageT *cover)
+{
+    return (size_t)bmp_stride(cover) * cover->height;
+}
+
+static void sss_pipeline_fail(SSSPipelineT *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->failed = true;
+    pthread_cond_broadcast(&p->cover_ready);
+    pthread_cond_broadcast(&p->cover_done);
+    pthread_cond_broadcast(&p->shares_ready);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Waits until the covers in flight leave room for another one.
+ * @return false if the run failed meanwhile.
+ */
+static bool sss_pipeline_wait_budget(SSSPipelineT *p)
+{
+    pthread_mutex_lock(&p->lock);
+    // Whatever is held will be written eventually, so waiting on it cannot deadlock
+    while (!p->failed && p->held_bytes > 0 && p->held_bytes >= p->job->mem_budget)
+        pthread_cond_wait(&p->cover_done, &p->lock);
+    bool ok = !p->failed;
+    pthread_mutex_unlock(&p->lock);
+    return ok;
+}
+
+/**
+ * @brief Loads the next suitable cover of the directory, in readdir order like load_bmp_covers.
+ * @return The cover, or NULL once the directory is exhausted.
+ */
+static BMPImageT *sss_pipeline_next_cover(SSSPipelineT *p)
+{
+    struct dirent *entry;
+    while ((entry = readdir(p->dir)) != NULL)
+    {
+        if (!sssh_is_bmp_entry(entry))
+            continue;
+
+        char full_path[512];
+        snprintf(full_path, sizeof(full_path), "%s/%s", p->job->covers_dir, entry->d_name);
+
+        BMPImageT *bmp = cover_cache_load(cover_cache_get_default(), full_path);
+        if (!bmp)
+        {
+            fprintf(stderr, "Failed to load BMP image '%s'\n", full_path);
+            continue;
+        }
+
+        if (!sssh_can_hide_bits(bmp, p->bits_needed))
+        {
+            fprintf(stderr, "Cover image '%s' too small to hide required bits\n", full_path);
+            bmp_pool_release(bmp_pool_get_default(), bmp);
+            continue;
+        }
+        return bmp;
+    }
+    return NULL;
+}
+
+static void *sss_pipeline_reader(void *arg)
+{
+    SSSPipelineT *p = arg;
+    uint32_t n = p->job->n;
+    uint32_t count = 0;
+
+    while (count < n && sss_pipeline_wait_budget(p))
+    {
+        stats_begin(STATS_SCAN);
+        BMPImageT *cover = sss_pipeline_next_cover(p);
+        stats_end(STATS_SCAN);
+        if (!cover)
+            break;
+
+        pthread_mutex_lock(&p->lock);
+        p->queue[p->queued++] = cover;
+        p->held_bytes += sss_pipeline_cover_bytes(cover);
+        pthread_cond_signal(&p->cover_ready);
+        pthread_mutex_unlock(&p->lock);
+        count++;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    bool failed = p->failed;
+    p->reader_done = true;
+    pthread_cond_broadcast(&p->cover_ready);
+    pthread_mutex_unlock(&p->lock);
+
+    if (count < n && !failed)
+    {
+        fprintf(stderr, "Only %d suitable .bmp files found in '%s' (need %d)\n", count, p->job->covers_dir, n);
+        sss_pipeline_fail(p);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Takes the next cover out of the queue, waiting for the reader if needed.
+ * @return The cover, or NULL if the run failed or the reader ran out of covers.
+ */
+static BMPImageT *sss_pipeline_take_cover(SSSPipelineT *p)
+{
+    BMPImageT *cover = NULL;
+    pthread_mutex_lock(&p->lock);
+    while (!p->failed && p->taken == p->queued && !p->reader_done)
+        pthread_cond_wait(&p->cover_ready, &p->lock);
+    if (!p->failed && p->taken < p->queued)
+    {
+        cover = p->queue[p->taken];
+        p->queue[p->taken++] = NULL;
+    }
+    pthread_mutex_unlock(&p->lock);
+    return cover;
+}
+
+/**
+ * @brief Waits until more than `embedded` sections are shared.
+ * @return The number of sections shared, or 0 if the run failed.
+ */
+static size_t sss_pipeline_wait_shares(SSSPipelineT *p, size_t embedded)
+{
+    pthread_mutex_lock(&p->lock);
+    while (!p->failed && p->sections_done <= embedded)
+        pthread_cond_wait(&p->shares_ready, &p->lock);
+    size_t done = p->failed ? 0 : p->sections_done;
+    pthread_mutex_unlock(&p->lock);
+    return done;
+}
+
+static bool sss_pipeline_write_cover(SSSPipelineT *p, BMPWriterT *writer, BMPImageT *cover, uint32_t i)
+{
+    const SSSPipelineJobT *job = p->job;
+    SSSEmbedKernelFnT embed = sss_kernels_active()->lsb1_embed;
+    uint8_t *cover_data = cover->pixels;
+    size_t header_len = 0;
+    uint32_t crc = 0;
+
+    // Embed whatever is shared already, then catch up with the compute stage block by block
+    size_t embedded = 0;
+    size_t embedded_bytes = 0;
+    while (embedded < p->sections)
+    {
+        size_t ready = sss_pipeline_wait_shares(p, embedded);
+        if (ready == 0)
+            return false;
+
+        // Blocks end on a multiple of 8 sections, so packed shares end on a byte boundary
+        size_t ready_bytes = job->meta != NULL ? stego_meta_shadow_bytes(job->meta, ready) : ready;
+        stats_begin(STATS_EMBED);
+        if (job->meta != NULL)
+            crc = lsb_encoder_embed_shadow_range(cover, job->meta, job->seed, p->shadow_data[i] + embedded_bytes,
+                                                 embedded_bytes, ready_bytes - embedded_bytes, crc);
+        else
+            embed(cover_data + embedded_bytes * 8, p->shadow_data[i] + embedded_bytes, ready_bytes - embedded_bytes);
+        stats_end(STATS_EMBED);
+        embedded = ready;
+        embedded_bytes = ready_bytes;
+    }
+
+    // The header records the CRC32C of the whole shadow data, so it goes in last
+    if (job->meta != NULL)
+    {
+        StegoMetaT tagged = *job->meta;
+        tagged.shadow_crc = crc;
+        uint8_t header[STEGO_META_MAX_SIZE];
+        header_len = stego_meta_serialize(&tagged, header);
+        stats_begin(STATS_EMBED);
+        lsb_encoder_lsb1_embed_bytes(cover_data, header, header_len);
+        stats_end(STATS_EMBED);
+    }
+    stats_add_bytes_written(STATS_EMBED, p->shadow_len + header_len);
+
+    stego_meta_set_reserved(cover, job->seed, i + 1, job->meta != NULL);
+
+    char output_path[512];
+    snprintf(output_path, sizeof(output_path), "%s/stego%d.bmp", job->output_dir, i + 1);
+    if (!bmp_writer_add(writer, output_path, cover) || !bmp_writer_flush(writer))
+    {
+        fprintf(stderr, "Failed to save stego image '%s'\n", output_path);
+        return false;
+    }
+    return true;
+}
+
+static void *sss_pipeline_writer(void *arg)
+{
+    SSSPipelineT *p = arg;
+
+    // Covers are written as soon as they are ready, so each batch holds a single file
+    BMPWriterT *writer = bmp_writer_create(1, p->job->writer, p->job->writer_flags);
+    if (writer == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the stego image writer\n");
+        sss_pipeline_fail(p);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < p->job->n; i++)
+    {
+        BMPImageT *cover = sss_pipeline_take_cover(p);
+        if (!cover)
+            break;
+
+        size_t bytes = sss_pipeline_cover_bytes(cover);
+        bool ok = sss_pipeline_write_cover(p, writer, cover, i);
+        // Back to the pool, where the reader picks the buffers up again for a later cover
+        bmp_pool_release(bmp_pool_get_default(), cover);
+
+        pthread_mutex_lock(&p->lock);
+        p->held_bytes -= bytes;
+        pthread_cond_signal(&p->cover_done);
+        pthread_mutex_unlock(&p->lock);
+
+        if (!ok)
+        {
+            sss_pipeline_fail(p);
+            break;
+        }
+    }
+    bmp_writer_destroy(writer);
+    return NULL;
+}
+
+/**
+ * @brief Shares the secret block by block, publishing the progress to the writer.
+ */
+static bool sss_pipeline_share(SSSPipelineT *p)
+{
+    const SSSPipelineJobT *job = p->job;
+    uint16_t *powers = sss_share_powers_create(job->k, job->n);
+    if (!powers)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the share powers\n");
+        return false;
+    }
+
+    bool packed = job->meta != NULL && job->meta->share_bits == STEGO_META_SHARE_PACKED;
+    BMPLinearIterT q_it;
+    bmp_linear_iter_init(&q_it, job->image, 0);
+    uint64_t fixups = sss_get_overflow_fixups();
+    for (size_t first = 0; first < p->sections; first += SSS_PIPELINE_BLOCK_SECTIONS)
+    {
+        size_t count = p->sections - first;
+        if (count > SSS_PIPELINE_BLOCK_SECTIONS)
+            count = SSS_PIPELINE_BLOCK_SECTIONS;
+
+        stats_begin(STATS_SHARE);
+        if (packed)
+            sss_share_sections_packed(&q_it, job->k, job->n, powers, p->shadow_data, first, count);
+        else
+            sss_share_sections(&q_it, job->k, job->n, powers, p->shadow_data, first, count);
+        stats_end(STATS_SHARE);
+
+        pthread_mutex_lock(&p->lock);
+        bool failed = p->failed;
+        p->sections_done = first + count;
+        pthread_cond_broadcast(&p->shares_ready);
+        pthread_mutex_unlock(&p->lock);
+        if (failed)
+            break;
+    }
+    stats_add_sections(STATS_SHARE, p->sections);
+    stats_add_retries(STATS_SHARE, sss_get_overflow_fixups() - fixups);
+
+    free(powers);
+    return true;
+}
+
+bool sss_pipeline_distribute(const SSSPipelineJobT *job)
+{
+    if (job->n > 256 || job->k < SSS_MIN_K || job->k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: pipeline supports k in [%d, %d] and n up to 256\n", SSS_MIN_K, SSS_MAX_K);
+        return false;
+    }
+
+    SSSPipelineT p;
+    memset(&p, 0, sizeof(p));
+    p.job = job;
+    p.sections = ((size_t)job->image->width * job->image->height + job->k - 1) / job->k;
+    p.shadow_len = job->meta ? stego_meta_shadow_bytes(job->meta, p.sections) : p.sections;
+    p.bits_needed = job->meta ? stego_meta_cover_bytes(job->meta, p.shadow_len) : p.shadow_len * 8;
+
+    bool ok = false;
+    bool reader_started = false;
+    bool writer_started = false;
+    pthread_t reader, writer;
+
+    arena_init(&p.arena, 0);
+    for (uint32_t i = 0; i < job->n; i++)
+    {
+        p.shadow_data[i] = arena_alloc(&p.arena, p.shadow_len);
+        if (!p.shadow_data[i])
+        {
+            fprintf(stderr, "Out of memory allocating shadow_data[%d]\n", i);
+            goto cleanup;
+        }
+    }
+
+    p.dir = opendir(job->covers_dir);
+    if (!p.dir)
+    {
+        perror("Error opening BMP image directory");
+        goto cleanup;
+    }
+
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.cover_ready, NULL);
+    pthread_cond_init(&p.cover_done, NULL);
+    pthread_cond_init(&p.shares_ready, NULL);
+
+    reader_started = pthread_create(&reader, NULL, sss_pipeline_reader, &p) == 0;
+    writer_started = reader_started && pthread_create(&writer, NULL, sss_pipeline_writer, &p) == 0;
+    if (!writer_started)
+    {
+        fprintf(stderr, "Failed to start the distribution pipeline threads\n");
+        sss_pipeline_fail(&p);
+    }
+    else if (!sss_pipeline_share(&p))
+    {
+        sss_pipeline_fail(&p);
+    }
+
+    if (reader_started)
+        pthread_join(reader, NULL);
+    if (writer_started)
+        pthread_join(writer, NULL);
+
+    ok = !p.failed;
+    for (uint32_t i = p.taken; i < p.queued; i++)
+        bmp_pool_release(bmp_pool_get_default(), p.queue[i]);
+
+    pthread_cond_destroy(&p.shares_ready);
+    pthread_cond_destroy(&p.cover_done);
+    pthread_cond_destroy(&p.cover_ready);
+    pthread_mutex_destroy(&p.lock);
+
+cleanup:
+    if (p.dir)
+        closedir(p.dir);
+    arena_release(&p.arena);
+    return ok;
+}
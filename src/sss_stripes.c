@@ -0,0 +1,74 @@
+#include "../include/sss_stripes.h"
+#include "../include/lsb_encoder.h"
+#include "../include/lsb_decoder.h"
+#include "../include/stats.h"
+#include <pthread.h>
+
+typedef struct
+{
+    SSSStripeT *stripes;
+    uint32_t count;
+    uint32_t next;
+    bool embed;
+} SSSStripesPoolT;
+
+static void sss_stripes_run_one(SSSStripeT *stripe, bool embed)
+{
+    size_t header_len = stego_meta_size(&stripe->meta);
+    if (embed)
+    {
+        stats_begin(STATS_EMBED);
+        stripe->ok = lsb_encoder_lsb1_into_cover_extended(stripe->data, stripe->meta.stripe_len, stripe->cover,
+                                                          stripe->seed, &stripe->meta);
+        stats_end(STATS_EMBED);
+        stats_add_bytes_written(STATS_EMBED, stripe->meta.stripe_len + header_len);
+        if (stripe->ok)
+            stego_meta_set_reserved(stripe->cover, stripe->seed, stripe->x, true);
+        return;
+    }
+
+    stats_begin(STATS_EXTRACT);
+    stripe->ok = lsb_decoder_lsb1_extract_to_buffer_extended(stripe->data, stripe->meta.stripe_len, stripe->cover,
+                                                             &stripe->meta);
+    stats_end(STATS_EXTRACT);
+    stats_add_bytes_read(STATS_EXTRACT, stripe->meta.stripe_len + header_len);
+}
+
+static void *sss_stripes_worker(void *arg)
+{
+    SSSStripesPoolT *pool = arg;
+    uint32_t i;
+    while ((i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->count)
+        sss_stripes_run_one(&pool->stripes[i], pool->embed);
+    return NULL;
+}
+
+static bool sss_stripes_run(SSSStripeT *stripes, uint32_t count, bool embed)
+{
+    SSSStripesPoolT pool = {stripes, count, 0, embed};
+    pthread_t threads[SSS_STRIPES_MAX_THREADS];
+    uint32_t started = 0;
+    uint32_t wanted = count < SSS_STRIPES_MAX_THREADS ? count : SSS_STRIPES_MAX_THREADS;
+
+    // The calling thread is one of the workers
+    while (started + 1 < wanted && pthread_create(&threads[started], NULL, sss_stripes_worker, &pool) == 0)
+        started++;
+    sss_stripes_worker(&pool);
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++)
+        ok = ok && stripes[i].ok;
+    return ok;
+}
+
+bool sss_stripes_embed(SSSStripeT *stripes, uint32_t count)
+{
+    return sss_stripes_run(stripes, count, true);
+}
+
+bool sss_stripes_extract(SSSStripeT *stripes, uint32_t count)
+{
+    return sss_stripes_run(stripes, count, false);
+}
@@ -0,0 +1,637 @@
+#include "../include/sss_update.h"
+#include "../include/sss_algos.h"
+#include "../include/sss_kernels.h"
+#include "../include/bitpack.h"
+#include "../include/crc32c.h"
+#include "../include/compress.h"
+#include "../include/scatter.h"
+#include "../include/stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PRIME_MODULUS 257
+#define UPDATE_HEADER_BYTES (STEGO_META_MAX_SIZE * 8) // Cover bytes holding the largest header
+// Cover spans of one chunk at worst: a scatter block per 8 shadow bytes (1 LSB), plus both ends
+#define UPDATE_MAX_SPANS (SSS_UPDATE_CHUNK_SECTIONS * STEGO_META_SHARE_PACKED / 8 / 8 + 2)
+
+typedef struct {
+    char path[512];
+    int fd;
+    uint32_t pixel_offset; // File offset of the pixel data
+    BMPImageT *cover;      // Only the spans read from the file hold cover bytes
+    StegoMetaT meta;       // Unused by the k = 8 layout
+    uint32_t crc;          // CRC32C of the shadow data, patched as sections change
+    size_t loaded_until;   // Shadow bytes before this one have their cover bytes in memory
+} SSSUpdateStegoT;
+
+typedef struct {
+    size_t offset; // First cover byte
+    size_t len;
+    size_t first;  // First shadow byte it carries
+} SSSUpdateSpanT;
+
+typedef struct {
+    size_t offset; // First shadow byte
+    size_t len;
+} SSSUpdateRangeT;
+
+/**
+ * @brief Reads a span of cover bytes from the stego file into the same place of its image.
+ */
+static bool sss_update_read_span(SSSUpdateStegoT *s, size_t offset, size_t len)
+{
+    uint8_t *dst = (uint8_t *)s->cover->pixels + offset;
+    for (size_t done = 0; done < len;)
+    {
+        ssize_t got = pread(s->fd, dst + done, len - done, (off_t)s->pixel_offset + offset + done);
+        if (got <= 0)
+        {
+            if (got < 0 && errno == EINTR)
+                continue;
+            fprintf(stderr, "Error reading '%s': %s\n", s->path, got < 0 ? strerror(errno) : "Unexpected end of file");
+            return false;
+        }
+        done += got;
+    }
+    stats_add_bytes_read(STATS_LOAD, len);
+    return true;
+}
+
+/**
+ * @brief Writes a span of cover bytes of the image back to the same place of the stego file.
+ */
+static bool sss_update_write_span(SSSUpdateStegoT *s, size_t offset, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)s->cover->pixels + offset;
+    for (size_t done = 0; done < len;)
+    {
+        ssize_t put = pwrite(s->fd, src + done, len - done, (off_t)s->pixel_offset + offset + done);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Error writing '%s': %s\n", s->path, strerror(errno));
+            return false;
+        }
+        done += put;
+    }
+    stats_add_bytes_written(STATS_SAVE, len);
+    return true;
+}
+
+/**
+ * @brief Opens a stego image for update: its BMP headers and the cover bytes of its stego header.
+ */
+static bool sss_update_open(SSSUpdateStegoT *s, const char *dir, const char *name)
+{
+    snprintf(s->path, sizeof(s->path), "%s/%s", dir, name);
+    s->fd = open(s->path, O_RDWR);
+    if (s->fd < 0)
+    {
+        fprintf(stderr, "Could not open stego image '%s': %s\n", s->path, strerror(errno));
+        return false;
+    }
+
+    s->cover = calloc(1, sizeof(BMPImageT));
+    if (s->cover == NULL || !bmp_load_headers_fd(s->cover, s->fd, &s->pixel_offset))
+    {
+        fprintf(stderr, "Could not load stego image '%s'\n", s->path);
+        return false;
+    }
+
+    size_t cover_len = (size_t)bmp_stride(s->cover) * s->cover->height;
+    return sss_update_read_span(s, 0, cover_len < UPDATE_HEADER_BYTES ? cover_len : UPDATE_HEADER_BYTES);
+}
+
+/**
+ * @brief Cover bytes that carry a range of the shadow data: one span, or one per scatter block.
+ * @return The amount of spans, in the order of the shadow data.
+ */
+static size_t sss_update_spans(const SSSUpdateStegoT *s, bool legacy, size_t offset, size_t len, SSSUpdateSpanT *spans)
+{
+    if (legacy)
+    {
+        spans[0] = (SSSUpdateSpanT){offset * 8, len * 8, offset};
+        return 1;
+    }
+
+    const StegoMetaT *meta = &s->meta;
+    size_t region_offset = stego_meta_shadow_offset(meta);
+    size_t per_byte = 8 / meta->lsb_bits;
+    if (meta->layout != STEGO_META_LAYOUT_SCATTER)
+    {
+        spans[0] = (SSSUpdateSpanT){region_offset + offset * per_byte, len * per_byte, offset};
+        return 1;
+    }
+
+    // Whole blocks, which is what the scatter layout reads and writes anyway
+    ScatterT scatter;
+    scatter_init(&scatter, (size_t)bmp_stride(s->cover) * s->cover->height - region_offset, stego_meta_get_seed(s->cover));
+    size_t per_block = SCATTER_BLOCK / per_byte;
+    size_t count = 0;
+    for (size_t block = offset / per_block; block <= (offset + len - 1) / per_block; ++block)
+        spans[count++] = (SSSUpdateSpanT){region_offset + scatter_block(&scatter, block) * SCATTER_BLOCK, SCATTER_BLOCK,
+                                          block * per_block};
+    return count;
+}
+
+/**
+ * @brief Reads the cover bytes of a range of the shadow data of a stego image and extracts the
+ *        shadow bytes they hold now.
+ *
+ * Ranges come in increasing order. A scatter block shared with the previous range is in
+ * memory already, with that range embedded, so it is not read again.
+ *
+ * @param old Output buffer of len bytes.
+ */
+static bool sss_update_read_range(SSSUpdateStegoT *s, bool legacy, size_t offset, size_t len, SSSUpdateSpanT *spans,
+                                  uint8_t *old)
+{
+    size_t span_count = sss_update_spans(s, legacy, offset, len, spans);
+    for (size_t i = 0; i < span_count; ++i)
+    {
+        if (spans[i].first >= s->loaded_until && !sss_update_read_span(s, spans[i].offset, spans[i].len))
+            return false;
+    }
+    s->loaded_until = offset + len;
+
+    stats_begin(STATS_EXTRACT);
+    if (legacy)
+        sss_kernels_active()->lsb1_extract((const uint8_t *)s->cover->pixels + offset * 8, old, len);
+    else
+        lsb_decoder_extract_shadow_range(s->cover, &s->meta, stego_meta_get_seed(s->cover), old, offset, len, 0);
+    stats_end(STATS_EXTRACT);
+    return true;
+}
+
+/**
+ * @brief Replaces a range of the shadow data of a stego image, in memory only: the old shadow
+ *        bytes patch the CRC32C and the new ones are embedded in the cover bytes read for them.
+ * @param old The shadow bytes of the range before the update. Overwritten.
+ */
+static void sss_update_embed_range(SSSUpdateStegoT *s, bool legacy, const uint8_t *bytes, size_t offset, size_t len,
+                                   size_t shadow_len, uint8_t *old)
+{
+    stats_begin(STATS_EMBED);
+    if (legacy)
+    {
+        sss_kernels_active()->lsb1_embed((uint8_t *)s->cover->pixels + offset * 8, bytes, len);
+    }
+    else
+    {
+        if (stego_meta_has_crc(&s->meta))
+        {
+            for (size_t i = 0; i < len; ++i)
+                old[i] ^= bytes[i];
+            s->crc = crc32c_patch(s->crc, old, len, shadow_len - offset - len);
+        }
+        lsb_encoder_embed_shadow_range(s->cover, &s->meta, stego_meta_get_seed(s->cover), bytes, offset, len, 0);
+    }
+    stats_end(STATS_EMBED);
+}
+
+/**
+ * @brief Writes the cover bytes of a range of the shadow data back to the stego file.
+ */
+static bool sss_update_write_range(SSSUpdateStegoT *s, bool legacy, size_t offset, size_t len, SSSUpdateSpanT *spans)
+{
+    size_t span_count = sss_update_spans(s, legacy, offset, len, spans);
+    stats_begin(STATS_SAVE);
+    bool ok = true;
+    for (size_t i = 0; i < span_count && ok; ++i)
+        ok = sss_update_write_span(s, spans[i].offset, spans[i].len);
+    stats_end(STATS_SAVE);
+    return ok;
+}
+
+/**
+ * @brief Opens every stego image of the directory and checks that they form one set.
+ * @return The amount of stego images opened, or -1 on failure.
+ */
+static int sss_update_open_all(SSSUpdateStegoT *stegos, const char *dir, uint32_t k, const BMPImageT *secret, bool *legacy)
+{
+    DIR *dp = opendir(dir);
+    if (!dp)
+    {
+        perror("Error opening BMP image directory");
+        return -1;
+    }
+
+    int count = 0;
+    bool ok = true;
+    struct dirent *entry;
+    stats_begin(STATS_SCAN);
+    while (ok && (entry = readdir(dp)) != NULL)
+    {
+        if (!sssh_is_bmp_entry(entry))
+            continue;
+        if (count == SSS_MAX_N)
+        {
+            fprintf(stderr, "Error: more than %d stego images in '%s'\n", SSS_MAX_N, dir);
+            ok = false;
+            break;
+        }
+
+        SSSUpdateStegoT *s = &stegos[count++];
+        if (!sss_update_open(s, dir, entry->d_name))
+        {
+            ok = false;
+            break;
+        }
+
+        // The first image decides the layout and the seed, the others must match it
+        const BMPImageT *first = stegos[0].cover;
+        if (count == 1)
+            *legacy = k == 8 && !stego_meta_is_extended(first);
+        if (stego_meta_get_seed(s->cover) != stego_meta_get_seed(first) ||
+            stego_meta_is_extended(s->cover) != stego_meta_is_extended(first))
+        {
+            fprintf(stderr, "Error: '%s' does not belong to the same distribution\n", s->path);
+            ok = false;
+        }
+        else if (*legacy)
+        {
+            // Without a header, the secret is as large as the stego images
+            if (s->cover->width != secret->width || s->cover->height != secret->height)
+            {
+                fprintf(stderr, "Error: '%s' is %dx%d, not the size of the secret\n", s->path, s->cover->width, s->cover->height);
+                ok = false;
+            }
+        }
+        else if (!lsb_decoder_lsb1_read_meta(s->cover, &s->meta) ||
+                 (count > 1 && !stego_meta_compatible(&s->meta, &stegos[0].meta)))
+        {
+            fprintf(stderr, "Error: '%s' does not belong to the same distribution\n", s->path);
+            ok = false;
+        }
+        else if (s->meta.entries > 1)
+        {
+            fprintf(stderr, "Error: '%s' holds %u packed secrets; distribute them again instead\n", s->path, s->meta.entries);
+            ok = false;
+        }
+        else if (s->meta.stripes > 1)
+        {
+            fprintf(stderr, "Error: '%s' holds one of %u stripes of a shadow; distribute the new secret instead\n",
+                    s->path, s->meta.stripes);
+            ok = false;
+        }
+        else if (s->meta.s_width != secret->width || s->meta.s_height != secret->height ||
+                 (s->meta.version != 0 && s->meta.k != k))
+        {
+            fprintf(stderr, "Error: '%s' holds a %ux%u secret shared with k = %u\n", s->path,
+                    s->meta.s_width, s->meta.s_height, s->meta.k);
+            ok = false;
+        }
+        else if (s->meta.compress != COMPRESS_NONE)
+        {
+            // Any change moves the rest of the compressed stream, so there is nothing to patch
+            fprintf(stderr, "Error: '%s' holds a compressed secret; distribute the new one instead\n", s->path);
+            ok = false;
+        }
+        else
+        {
+            s->crc = s->meta.shadow_crc;
+        }
+
+        for (int i = 0; ok && i < count - 1; ++i)
+        {
+            if (stego_meta_get_x(stegos[i].cover) == stego_meta_get_x(s->cover))
+            {
+                fprintf(stderr, "Error: '%s' and '%s' both hold the share at x = %u\n", stegos[i].path, s->path,
+                        stego_meta_get_x(s->cover));
+                ok = false;
+            }
+        }
+    }
+    stats_end(STATS_SCAN);
+    closedir(dp);
+
+    if (ok && (uint32_t)count < k)
+    {
+        fprintf(stderr, "Error: %d stego images in '%s', at least k = %u are needed\n", count, dir, k);
+        ok = false;
+    }
+    if (!ok)
+    {
+        // Entries opened so far are closed by the caller
+        return -count - 1;
+    }
+    return count;
+}
+
+/**
+ * @brief Marks the sections where two secrets of the same size differ.
+ * @return The amount of sections that differ.
+ */
+static size_t sss_update_diff(const BMPImageT *old_secret, const BMPImageT *new_secret, uint32_t k, size_t sections, uint8_t *changed)
+{
+    BMPLinearIterT old_it, new_it;
+    bmp_linear_iter_init(&old_it, old_secret, 0);
+    bmp_linear_iter_init(&new_it, new_secret, 0);
+
+    size_t count = 0;
+    for (size_t section = 0; section < sections; ++section)
+    {
+        uint8_t a[SSS_MAX_K], b[SSS_MAX_K];
+        size_t got = bmp_linear_read(&old_it, a, k);
+        bmp_linear_read(&new_it, b, k);
+        changed[section] = memcmp(a, b, got) != 0;
+        count += changed[section];
+    }
+    return count;
+}
+
+/**
+ * @brief Reports a write that failed once files were being written, which cannot be undone.
+ */
+static void sss_update_report_partial(const char *path)
+{
+    fprintf(stderr, "Error: writing '%s' failed midway. The stego images written before it hold the new secret "
+            "and those after it the old one; it holds neither and fails its CRC32C\n", path);
+}
+
+/**
+ * @brief Shares a run of sections of a scrambled secret for every stego image.
+ * @param shares Output, chunk_bytes per stego image: the shadow bytes of the run.
+ * @param wide Scratch space for 9-bit shares, SSS_UPDATE_CHUNK_SECTIONS per stego image.
+ * @param exact If not NULL, receives per section whether its shares needed no fixup. Only
+ *              those are the same whatever x the stego images had when they were distributed.
+ */
+static void sss_update_share_run(const BMPImageT *secret, uint32_t k, int count, const uint16_t *powers, bool packed,
+                                 size_t run, size_t cnt, uint8_t *shares, size_t chunk_bytes, uint16_t *wide,
+                                 uint8_t *exact)
+{
+    const SSSKernelsT *kernels = sss_kernels_active();
+    BMPLinearIterT it;
+    bmp_linear_iter_init(&it, secret, run * k);
+    for (size_t s = 0; s < cnt; ++s)
+    {
+        uint8_t coeffs[SSS_MAX_K];
+        uint16_t fx[SSS_MAX_N];
+        size_t got = bmp_linear_read(&it, coeffs, k);
+        memset(coeffs + got, 0, k - got); // pad with 0s if overflow
+
+        if (packed)
+        {
+            kernels->share_wide(coeffs, k, count, powers, fx);
+            for (int i = 0; i < count; ++i)
+                wide[(size_t)i * SSS_UPDATE_CHUNK_SECTIONS + s] = fx[i];
+        }
+        else
+        {
+            // A fixup lowers a coefficient, which is how it shows
+            uint8_t original[SSS_MAX_K];
+            memcpy(original, coeffs, k);
+            kernels->share_section(coeffs, k, count, powers, fx);
+            for (int i = 0; i < count; ++i)
+                shares[(size_t)i * chunk_bytes + s] = (uint8_t)fx[i];
+            if (exact != NULL)
+                exact[s] = memcmp(original, coeffs, k) == 0;
+        }
+    }
+    for (int i = 0; packed && i < count; ++i)
+        bitpack_pack(shares + (size_t)i * chunk_bytes, wide + (size_t)i * SSS_UPDATE_CHUNK_SECTIONS, cnt, STEGO_META_SHARE_PACKED);
+}
+
+/**
+ * @brief Whether a stego image holds the expected shadow bytes of a run.
+ * @param exact For byte shares, which sections can be compared (sss_update_share_run); NULL
+ *              compares every byte, as for 9-bit shares, which need no fixup.
+ */
+static bool sss_update_holds(const uint8_t *held, const uint8_t *expected, size_t len, const uint8_t *exact)
+{
+    if (exact == NULL)
+        return memcmp(held, expected, len) == 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (exact[i] && held[i] != expected[i])
+            return false;
+    }
+    return true;
+}
+
+bool sss_update(BMPImageT *old_secret, BMPImageT *new_secret, uint32_t k, const char *dir, const SSSOptionsT *opts)
+{
+    if (k < SSS_MIN_K || k > SSS_MAX_K)
+    {
+        fprintf(stderr, "Invalid parameters: k must be between %d and %d\n", SSS_MIN_K, SSS_MAX_K);
+        return false;
+    }
+    if (old_secret->width != new_secret->width || old_secret->height != new_secret->height)
+    {
+        fprintf(stderr, "Error: the old secret is %dx%d and the new one %dx%d; distribute the new one instead\n",
+                old_secret->width, old_secret->height, new_secret->width, new_secret->height);
+        return false;
+    }
+
+    bool ok = false;
+    bool legacy = false;
+    uint16_t *powers = NULL;
+    uint16_t *wide = NULL;
+    uint8_t *changed = NULL;
+    uint8_t *shares = NULL;
+    uint8_t *old_shares = NULL;
+    uint8_t *exact = NULL;
+    uint8_t *old = NULL;
+    SSSUpdateSpanT *spans = NULL;
+    SSSUpdateRangeT *ranges = NULL;
+    SSSUpdateStegoT *stegos = calloc(SSS_MAX_N, sizeof(SSSUpdateStegoT));
+    if (stegos == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the stego images\n");
+        return false;
+    }
+    for (int i = 0; i < SSS_MAX_N; ++i)
+        stegos[i].fd = -1;
+
+    int count = sss_update_open_all(stegos, dir, k, new_secret, &legacy);
+    if (count < 0)
+    {
+        count = -count - 1;
+        goto cleanup;
+    }
+
+    size_t sections = ((size_t)new_secret->width * new_secret->height + k - 1) / k;
+    unsigned share_bits = legacy ? STEGO_META_SHARE_BYTE : stegos[0].meta.share_bits;
+    bool packed = share_bits == STEGO_META_SHARE_PACKED;
+    size_t shadow_len = legacy ? sections : stego_meta_shadow_bytes(&stegos[0].meta, sections);
+    size_t cover_bytes = legacy ? shadow_len * 8 : stego_meta_cover_bytes(&stegos[0].meta, shadow_len);
+    for (int i = 0; i < count; ++i)
+    {
+        if (!sssh_can_hide_bits(stegos[i].cover, cover_bytes))
+        {
+            fprintf(stderr, "Error: '%s' is too small for its share\n", stegos[i].path);
+            goto cleanup;
+        }
+    }
+
+    changed = malloc(sections);
+    size_t chunk_bytes = bitpack_size(SSS_UPDATE_CHUNK_SECTIONS, STEGO_META_SHARE_PACKED);
+    shares = malloc((size_t)count * chunk_bytes);
+    old_shares = malloc((size_t)count * chunk_bytes);
+    old = malloc(chunk_bytes);
+    exact = malloc(SSS_UPDATE_CHUNK_SECTIONS);
+    spans = malloc(UPDATE_MAX_SPANS * sizeof(SSSUpdateSpanT));
+    powers = calloc((size_t)count * SSS_MAX_K, sizeof(uint16_t));
+    wide = packed ? malloc((size_t)count * SSS_UPDATE_CHUNK_SECTIONS * sizeof(uint16_t)) : NULL;
+    if (!changed || !shares || !old_shares || !old || !exact || !spans || !powers || (packed && !wide))
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the update buffers\n");
+        goto cleanup;
+    }
+
+    stats_begin(STATS_SCAN);
+    size_t changed_count = sss_update_diff(old_secret, new_secret, k, sections, changed);
+    stats_end(STATS_SCAN);
+    stats_add_sections(STATS_SHARE, changed_count);
+    if (changed_count == 0)
+    {
+        ok = true;
+        goto cleanup;
+    }
+
+    // There are no more runs than changed sections
+    ranges = malloc(changed_count * sizeof(SSSUpdateRangeT));
+    if (ranges == NULL)
+    {
+        fprintf(stderr, "Out of memory: Failed to allocate the update buffers\n");
+        goto cleanup;
+    }
+
+    // Same seed and keystream as the distribution, so unchanged sections keep their shares. The
+    // old secret is scrambled too, to check that its shares are the ones the stego images hold.
+    uint16_t seed = stego_meta_get_seed(stegos[0].cover);
+    uint8_t keystream = legacy ? RNGPT_MODE_LCG48 : stegos[0].meta.keystream;
+    stats_begin(STATS_XOR);
+    sss_distribute_initial_xor_inplace(new_secret, seed, keystream);
+    sss_distribute_initial_xor_inplace(old_secret, seed, keystream);
+    stats_end(STATS_XOR);
+
+    // Rows for the x of every stego image, which need not be 1..n after an extension
+    for (int i = 0; i < count; ++i)
+    {
+        uint16_t *row = powers + (size_t)i * SSS_MAX_K;
+        uint16_t x = stego_meta_get_x(stegos[i].cover) % PRIME_MODULUS;
+        row[0] = 1;
+        for (uint32_t j = 1; j < k; ++j)
+            row[j] = row[j - 1] * x % PRIME_MODULUS;
+    }
+
+    // Every change is made in memory first, so a stale old secret or a read error leaves the
+    // files untouched
+    size_t range_count = 0;
+    uint64_t fixups = sss_get_overflow_fixups();
+    for (size_t first = 0; first < sections; first += SSS_UPDATE_CHUNK_SECTIONS)
+    {
+        size_t end = first + SSS_UPDATE_CHUNK_SECTIONS < sections ? first + SSS_UPDATE_CHUNK_SECTIONS : sections;
+
+        // Runs of changed sections; packed shares change 8 sections, 9 bytes, at a time
+        size_t unit = packed ? 8 : 1;
+        for (size_t run = first; run < end;)
+        {
+            size_t run_end = run;
+            while (run_end < end)
+            {
+                size_t unit_end = run_end + unit < end ? run_end + unit : end;
+                if (memchr(changed + run_end, 1, unit_end - run_end) == NULL)
+                    break;
+                run_end = unit_end;
+            }
+            if (run_end == run)
+            {
+                run += unit;
+                continue;
+            }
+
+            size_t cnt = run_end - run;
+            stats_begin(STATS_SHARE);
+            sss_update_share_run(new_secret, k, count, powers, packed, run, cnt, shares, chunk_bytes, wide, NULL);
+            sss_update_share_run(old_secret, k, count, powers, packed, run, cnt, old_shares, chunk_bytes, wide, exact);
+            stats_end(STATS_SHARE);
+
+            size_t offset = packed ? run / 8 * STEGO_META_SHARE_PACKED : run;
+            size_t len = packed ? bitpack_size(cnt, STEGO_META_SHARE_PACKED) : cnt;
+            for (int i = 0; i < count; ++i)
+            {
+                if (!sss_update_read_range(&stegos[i], legacy, offset, len, spans, old))
+                    goto cleanup;
+                if (!sss_update_holds(old, old_shares + (size_t)i * chunk_bytes, len, packed ? NULL : exact))
+                {
+                    fprintf(stderr, "Error: '%s' does not hold the shares of the old secret from section %zu on; "
+                            "nothing was written\n", stegos[i].path, run);
+                    goto cleanup;
+                }
+                sss_update_embed_range(&stegos[i], legacy, shares + (size_t)i * chunk_bytes, offset, len, shadow_len, old);
+            }
+            ranges[range_count++] = (SSSUpdateRangeT){offset, len};
+            run = run_end;
+        }
+    }
+    stats_add_retries(STATS_SHARE, sss_get_overflow_fixups() - fixups);
+
+    // Then written out, each file whole before the next. The header records the CRC32C of the
+    // whole shadow data, so it goes in last.
+    for (int i = 0; i < count; ++i)
+    {
+        SSSUpdateStegoT *s = &stegos[i];
+        for (size_t r = 0; r < range_count; ++r)
+        {
+            if (!sss_update_write_range(s, legacy, ranges[r].offset, ranges[r].len, spans))
+            {
+                sss_update_report_partial(s->path);
+                goto cleanup;
+            }
+        }
+        if (legacy || !stego_meta_has_crc(&s->meta))
+            continue;
+
+        StegoMetaT tagged = s->meta;
+        tagged.shadow_crc = s->crc;
+        uint8_t header[STEGO_META_MAX_SIZE];
+        size_t header_len = stego_meta_serialize(&tagged, header);
+        lsb_encoder_lsb1_embed_bytes(s->cover->pixels, header, header_len);
+        stats_begin(STATS_SAVE);
+        bool written = sss_update_write_span(s, 0, header_len * 8);
+        stats_end(STATS_SAVE);
+        if (!written)
+        {
+            sss_update_report_partial(s->path);
+            goto cleanup;
+        }
+    }
+
+    ok = true;
+    for (int i = 0; i < count && opts->fsync; ++i)
+    {
+        if (fsync(stegos[i].fd) != 0)
+        {
+            fprintf(stderr, "Error syncing '%s': %s\n", stegos[i].path, strerror(errno));
+            ok = false;
+        }
+    }
+
+cleanup:
+    for (int i = 0; i < count; ++i)
+    {
+        if (stegos[i].fd >= 0)
+            close(stegos[i].fd);
+        bmp_unload(stegos[i].cover);
+    }
+    free(stegos);
+    free(changed);
+    free(shares);
+    free(old_shares);
+    free(exact);
+    free(old);
+    free(spans);
+    free(ranges);
+    free(powers);
+    free(wide);
+    return ok;
+}
+
+#undef PRIME_MODULUS
+#undef UPDATE_HEADER_BYTES
+#undef UPDATE_MAX_SPANS
@@ -0,0 +1,184 @@
+#include "../include/stats.h"
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define STATS_MAX_DEPTH 16
+
+typedef struct
+{
+    StatsStageT stage;
+    uint64_t start_ns;
+    uint64_t child_ns; // Time spent in stages nested inside this one
+} StatsFrameT;
+
+static bool gl_stats_enabled = false;
+static uint64_t gl_stats_start_ns = 0;
+static StatsStageInfoT gl_stats[STATS_STAGE_COUNT];
+// Every thread nests its own stages; the counters are shared and updated atomically
+static _Thread_local StatsFrameT gl_stats_stack[STATS_MAX_DEPTH];
+static _Thread_local int gl_stats_depth = 0;
+
+static const char *gl_stats_names[STATS_STAGE_COUNT] = {
+    "scan", "load", "compress", "xor", "share", "embed", "extract", "interp", "save",
+};
+
+static uint64_t stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void stats_add(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static long stats_peak_rss_kb(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss; // Kilobytes on Linux
+}
+
+void stats_enable(void)
+{
+    memset(gl_stats, 0, sizeof(gl_stats));
+    gl_stats_depth = 0;
+    gl_stats_start_ns = stats_now_ns();
+    gl_stats_enabled = true;
+}
+
+void stats_disable(void)
+{
+    gl_stats_enabled = false;
+}
+
+bool stats_enabled(void)
+{
+    return gl_stats_enabled;
+}
+
+void stats_begin(StatsStageT stage)
+{
+    if (!gl_stats_enabled)
+        return;
+
+    // Deeper nesting than the stack allows is charged to the outermost frames
+    if (gl_stats_depth < STATS_MAX_DEPTH)
+    {
+        StatsFrameT *frame = &gl_stats_stack[gl_stats_depth];
+        frame->stage = stage;
+        frame->start_ns = stats_now_ns();
+        frame->child_ns = 0;
+    }
+    gl_stats_depth++;
+    stats_add(&gl_stats[stage].calls, 1);
+}
+
+void stats_end(StatsStageT stage)
+{
+    if (!gl_stats_enabled || gl_stats_depth == 0)
+        return;
+
+    gl_stats_depth--;
+    if (gl_stats_depth >= STATS_MAX_DEPTH)
+        return;
+
+    StatsFrameT *frame = &gl_stats_stack[gl_stats_depth];
+    if (frame->stage != stage)
+    {
+        fprintf(stderr, "stats_end: unbalanced stage '%s' (expected '%s')\n",
+                gl_stats_names[stage], gl_stats_names[frame->stage]);
+    }
+
+    uint64_t elapsed = stats_now_ns() - frame->start_ns;
+    stats_add(&gl_stats[frame->stage].ns, elapsed > frame->child_ns ? elapsed - frame->child_ns : 0);
+    __atomic_store_n(&gl_stats[frame->stage].peak_rss_kb, stats_peak_rss_kb(), __ATOMIC_RELAXED);
+    if (gl_stats_depth > 0)
+        gl_stats_stack[gl_stats_depth - 1].child_ns += elapsed;
+}
+
+void stats_add_bytes_read(StatsStageT stage, uint64_t bytes)
+{
+    if (gl_stats_enabled)
+        stats_add(&gl_stats[stage].bytes_read, bytes);
+}
+
+void stats_add_bytes_written(StatsStageT stage, uint64_t bytes)
+{
+    if (gl_stats_enabled)
+        stats_add(&gl_stats[stage].bytes_written, bytes);
+}
+
+void stats_add_sections(StatsStageT stage, uint64_t sections)
+{
+    if (gl_stats_enabled)
+        stats_add(&gl_stats[stage].sections, sections);
+}
+
+void stats_add_retries(StatsStageT stage, uint64_t retries)
+{
+    if (gl_stats_enabled)
+        stats_add(&gl_stats[stage].retries, retries);
+}
+
+const StatsStageInfoT *stats_get(StatsStageT stage)
+{
+    return &gl_stats[stage];
+}
+
+void stats_print(FILE *out, StatsFormatT format)
+{
+    StatsStageInfoT total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < STATS_STAGE_COUNT; i++)
+    {
+        total.ns += gl_stats[i].ns;
+        total.bytes_read += gl_stats[i].bytes_read;
+        total.bytes_written += gl_stats[i].bytes_written;
+        total.sections += gl_stats[i].sections;
+        total.retries += gl_stats[i].retries;
+    }
+    uint64_t wall_ns = gl_stats_enabled ? stats_now_ns() - gl_stats_start_ns : 0;
+    long peak_rss_kb = stats_peak_rss_kb();
+
+    if (format == STATS_FORMAT_JSON)
+    {
+        fprintf(out, "{\n  \"wall_ns\": %llu,\n  \"instrumented_ns\": %llu,\n  \"peak_rss_kb\": %ld,\n  \"stages\": [\n",
+                (unsigned long long)wall_ns, (unsigned long long)total.ns, peak_rss_kb);
+        for (int i = 0; i < STATS_STAGE_COUNT; i++)
+        {
+            const StatsStageInfoT *s = &gl_stats[i];
+            fprintf(out,
+                    "    {\"stage\": \"%s\", \"ns\": %llu, \"calls\": %llu, \"bytes_read\": %llu, "
+                    "\"bytes_written\": %llu, \"sections\": %llu, \"retries\": %llu, \"peak_rss_kb\": %ld}%s\n",
+                    gl_stats_names[i], (unsigned long long)s->ns, (unsigned long long)s->calls,
+                    (unsigned long long)s->bytes_read, (unsigned long long)s->bytes_written,
+                    (unsigned long long)s->sections, (unsigned long long)s->retries, s->peak_rss_kb,
+                    i + 1 < STATS_STAGE_COUNT ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        return;
+    }
+
+    fprintf(out, "%-8s %12s %6s %14s %14s %12s %8s %12s\n",
+            "stage", "ms", "calls", "read", "written", "sections", "retries", "peak_rss_kb");
+    for (int i = 0; i < STATS_STAGE_COUNT; i++)
+    {
+        const StatsStageInfoT *s = &gl_stats[i];
+        fprintf(out, "%-8s %12.3f %6llu %14llu %14llu %12llu %8llu %12ld\n",
+                gl_stats_names[i], s->ns / 1e6, (unsigned long long)s->calls,
+                (unsigned long long)s->bytes_read, (unsigned long long)s->bytes_written,
+                (unsigned long long)s->sections, (unsigned long long)s->retries, s->peak_rss_kb);
+    }
+    fprintf(out, "%-8s %12.3f %6s %14llu %14llu %12llu %8llu %12ld\n",
+            "total", total.ns / 1e6, "",
+            (unsigned long long)total.bytes_read, (unsigned long long)total.bytes_written,
+            (unsigned long long)total.sections, (unsigned long long)total.retries, peak_rss_kb);
+    fprintf(out, "wall time: %.3f ms\n", wall_ns / 1e6);
+}
+
+#undef STATS_MAX_DEPTH
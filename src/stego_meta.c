@@ -0,0 +1,266 @@
+#include "../include/stego_meta.h"
+#include "../include/permutation_table.h"
+#include "../include/bitpack.h"
+#include "../include/scatter.h"
+#include "../include/compress.h"
+
+void stego_meta_init(StegoMetaT *meta, uint16_t s_width, uint16_t s_height, uint8_t k)
+{
+    memset(meta, 0, sizeof(*meta));
+    meta->s_width = s_width;
+    meta->s_height = s_height;
+    meta->version = STEGO_META_VERSION;
+    meta->k = k;
+    meta->lsb_bits = 1;
+    meta->share_bits = STEGO_META_SHARE_BYTE;
+    meta->entries = 1;
+    meta->stripes = 1;
+}
+
+size_t stego_meta_size(const StegoMetaT *meta)
+{
+    return meta->version == 0 ? STEGO_META_LEGACY_SIZE : STEGO_META_SIZE;
+}
+
+bool stego_meta_compatible(const StegoMetaT *a, const StegoMetaT *b)
+{
+    return a->s_width == b->s_width && a->s_height == b->s_height && a->version == b->version &&
+           a->k == b->k && a->keystream == b->keystream && a->lsb_bits == b->lsb_bits &&
+           a->share_bits == b->share_bits && a->layout == b->layout && a->compress == b->compress &&
+           a->payload_len == b->payload_len && a->dict_crc == b->dict_crc && a->entries == b->entries &&
+           a->stripes == b->stripes;
+}
+
+size_t stego_meta_shadow_bytes(const StegoMetaT *meta, size_t sections)
+{
+    if (meta->share_bits == STEGO_META_SHARE_PACKED)
+        return bitpack_size(sections, STEGO_META_SHARE_PACKED);
+    return sections;
+}
+
+size_t stego_meta_payload_len(const StegoMetaT *meta)
+{
+    if (meta->compress != COMPRESS_NONE || meta->entries > 1)
+        return meta->payload_len;
+    return (size_t)meta->s_width * meta->s_height;
+}
+
+size_t stego_meta_shadow_len(const StegoMetaT *meta)
+{
+    size_t sections = meta->k > 0 ? (stego_meta_payload_len(meta) + meta->k - 1) / meta->k : 0;
+    return stego_meta_shadow_bytes(meta, sections);
+}
+
+size_t stego_meta_stripe_offset(const StegoMetaT *meta, uint32_t stripe)
+{
+    size_t shadow_len = stego_meta_shadow_len(meta);
+    size_t stripes = meta->stripes > 0 ? meta->stripes : 1;
+    size_t offset = (shadow_len + stripes - 1) / stripes * stripe;
+    return offset < shadow_len ? offset : shadow_len;
+}
+
+size_t stego_meta_stripe_len(const StegoMetaT *meta, uint32_t stripe)
+{
+    size_t shadow_len = stego_meta_shadow_len(meta);
+    size_t stripes = meta->stripes > 0 ? meta->stripes : 1;
+    size_t stripe_len = (shadow_len + stripes - 1) / stripes;
+    size_t offset = stego_meta_stripe_offset(meta, stripe);
+    return shadow_len - offset < stripe_len ? shadow_len - offset : stripe_len;
+}
+
+size_t stego_meta_shadow_offset(const StegoMetaT *meta)
+{
+    size_t header_bytes = (stego_meta_size(meta) + stego_meta_dir_size(meta)) * 8;
+    if (meta->layout == STEGO_META_LAYOUT_SCATTER)
+        return (header_bytes + SCATTER_BLOCK - 1) / SCATTER_BLOCK * SCATTER_BLOCK;
+    return header_bytes;
+}
+
+size_t stego_meta_cover_bytes(const StegoMetaT *meta, size_t shadow_len)
+{
+    size_t lsb_bits = meta->lsb_bits > 0 ? meta->lsb_bits : 1;
+    size_t shadow_bytes = shadow_len * (8 / lsb_bits);
+    if (meta->layout == STEGO_META_LAYOUT_SCATTER)
+        shadow_bytes = (shadow_bytes + SCATTER_BLOCK - 1) / SCATTER_BLOCK * SCATTER_BLOCK;
+    return stego_meta_shadow_offset(meta) + shadow_bytes;
+}
+
+static void stego_meta_put32(uint8_t *out, uint32_t value)
+{
+    out[0] = value >> 24;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+}
+
+static uint32_t stego_meta_get32(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+}
+
+size_t stego_meta_serialize(const StegoMetaT *meta, uint8_t *out)
+{
+    size_t size = stego_meta_size(meta);
+    out[0] = meta->s_width >> 8;
+    out[1] = meta->s_width & 0xFF;
+    out[2] = meta->s_height >> 8;
+    out[3] = meta->s_height & 0xFF;
+    if (meta->version == 0)
+        return size;
+
+    out[4] = meta->version;
+    out[5] = (uint8_t)size;
+    out[6] = meta->k;
+    out[7] = meta->keystream;
+    out[8] = meta->lsb_bits;
+    out[9] = meta->share_bits;
+    out[10] = meta->layout;
+    stego_meta_put32(out + 11, meta->shadow_crc);
+    out[15] = meta->compress;
+    stego_meta_put32(out + 16, meta->payload_len);
+    stego_meta_put32(out + 20, meta->dict_crc);
+    out[24] = meta->entries;
+    out[25] = meta->stripes;
+    out[26] = meta->stripe;
+    stego_meta_put32(out + 27, meta->stripe_len);
+    return size;
+}
+
+size_t stego_meta_peek_size(const uint8_t *buf, size_t len, bool extended)
+{
+    if (!extended)
+        return STEGO_META_LEGACY_SIZE;
+
+    if (len < STEGO_META_PEEK_SIZE)
+        return 0;
+
+    size_t size = buf[5];
+    if (buf[4] == 0 || size < STEGO_META_PEEK_SIZE || size > STEGO_META_MAX_SIZE)
+    {
+        fprintf(stderr, "Invalid stego header: version %u, size %zu\n", buf[4], size);
+        return 0;
+    }
+    return size;
+}
+
+bool stego_meta_parse(const uint8_t *buf, size_t len, bool extended, StegoMetaT *meta)
+{
+    memset(meta, 0, sizeof(*meta));
+    meta->lsb_bits = 1;
+    meta->share_bits = STEGO_META_SHARE_BYTE;
+    meta->entries = 1;
+    meta->stripes = 1;
+    if (len < STEGO_META_LEGACY_SIZE)
+        return false;
+
+    meta->s_width = (buf[0] << 8) | buf[1];
+    meta->s_height = (buf[2] << 8) | buf[3];
+    if (!extended)
+        return true;
+
+    size_t size = stego_meta_peek_size(buf, len, extended);
+    if (size == 0 || len < size)
+        return false;
+
+    // The size comes from the header itself, so a header of another version is told apart here
+    meta->version = buf[4];
+    if (meta->version != STEGO_META_VERSION || size != STEGO_META_SIZE)
+    {
+        fprintf(stderr, "Unsupported stego header: version %u, %zu bytes\n", meta->version, size);
+        return false;
+    }
+
+    meta->k = buf[6];
+    meta->keystream = buf[7];
+    meta->lsb_bits = buf[8];
+    meta->share_bits = buf[9];
+    meta->layout = buf[10];
+    meta->shadow_crc = stego_meta_get32(buf + 11);
+    meta->compress = buf[15];
+    meta->payload_len = stego_meta_get32(buf + 16);
+    meta->dict_crc = stego_meta_get32(buf + 20);
+    meta->entries = buf[24];
+    meta->stripes = buf[25];
+    meta->stripe = buf[26];
+    meta->stripe_len = stego_meta_get32(buf + 27);
+
+    if (meta->keystream >= RNGPT_MODE_COUNT)
+    {
+        fprintf(stderr, "Unsupported keystream mode: %u\n", meta->keystream);
+        return false;
+    }
+    if (!stego_meta_lsb_bits_valid(meta->lsb_bits))
+    {
+        fprintf(stderr, "Unsupported LSB mode: %u bits per cover byte\n", meta->lsb_bits);
+        return false;
+    }
+    if (!stego_meta_share_bits_valid(meta->share_bits))
+    {
+        fprintf(stderr, "Unsupported share width: %u bits\n", meta->share_bits);
+        return false;
+    }
+    if (!stego_meta_layout_valid(meta->layout))
+    {
+        fprintf(stderr, "Unsupported shadow layout: %u\n", meta->layout);
+        return false;
+    }
+    if (meta->compress >= COMPRESS_CODEC_COUNT || (meta->compress != COMPRESS_NONE && meta->payload_len == 0))
+    {
+        fprintf(stderr, "Unsupported compression: codec %u, %u bytes\n", meta->compress, meta->payload_len);
+        return false;
+    }
+    if (meta->entries == 0 || (meta->entries > 1 && (meta->compress != COMPRESS_NONE || meta->payload_len == 0)))
+    {
+        fprintf(stderr, "Invalid packed secrets: %u entries, %u bytes\n", meta->entries, meta->payload_len);
+        return false;
+    }
+    if (meta->stripes == 0 || meta->stripe >= meta->stripes ||
+        (meta->stripes > 1 && (meta->entries > 1 || meta->stripe_len != stego_meta_stripe_len(meta, meta->stripe))))
+    {
+        fprintf(stderr, "Invalid stripe: %u of %u, %u bytes\n", meta->stripe + 1, meta->stripes, meta->stripe_len);
+        return false;
+    }
+    return true;
+}
+
+void stego_entry_serialize(const StegoEntryT *entry, uint8_t *out)
+{
+    out[0] = entry->s_width >> 8;
+    out[1] = entry->s_width & 0xFF;
+    out[2] = entry->s_height >> 8;
+    out[3] = entry->s_height & 0xFF;
+    out[4] = entry->compress;
+    stego_meta_put32(out + 5, entry->dict_crc);
+    stego_meta_put32(out + 9, entry->offset);
+    stego_meta_put32(out + 13, entry->payload_len);
+    stego_meta_put32(out + 17, entry->shadow_crc);
+}
+
+bool stego_entry_parse(const uint8_t *buf, StegoEntryT *entry)
+{
+    entry->s_width = (buf[0] << 8) | buf[1];
+    entry->s_height = (buf[2] << 8) | buf[3];
+    entry->compress = buf[4];
+    entry->dict_crc = stego_meta_get32(buf + 5);
+    entry->offset = stego_meta_get32(buf + 9);
+    entry->payload_len = stego_meta_get32(buf + 13);
+    entry->shadow_crc = stego_meta_get32(buf + 17);
+
+    if (entry->compress >= COMPRESS_CODEC_COUNT || entry->payload_len == 0 ||
+        (entry->compress == COMPRESS_NONE && entry->payload_len != (uint32_t)entry->s_width * entry->s_height))
+    {
+        fprintf(stderr, "Invalid directory entry: %ux%u secret, codec %u, %u bytes\n", entry->s_width,
+                entry->s_height, entry->compress, entry->payload_len);
+        return false;
+    }
+    return true;
+}
+
+void stego_meta_set_reserved(BMPImageT *cover, uint16_t seed, uint16_t x, bool extended)
+{
+    cover->reserved[0] = seed & 0xFF;
+    cover->reserved[1] = (seed >> 8) & 0xFF;
+    cover->reserved[2] = x & 0xFF;
+    cover->reserved[3] = ((x >> 8) & 0xFF) | (extended ? STEGO_META_RESERVED_EXTENDED : 0);
+}
+